@@ -0,0 +1,108 @@
+#include "batch_result.h"
+
+namespace zdb{
+    batch_result::batch_result()
+    {
+        m_conn = 0;
+        m_has_res = false;
+        m_started = false;
+        m_index = -1;
+        m_affect_rows = 0;
+    }
+
+    batch_result::~batch_result()
+    {
+        close();
+    }
+
+    void batch_result::bind(MYSQL* conn)
+    {
+        close();
+
+        m_conn = conn;
+    }
+
+    bool batch_result::read_current(std::string& error)
+    {
+        MYSQL_RES* res = mysql_store_result(m_conn);
+        if(res){
+            m_has_res = m_res.bind(res, error);
+            m_affect_rows = mysql_num_rows(res);
+            return m_has_res;
+        }
+
+        if(mysql_field_count(m_conn) != 0){
+            error = "failed to call mysql_store_result, last_error=";
+            error += mysql_error(m_conn);
+            return false;
+        }
+
+        m_affect_rows = mysql_affected_rows(m_conn);
+
+        return true;
+    }
+
+    bool batch_result::next(std::string& error)
+    {
+        if(0 == m_conn){
+            return false;
+        }
+
+        m_res.close();
+        m_has_res = false;
+        m_affect_rows = 0;
+
+        if(m_started){
+            int ret = mysql_next_result(m_conn);
+            if(ret < 0){
+                m_conn = 0;
+                return false;
+            }
+
+            if(ret > 0){
+                error = "failed to call mysql_next_result, last_error=";
+                error += mysql_error(m_conn);
+                m_conn = 0;
+                return false;
+            }
+        }
+
+        m_started = true;
+        ++m_index;
+
+        if(!read_current(error)){
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void batch_result::close()
+    {
+        m_res.close();
+        m_has_res = false;
+
+        if(m_conn){
+            // 丢弃剩余结果, 否则连接处于commands out of sync状态
+            if(!m_started){
+                MYSQL_RES* res = mysql_store_result(m_conn);
+                if(res){
+                    mysql_free_result(res);
+                }
+            }
+
+            while(mysql_next_result(m_conn) == 0){
+                MYSQL_RES* res = mysql_store_result(m_conn);
+                if(res){
+                    mysql_free_result(res);
+                }
+            }
+        }
+
+        m_conn = 0;
+        m_started = false;
+        m_index = -1;
+        m_affect_rows = 0;
+    }
+}
@@ -0,0 +1,138 @@
+/*
+* @file
+    batch_result.h
+
+* @brief
+    多语句批量执行结果类
+
+* @version
+    V1.0
+
+* @author
+    agent
+
+* @date
+    2026/10/19
+
+* @note
+    一次发送多条以分号分隔的语句后, 通过next逐条读取每条语句的结果集或影响行数
+
+* @warning
+    未读完的结果会在close/析构时被丢弃, 此前连接不能执行其他语句
+* @bug
+* @copyright
+*/
+#ifndef zdb_batch_result_h
+#define zdb_batch_result_h
+#include <mysql.h>
+#include <string>
+#include "result_set.h"
+
+namespace zdb{
+    class batch_result{
+        private:
+        friend class connection;
+
+        MYSQL* m_conn;              // 执行批量语句的连接
+        result_set m_res;           // 当前语句的结果集
+        bool m_has_res;             // 当前语句是否返回结果集
+        bool m_started;             // 是否已读取第一条语句的结果
+        int m_index;                // 当前语句下标
+        my_ulonglong m_affect_rows; // 当前语句影响的记录数
+
+        /*
+		* @brief
+		    绑定到已发送批量语句的连接函数。
+		* @param  [in] MYSQL* conn  数据库连接\n
+		* @return 无\n
+		* @note
+		* @warning
+		* @bug
+		*/
+        void bind(MYSQL* conn);
+        /*
+		* @brief
+		    读取连接上当前语句结果函数。
+		* @param  [out] std::string& error  错误信息\n
+		* @return 返回读取是否成功
+		* @note
+		* @warning
+		* @bug
+		*/
+        bool read_current(std::string& error);
+
+        public:
+        batch_result();
+        ~batch_result();
+
+        batch_result(const batch_result&) = delete;
+        batch_result& operator=(const batch_result&) = delete;
+
+        /*
+	    * @brief
+	        移动到下一条语句的结果函数。
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回是否还有结果
+	    * @return  true  成功移动到下一条语句\n
+	    * @return  false 全部读完或失败, 失败时error不为空\n
+	    * @note
+	        第一次调用移动到第一条语句; 某条语句失败后其后的语句不会被执行
+	    * @warning
+	    * @bug
+	    */
+        bool next(std::string& error);
+        /*
+	    * @brief
+	        获得当前语句结果集函数。
+	    * @param  无\n
+	    * @return 返回当前语句的结果集
+	    * @return  0    当前语句没有结果集(如INSERT/UPDATE)\n
+	    * @return  !=0  结果集, 移动到下一条语句后失效\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        result_set* get_result()
+        {
+            return m_has_res?&m_res:0;
+        }
+        /*
+	    * @brief
+	        获得当前语句影响的记录数函数。
+	    * @param  无\n
+	    * @return 返回影响的记录数, 查询语句为结果集行数
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        my_ulonglong get_affect_rows()
+        {
+            return m_affect_rows;
+        }
+        /*
+	    * @brief
+	        获得当前语句下标函数。
+	    * @param  无\n
+	    * @return 返回当前语句在批量中的下标, 从0开始
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        int get_index()
+        {
+            return m_index;
+        }
+        /*
+	    * @brief
+	        丢弃剩余结果并解除绑定函数。
+	    * @param  无\n
+	    * @return 无\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        void close();
+    };
+}
+
+#endif
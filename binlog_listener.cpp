@@ -0,0 +1,545 @@
+#include "binlog_listener.h"
+#include "connection.h"
+#include "helper.h"
+#include "result_set.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+namespace zdb{
+    static const size_t MAX_TABLE_MAP_SIZE = 1<<16;     // table_id映射的最大个数, 超出时清空重建
+
+    static inline uint32_t read_le16(const unsigned char* p)
+    {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8);
+    }
+
+    static inline uint32_t read_le32(const unsigned char* p)
+    {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    static inline uint64_t read_le48(const unsigned char* p)
+    {
+        return (uint64_t)read_le32(p) | ((uint64_t)read_le16(p + 4) << 32);
+    }
+
+    static inline uint64_t read_le64(const unsigned char* p)
+    {
+        return (uint64_t)read_le32(p) | ((uint64_t)read_le32(p + 4) << 32);
+    }
+
+    static std::string to_lower(const std::string& str)
+    {
+        std::string out = str;
+        for(auto& c : out){
+            c = (char)tolower((unsigned char)c);
+        }
+
+        return out;
+    }
+
+    static bool is_rows_event(unsigned char type)
+    {
+        return (type >= BINLOG_WRITE_ROWS_EVENT_V0 && type <= BINLOG_DELETE_ROWS_EVENT_V1)
+            || (type >= BINLOG_WRITE_ROWS_EVENT && type <= BINLOG_DELETE_ROWS_EVENT)
+            || type == BINLOG_PARTIAL_UPDATE_ROWS_EVENT
+            || (type >= BINLOG_WRITE_ROWS_COMPRESSED_EVENT_V1 && type <= BINLOG_DELETE_ROWS_COMPRESSED_EVENT);
+    }
+
+    binlog_listener::binlog_listener()
+        : m_cache(0)
+        , m_checksum(false)
+        , m_position(0)
+        , m_running(false)
+        , m_conn(nullptr)
+        , m_server_id(0)
+        , m_events(0)
+        , m_row_events(0)
+        , m_query_events(0)
+        , m_invalidations(0)
+    {
+    }
+
+    binlog_listener::~binlog_listener()
+    {
+        stop();
+    }
+
+    bool binlog_listener::feed(const unsigned char* buf, size_t len, std::string& error)
+    {
+        if(0 == buf || len < BINLOG_EVENT_HEADER_LEN){
+            error = "binlog event is too short.";
+            return false;
+        }
+
+        unsigned char type = buf[4];
+        size_t event_size = read_le32(buf + 9);
+        uint32_t log_pos = read_le32(buf + 13);
+
+        if(event_size < BINLOG_EVENT_HEADER_LEN || event_size > len){
+            error = "binlog event is truncated.";
+            return false;
+        }
+
+        const unsigned char* body = buf + BINLOG_EVENT_HEADER_LEN;
+        size_t body_len = event_size - BINLOG_EVENT_HEADER_LEN;
+        if(m_checksum && type != BINLOG_FORMAT_DESCRIPTION_EVENT){
+            body_len = (body_len >= BINLOG_CHECKSUM_LEN)?body_len - BINLOG_CHECKSUM_LEN:0;
+        }
+
+        switch(type){
+            case BINLOG_FORMAT_DESCRIPTION_EVENT:
+                if(!on_format_description(body, body_len, error)){
+                    return false;
+                }
+                break;
+            case BINLOG_TABLE_MAP_EVENT:
+                on_table_map(body, body_len);
+                break;
+            case BINLOG_QUERY_EVENT:
+            case BINLOG_QUERY_COMPRESSED_EVENT:
+                on_query(type, body, body_len);
+                break;
+            case BINLOG_ROTATE_EVENT:
+                on_rotate(body, body_len);
+                break;
+            case BINLOG_TRANSACTION_PAYLOAD_EVENT:
+                // 行事件都在压缩的负载中, 不解压, 保守地清空整个缓存
+                on_unknown_change(type);
+                break;
+            default:
+                if(is_rows_event(type)){
+                    on_rows(type, body, body_len);
+                }
+                break;
+        }
+
+        // 复制连接开头的伪ROTATE事件log_pos为0
+        if(log_pos != 0 && type != BINLOG_ROTATE_EVENT){
+            std::lock_guard<std::mutex> lock(m_pos_mtx);
+            m_position = log_pos;
+        }
+
+        ++m_events;
+
+        return true;
+    }
+
+    bool binlog_listener::on_format_description(const unsigned char* body, size_t len, std::string& error)
+    {
+        // binlog_version(2) server_version(50) create_timestamp(4) header_length(1) post_header_len[]
+        const size_t fixed = 2 + 50 + 4 + 1;
+        if(len < fixed){
+            error = "format description event is too short.";
+            return false;
+        }
+
+        char version[51] = {0};
+        memcpy(version, body + 2, 50);
+
+        // 5.6.1起(MariaDB 5.3起)FORMAT_DESCRIPTION末尾带1字节校验算法和4字节校验和
+        char* p = version;
+        unsigned long major = strtoul(p, &p, 10);
+        unsigned long minor = (*p == '.')?strtoul(p + 1, &p, 10):0;
+        unsigned long patch = (*p == '.')?strtoul(p + 1, &p, 10):0;
+        bool mariadb = (strstr(version, "MariaDB") != 0);
+        unsigned long id = major * 10000 + minor * 100 + patch;
+        bool has_alg = mariadb?(id >= 50300):(id >= 50601);
+
+        size_t end = len;
+        m_checksum = false;
+        if(has_alg && len >= fixed + 1 + BINLOG_CHECKSUM_LEN){
+            end = len - 1 - BINLOG_CHECKSUM_LEN;
+            m_checksum = (body[end] == 1);
+        }
+
+        m_post_header_len.assign(body + fixed, body + end);
+
+        return true;
+    }
+
+    uint64_t binlog_listener::read_table_id(unsigned char type, const unsigned char* body, size_t len)
+    {
+        size_t post_header_len = (type >= 1 && (size_t)type <= m_post_header_len.size())?m_post_header_len[type - 1]:8;
+        if(6 == post_header_len){
+            return (len >= 4)?read_le32(body):0;
+        }
+
+        return (len >= 6)?read_le48(body):0;
+    }
+
+    void binlog_listener::on_table_map(const unsigned char* body, size_t len)
+    {
+        size_t post_header_len = (m_post_header_len.size() >= BINLOG_TABLE_MAP_EVENT)?m_post_header_len[BINLOG_TABLE_MAP_EVENT - 1]:8;
+        if(len < post_header_len + 2){
+            return;
+        }
+
+        uint64_t table_id = read_table_id(BINLOG_TABLE_MAP_EVENT, body, len);
+
+        // db_len(1) db '\0' table_len(1) table '\0' ...
+        const unsigned char* p = body + post_header_len;
+        const unsigned char* end = body + len;
+        size_t db_len = *p++;
+        if(p + db_len + 2 > end){
+            return;
+        }
+        std::string db((const char*)p, db_len);
+        p += db_len + 1;
+
+        size_t table_len = *p++;
+        if(p + table_len > end){
+            return;
+        }
+        std::string table((const char*)p, table_len);
+
+        if(m_table_map.size() >= MAX_TABLE_MAP_SIZE){
+            m_table_map.clear();
+        }
+        m_table_map[table_id] = std::make_pair(db, table);
+    }
+
+    void binlog_listener::on_rows(unsigned char type, const unsigned char* body, size_t len)
+    {
+        ++m_row_events;
+
+        // 表映射满后被清空或从事务中间开始接收时找不到表, 不能跳过这次写
+        auto fi = m_table_map.find(read_table_id(type, body, len));
+        if(fi == m_table_map.end()){
+            on_unknown_change(type);
+            return;
+        }
+
+        binlog_change change;
+        change.m_event_type = type;
+        change.m_db = fi->second.first;
+        change.m_table = fi->second.second;
+
+        if(m_cache){
+            m_cache->invalidate(std::vector<std::string>(1, to_lower(change.m_table)));
+            ++m_invalidations;
+        }
+
+        notify(change);
+    }
+
+    void binlog_listener::on_unknown_change(unsigned char type)
+    {
+        binlog_change change;
+        change.m_event_type = type;
+
+        if(m_cache){
+            m_cache->clear();
+            ++m_invalidations;
+        }
+
+        notify(change);
+    }
+
+    void binlog_listener::on_query(unsigned char type, const unsigned char* body, size_t len)
+    {
+        ++m_query_events;
+
+        // 压缩的语句无法解析, 保守地清空整个缓存
+        if(BINLOG_QUERY_COMPRESSED_EVENT == type){
+            on_unknown_change(type);
+            return;
+        }
+
+        binlog_change change;
+        change.m_event_type = type;
+
+        // thread_id(4) exec_time(4) db_len(1) error_code(2) status_vars_len(2)
+        size_t post_header_len = (m_post_header_len.size() >= BINLOG_QUERY_EVENT)?m_post_header_len[BINLOG_QUERY_EVENT - 1]:13;
+        if(post_header_len < 11 || len < post_header_len){
+            return;
+        }
+
+        size_t db_len = body[8];
+        size_t status_len = (post_header_len >= 13)?read_le16(body + 11):0;
+        size_t offset = post_header_len + status_len;
+        if(offset + db_len + 1 > len){
+            return;
+        }
+
+        change.m_db.assign((const char*)body + offset, db_len);
+        offset += db_len + 1;
+        change.m_query.assign((const char*)body + offset, len - offset);
+
+        if(!query_cache::is_write_sql(change.m_query.c_str())){
+            return;
+        }
+
+        std::vector<std::string> tables;
+        db_helper::instance().get_sql_tables(change.m_query.c_str(), tables);
+
+        if(m_cache){
+            if(tables.empty()){
+                m_cache->clear();
+            }else{
+                m_cache->invalidate(tables);
+            }
+            ++m_invalidations;
+        }
+
+        if(tables.empty()){
+            notify(change);
+        }
+
+        for(auto& table : tables){
+            change.m_table = table;
+            notify(change);
+        }
+    }
+
+    void binlog_listener::on_rotate(const unsigned char* body, size_t len)
+    {
+        // position(8) file_name
+        if(len < 8){
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_pos_mtx);
+        m_position = read_le64(body);
+        m_file.assign((const char*)body + 8, len - 8);
+    }
+
+    void binlog_listener::notify(const binlog_change& change)
+    {
+        if(m_fn){
+            m_fn(change);
+        }
+    }
+
+    bool binlog_listener::read_file(const char* path, std::string& error)
+    {
+        FILE* fp = fopen(path, "rb");
+        if(0 == fp){
+            error = "failed to open binlog file: ";
+            error += path;
+            return false;
+        }
+
+        static const unsigned char magic[4] = {0xfe, 'b', 'i', 'n'};
+        unsigned char header[BINLOG_EVENT_HEADER_LEN];
+        if(fread(header, 1, 4, fp) != 4 || memcmp(header, magic, 4) != 0){
+            fclose(fp);
+            error = "not a binlog file: ";
+            error += path;
+            return false;
+        }
+
+        {
+            const char* name = strrchr(path, '/');
+            std::lock_guard<std::mutex> lock(m_pos_mtx);
+            m_file = name?name + 1:path;
+            m_position = 4;
+        }
+
+        // 每个文件以FORMAT_DESCRIPTION开始, 表映射按文件重建
+        m_table_map.clear();
+        m_checksum = false;
+
+        bool ret = true;
+        std::vector<unsigned char> event;
+        for(;;){
+            size_t n = fread(header, 1, BINLOG_EVENT_HEADER_LEN, fp);
+            if(0 == n){
+                break;
+            }
+
+            if(n != BINLOG_EVENT_HEADER_LEN){
+                error = "binlog file is truncated.";
+                ret = false;
+                break;
+            }
+
+            size_t event_size = read_le32(header + 9);
+            if(event_size < BINLOG_EVENT_HEADER_LEN){
+                error = "invalid binlog event size.";
+                ret = false;
+                break;
+            }
+
+            event.resize(event_size);
+            memcpy(event.data(), header, BINLOG_EVENT_HEADER_LEN);
+            size_t rest = event_size - BINLOG_EVENT_HEADER_LEN;
+            if(fread(event.data() + BINLOG_EVENT_HEADER_LEN, 1, rest, fp) != rest){
+                error = "binlog file is truncated.";
+                ret = false;
+                break;
+            }
+
+            if(!feed(event.data(), event.size(), error)){
+                ret = false;
+                break;
+            }
+        }
+
+        fclose(fp);
+
+        return ret;
+    }
+
+    bool binlog_listener::start(const db_setting& cfg, unsigned int server_id, const char* file, uint64_t pos, std::string& error)
+    {
+#ifdef ZDB_HAVE_BINLOG_DUMP
+        if(m_running || m_thread.joinable()){
+            error = "binlog listener is already running.";
+            return false;
+        }
+
+        m_setting = cfg;
+        m_server_id = server_id;
+        m_conn = std::make_shared<connection>();
+        if(!m_conn->connect(cfg, error)){
+            m_conn.reset();
+            return false;
+        }
+
+        // 声明能处理校验和, 否则5.6以上的服务端拒绝dump
+        std::string ignore = "";
+        m_conn->execute_real_affect_rows("SET @master_binlog_checksum = @@global.binlog_checksum", ignore);
+        m_conn->execute_real_affect_rows("SET @mariadb_slave_capability = 4", ignore);
+
+        std::string start_file = file?file:"";
+        if(start_file.empty()){
+            result_set res;
+            if(!res.bind(m_conn->query("SHOW MASTER STATUS", error), error) || !res.get_next_record(error)){
+                m_conn->close();
+                m_conn.reset();
+                return false;
+            }
+
+            long long start_pos = 0;
+            res.get_field(0, start_file, error);
+            res.get_field(1, start_pos, error);
+            pos = (uint64_t)start_pos;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_pos_mtx);
+            m_file = start_file;
+            m_position = pos;
+            m_last_error = "";
+        }
+
+        m_table_map.clear();
+        m_checksum = false;
+        m_running = true;
+        m_thread = std::thread(&binlog_listener::dump_thread_func, this);
+
+        return true;
+#else
+        (void)cfg;
+        (void)server_id;
+        (void)file;
+        (void)pos;
+        error = "binlog dump is not supported by this client library, use read_file instead.";
+        return false;
+#endif
+    }
+
+    void binlog_listener::stop()
+    {
+        if(!m_thread.joinable()){
+            return;
+        }
+
+        m_running = false;
+
+        // 复制连接阻塞在读取上, 从另一个连接KILL它
+        unsigned long thread_id = (m_conn && m_conn->get_handle())?mysql_thread_id(m_conn->get_handle()):0;
+        if(thread_id != 0){
+            connection killer;
+            std::string error = "";
+            if(killer.connect(m_setting, error)){
+                std::string sql = "KILL " + std::to_string(thread_id);
+                killer.execute_real_affect_rows(sql.c_str(), error);
+                killer.close();
+            }
+        }
+
+        m_thread.join();
+
+        if(m_conn){
+            m_conn->close();
+            m_conn.reset();
+        }
+    }
+
+    void binlog_listener::dump_thread_func()
+    {
+#ifdef ZDB_HAVE_BINLOG_DUMP
+        std::string file = "";
+        uint64_t pos = 0;
+        get_position(file, pos);
+
+        MYSQL* conn = m_conn->get_handle();
+        MYSQL_RPL rpl;
+        memset(&rpl, 0, sizeof(rpl));
+        rpl.file_name_length = file.size();
+        rpl.file_name = file.c_str();
+        rpl.start_position = pos;
+        rpl.server_id = m_server_id;
+        rpl.flags = 0;
+
+        std::string error = "";
+        if(mysql_binlog_open(conn, &rpl) != 0){
+            error = "failed to call mysql_binlog_open, last_error=";
+            error += mysql_error(conn);
+        }else{
+            while(m_running){
+                if(mysql_binlog_fetch(conn, &rpl) != 0){
+                    if(m_running){
+                        error = "failed to call mysql_binlog_fetch, last_error=";
+                        error += mysql_error(conn);
+                    }
+                    break;
+                }
+
+                // 每个包以1字节OK标记开头
+                if(rpl.size <= 1){
+                    break;
+                }
+
+                if(!feed(rpl.buffer + 1, rpl.size - 1, error)){
+                    break;
+                }
+            }
+
+            mysql_binlog_close(conn, &rpl);
+        }
+
+        std::lock_guard<std::mutex> lock(m_pos_mtx);
+        m_last_error = error;
+#endif
+        m_running = false;
+    }
+
+    void binlog_listener::get_position(std::string& file, uint64_t& pos)
+    {
+        std::lock_guard<std::mutex> lock(m_pos_mtx);
+        file = m_file;
+        pos = m_position;
+    }
+
+    std::string binlog_listener::get_last_error()
+    {
+        std::lock_guard<std::mutex> lock(m_pos_mtx);
+        return m_last_error;
+    }
+
+    binlog_stats binlog_listener::get_stats() const
+    {
+        binlog_stats stats;
+        stats.m_events = m_events;
+        stats.m_row_events = m_row_events;
+        stats.m_query_events = m_query_events;
+        stats.m_invalidations = m_invalidations;
+
+        return stats;
+    }
+}
@@ -0,0 +1,224 @@
+/*
+* @file
+    binlog_listener.h
+
+* @brief
+    基于binlog的查询结果缓存失效类
+
+* @version
+    V1.0
+
+* @author
+    agent
+
+* @date
+    2026/10/19
+
+* @note
+    解析MySQL/MariaDB v4格式的binlog事件: 行事件通过TABLE_MAP找到表名后按表失效,
+    QUERY事件(DDL及基于语句的复制)按语句中的表失效。事件来源可以是:
+    1. 复制连接(COM_BINLOG_DUMP), 后台线程实时接收;
+    2. 磁盘上的binlog文件, 用于离线测试和回放。
+
+    zdb::binlog_listener listener;
+    listener.set_cache(&zdb_pool.get_query_cache());
+    listener.start(setting, 1001, "", 0, error);
+
+* @warning
+    复制连接需要REPLICATION SLAVE和REPLICATION CLIENT权限, server_id不能与其他从库重复。
+    复制连接依赖libmysqlclient 8.0的mysql_binlog_open/mysql_binlog_fetch,
+    其他客户端库只支持读取binlog文件
+* @bug
+* @copyright
+*/
+#ifndef zdb_binlog_listener_h
+#define zdb_binlog_listener_h
+#include <mysql.h>
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "common.h"
+#include "query_cache.h"
+
+#if !defined(MARIADB_PACKAGE_VERSION_ID) && defined(MYSQL_VERSION_ID) && MYSQL_VERSION_ID >= 80000
+#define ZDB_HAVE_BINLOG_DUMP 1
+#endif
+
+namespace zdb{
+    class connection;
+
+    enum binlog_event_type{
+        BINLOG_QUERY_EVENT              = 2,
+        BINLOG_ROTATE_EVENT             = 4,
+        BINLOG_FORMAT_DESCRIPTION_EVENT = 15,
+        BINLOG_TABLE_MAP_EVENT          = 19,
+        BINLOG_WRITE_ROWS_EVENT_V0      = 20,
+        BINLOG_UPDATE_ROWS_EVENT_V0     = 21,
+        BINLOG_DELETE_ROWS_EVENT_V0     = 22,
+        BINLOG_WRITE_ROWS_EVENT_V1      = 23,
+        BINLOG_UPDATE_ROWS_EVENT_V1     = 24,
+        BINLOG_DELETE_ROWS_EVENT_V1     = 25,
+        BINLOG_WRITE_ROWS_EVENT         = 30,
+        BINLOG_UPDATE_ROWS_EVENT        = 31,
+        BINLOG_DELETE_ROWS_EVENT        = 32,
+        BINLOG_PARTIAL_UPDATE_ROWS_EVENT = 39,
+        BINLOG_TRANSACTION_PAYLOAD_EVENT = 40,  // MySQL 8.0.20起binlog_transaction_compression=ON时整个事务的压缩事件
+        BINLOG_QUERY_COMPRESSED_EVENT   = 165,  // MariaDB
+        BINLOG_WRITE_ROWS_COMPRESSED_EVENT_V1  = 166,
+        BINLOG_DELETE_ROWS_COMPRESSED_EVENT    = 171,
+    };
+
+    const size_t BINLOG_EVENT_HEADER_LEN = 19;      // v4事件头长度
+    const size_t BINLOG_CHECKSUM_LEN = 4;           // CRC32校验和长度
+
+    // 一次表数据变更
+    struct binlog_change{
+        unsigned char m_event_type;     // 事件类型
+        std::string m_db;               // 库名, 未知时为空
+        std::string m_table;            // 表名, 为空表示无法确定(如压缩的事件、未知的table_id), 已清空整个缓存
+        std::string m_query;            // QUERY事件的语句
+    };
+
+    struct binlog_stats{
+        uint64_t m_events;              // 已处理的事件数
+        uint64_t m_row_events;          // 行事件数
+        uint64_t m_query_events;        // QUERY事件数
+        uint64_t m_invalidations;       // 失效缓存的次数
+    };
+
+    class binlog_listener{
+        private:
+        query_cache* m_cache;                                       // 要失效的缓存, 可为空
+        std::function<void(const binlog_change&)> m_fn;             // 变更回调, 可为空
+        std::unordered_map<uint64_t, std::pair<std::string, std::string>> m_table_map;   // table_id-库名,表名
+        std::vector<unsigned char> m_post_header_len;               // FORMAT_DESCRIPTION中各事件的post-header长度
+        bool m_checksum;                                            // 事件是否带CRC32校验和
+
+        std::mutex m_pos_mtx;
+        std::string m_file;             // 当前binlog文件名
+        uint64_t m_position;            // 最后处理的事件结束位置
+
+        std::atomic<bool> m_running;                // 复制线程是否运行
+        std::thread m_thread;                       // 复制线程
+        std::shared_ptr<connection> m_conn;         // 复制连接
+        db_setting m_setting;                       // 复制连接设置
+        unsigned int m_server_id;                   // 作为从库的server_id
+        std::string m_last_error;                   // 复制线程的最后错误
+
+        std::atomic<uint64_t> m_events;
+        std::atomic<uint64_t> m_row_events;
+        std::atomic<uint64_t> m_query_events;
+        std::atomic<uint64_t> m_invalidations;
+
+        binlog_listener(const binlog_listener&);
+        binlog_listener& operator=(const binlog_listener&);
+
+        public:
+        binlog_listener();
+        ~binlog_listener();
+
+        void set_cache(query_cache* cache)
+        {
+            m_cache = cache;
+        }
+
+        void set_callback(const std::function<void(const binlog_change&)>& fn)
+        {
+            m_fn = fn;
+        }
+
+        /*
+		* @brief	处理一个binlog事件函数。
+		* @param 	[in]  const unsigned char* buf  事件数据, 含19字节事件头\n
+		* @param 	[in]  size_t len                事件长度\n
+		* @param 	[out] std::string& error        错误信息\n
+		* @return 	返回是否成功
+		* @note
+		    不认识的事件类型直接跳过; 压缩的事务(TRANSACTION_PAYLOAD)和找不到表映射的行事件清空整个缓存
+		* @warning
+		* @bug
+		*/
+        bool feed(const unsigned char* buf, size_t len, std::string& error);
+        /*
+		* @brief	读取并处理binlog文件函数。
+		* @param 	[in]  const char* path          binlog文件路径\n
+		* @param 	[out] std::string& error        错误信息\n
+		* @return 	返回是否成功
+		* @note
+		    用于离线测试: 以录制的binlog文件驱动缓存失效
+		* @warning
+		* @bug
+		*/
+        bool read_file(const char* path, std::string& error);
+        /*
+		* @brief	建立复制连接并启动接收线程函数。
+		* @param 	[in]  db_setting& cfg           连接设置\n
+		* @param 	[in]  unsigned int server_id    作为从库的server_id\n
+		* @param 	[in]  const char* file          起始binlog文件, 为空时从SHOW MASTER STATUS的当前位置开始\n
+		* @param 	[in]  uint64_t pos              起始位置\n
+		* @param 	[out] std::string& error        错误信息\n
+		* @return 	返回是否成功
+		* @note
+		* @warning
+		* @bug
+		*/
+        bool start(const db_setting& cfg, unsigned int server_id, const char* file, uint64_t pos, std::string& error);
+        /*
+		* @brief	停止接收线程并关闭复制连接函数。
+		* @param 	无\n
+		* @return 	无
+		* @note
+		    通过另一个连接KILL复制连接, 使阻塞中的读取返回
+		* @warning
+		* @bug
+		*/
+        void stop();
+
+        bool is_running() const
+        {
+            return m_running;
+        }
+
+        /*
+		* @brief	获得已处理到的binlog位置函数。
+		* @param 	[out] std::string& file  binlog文件名\n
+		* @param 	[out] uint64_t& pos      位置\n
+		* @return 	无
+		* @note
+		    可用于重启后从该位置继续
+		* @warning
+		* @bug
+		*/
+        void get_position(std::string& file, uint64_t& pos);
+        /*
+		* @brief	获得复制线程的最后错误函数。
+		* @param 	无\n
+		* @return 	返回错误信息
+		* @note
+		* @warning
+		* @bug
+		*/
+        std::string get_last_error();
+        binlog_stats get_stats() const;
+
+        private:
+        void dump_thread_func();
+        bool on_format_description(const unsigned char* body, size_t len, std::string& error);
+        void on_table_map(const unsigned char* body, size_t len);
+        void on_rows(unsigned char type, const unsigned char* body, size_t len);
+        void on_query(unsigned char type, const unsigned char* body, size_t len);
+        void on_rotate(const unsigned char* body, size_t len);
+        // 无法确定变更的表时保守地清空整个缓存并通知
+        void on_unknown_change(unsigned char type);
+        uint64_t read_table_id(unsigned char type, const unsigned char* body, size_t len);
+        void notify(const binlog_change& change);
+    };
+}
+
+#endif
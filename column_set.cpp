@@ -0,0 +1,242 @@
+#include "column_set.h"
+#include "text_decoder.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits>
+
+namespace zdb{
+    column_set::column_set()
+    {
+        m_row_count = 0;
+    }
+
+    column_set::~column_set()
+    {
+    }
+
+    void column_set::clear()
+    {
+        m_columns.clear();
+        m_row_count = 0;
+    }
+
+    static column_type to_column_type(enum_field_types type)
+    {
+        switch(type){
+            case MYSQL_TYPE_TINY:
+            case MYSQL_TYPE_SHORT:
+            case MYSQL_TYPE_INT24:
+            case MYSQL_TYPE_LONG:
+            case MYSQL_TYPE_LONGLONG:
+            case MYSQL_TYPE_YEAR:
+                return column_int64;
+            case MYSQL_TYPE_FLOAT:
+            case MYSQL_TYPE_DOUBLE:
+                return column_double;
+            default:
+                return column_string;
+        }
+    }
+
+    void column_set::init_column(int idx, const char* name, enum_field_types type, unsigned int flags, size_t row_count)
+    {
+        column_buffer& col = m_columns[idx];
+
+        col.m_name = name;
+        col.m_field_type = type;
+        col.m_type = to_column_type(type);
+        col.m_unsigned = (flags & UNSIGNED_FLAG) != 0;
+        col.m_binary = (flags & BINARY_FLAG) != 0;
+        col.m_null_count = 0;
+        col.m_validity.assign((row_count + 7) / 8, 0);
+
+        switch(col.m_type){
+            case column_int64:
+                col.m_int_values.resize(row_count);
+                break;
+            case column_double:
+                col.m_double_values.resize(row_count);
+                break;
+            default:
+                col.m_offsets.resize(row_count + 1);
+                col.m_offsets[0] = 0;
+                break;
+        }
+    }
+
+    bool column_set::build(MYSQL_RES* res, std::string& error)
+    {
+        clear();
+
+        if(0 == res){
+            error = "mysql_res is null";
+            return false;
+        }
+
+        int field_count = mysql_num_fields(res);
+        size_t row_count = (size_t)mysql_num_rows(res);
+
+        m_columns.resize(field_count);
+        for(int i = 0; i < field_count; ++i){
+            MYSQL_FIELD* ptr_field = mysql_fetch_field_direct(res, i);
+            init_column(i, ptr_field->name, ptr_field->type, ptr_field->flags, row_count);
+        }
+
+        mysql_data_seek(res, 0);
+
+        return build_rows(row_count, [res](MYSQL_ROW& row, unsigned long*& lengths){
+            row = mysql_fetch_row(res);
+            lengths = row?mysql_fetch_lengths(res):0;
+            return row != NULL;
+        }, error);
+    }
+
+    bool column_set::build(const cached_result& rows, std::string& error)
+    {
+        clear();
+
+        int field_count = rows.get_field_count();
+        size_t row_count = rows.get_row_count();
+        const ptr_field_index& index = rows.get_field_index();
+
+        m_columns.resize(field_count);
+        for(int i = 0; i < field_count; ++i){
+            std::string name = index?std::string(index->name_at(i)):std::string();
+            init_column(i, name.c_str(), rows.get_field_type(i), rows.get_field_flags(i), row_count);
+        }
+
+        size_t next = 0;
+        return build_rows(row_count, [&rows, &next](MYSQL_ROW& row, unsigned long*& lengths){
+            if(next >= rows.get_row_count()){
+                return false;
+            }
+            row = rows.get_row(next);
+            lengths = rows.get_lengths(next);
+            ++next;
+            return true;
+        }, error);
+    }
+
+    bool column_set::build_rows(size_t row_count, const std::function<bool(MYSQL_ROW&, unsigned long*&)>& next_row, std::string& error)
+    {
+        int field_count = (int)m_columns.size();
+
+        // 数值列按行收集文本指针, 满TEXT_DECODE_CHUNK行后逐列批量解码
+        std::vector<const char*> texts((size_t)field_count * TEXT_DECODE_CHUNK);
+        std::vector<unsigned long> text_lens((size_t)field_count * TEXT_DECODE_CHUNK);
+        size_t chunk_begin = 0;
+        size_t n = 0;
+
+        size_t row = 0;
+        MYSQL_ROW ptr_row = 0;
+        unsigned long* lengths = 0;
+        while(row < row_count && next_row(ptr_row, lengths)){
+            for(int i = 0; i < field_count; ++i){
+                column_buffer& col = m_columns[i];
+                const char* val = ptr_row[i];
+                bool valid = (val != NULL);
+
+                if(valid){
+                    col.m_validity[row >> 3] |= (uint8_t)(1 << (row & 7));
+                }else{
+                    ++col.m_null_count;
+                }
+
+                if(col.m_type != column_string){
+                    texts[(size_t)i * TEXT_DECODE_CHUNK + n] = val;
+                    text_lens[(size_t)i * TEXT_DECODE_CHUNK + n] = lengths[i];
+                    continue;
+                }
+
+                if(valid){
+                    if(col.m_data.size() + lengths[i] > (size_t)std::numeric_limits<int32_t>::max()){
+                        error = "string column exceeds 2GB: ";
+                        error += col.m_name;
+                        clear();
+                        return false;
+                    }
+                    col.m_data.insert(col.m_data.end(), val, val + lengths[i]);
+                }
+                col.m_offsets[row + 1] = (int32_t)col.m_data.size();
+            }
+
+            ++row;
+            if(++n == TEXT_DECODE_CHUNK){
+                if(!decode_chunk(texts.data(), text_lens.data(), chunk_begin, n, error)){
+                    clear();
+                    return false;
+                }
+                chunk_begin += n;
+                n = 0;
+            }
+        }
+
+        if(n > 0 && !decode_chunk(texts.data(), text_lens.data(), chunk_begin, n, error)){
+            clear();
+            return false;
+        }
+
+        m_row_count = (int64_t)row;
+
+        return true;
+    }
+
+    bool column_set::decode_chunk(const char* const* texts, const unsigned long* lens, size_t begin, size_t count, std::string& error)
+    {
+        uint8_t status[TEXT_DECODE_CHUNK];
+        for(size_t i = 0; i < m_columns.size(); ++i){
+            column_buffer& col = m_columns[i];
+            const char* const* col_texts = texts + i * TEXT_DECODE_CHUNK;
+            const unsigned long* col_lens = lens + i * TEXT_DECODE_CHUNK;
+
+            size_t bad = 0;
+            if(column_int64 == col.m_type){
+                bad = decode_int64(col_texts, col_lens, count, &col.m_int_values[begin], status);
+            }else if(column_double == col.m_type){
+                bad = decode_double(col_texts, col_lens, count, &col.m_double_values[begin], status);
+            }else{
+                continue;
+            }
+
+            for(size_t row = 0; bad > 0 && row < count; ++row){
+                if(decode_ok == status[row] || decode_null == status[row]){
+                    continue;
+                }
+                --bad;
+
+                // 超出int64的BIGINT UNSIGNED按位存放, 读取时按m_unsigned解释
+                if(decode_overflow == status[row] && col.m_unsigned && column_int64 == col.m_type && col_texts[row][0] != '-'){
+                    errno = 0;
+                    unsigned long long val = strtoull(col_texts[row], 0, 10);
+                    if(0 == errno){
+                        col.m_int_values[begin + row] = (int64_t)val;
+                        continue;
+                    }
+                }
+
+                error = (decode_overflow == status[row])?"numeric value out of range in column ":"invalid numeric value in column ";
+                error += col.m_name;
+                error += ", row ";
+                error += std::to_string(begin + row);
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    int column_set::get_column_idx_by_name(const char* name, std::string& error) const
+    {
+        for(size_t i = 0; i < m_columns.size(); ++i){
+            if(m_columns[i].m_name == name){
+                return (int)i;
+            }
+        }
+
+        error = "failed to find field: ";
+        error += name;
+
+        return -1;
+    }
+}
@@ -0,0 +1,184 @@
+/*
+* @file
+    column_set.h
+
+* @brief
+    列式结果集类
+
+* @version
+    V1.0
+
+* @author
+    agent
+
+* @date
+    2026/10/19
+
+* @note
+    把MYSQL_RES按列物化为连续的类型化数组, 内存布局与Apache Arrow一致:
+    整数列为int64数组, 浮点列为double数组, 其他列为int32偏移数组加数据区;
+    NULL记录在LSB顺序的有效位图中(1为有效), NULL位置的值为0。
+    各数组可直接作为Arrow缓冲区零拷贝交给分析代码。
+
+* @warning
+    时间和DECIMAL列按服务端返回的文本保存为字符串列
+* @bug
+* @copyright
+*/
+#ifndef zdb_column_set_h
+#define zdb_column_set_h
+#include <mysql.h>
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <vector>
+#include "query_cache.h"
+
+namespace zdb{
+    enum column_type{
+        column_int64 = 0,   // Arrow int64/uint64
+        column_double,      // Arrow float64
+        column_string,      // Arrow utf8/binary
+    };
+
+    struct column_buffer{
+        std::string m_name;                 // 字段名
+        enum_field_types m_field_type;      // 字段原始类型
+        column_type m_type;                 // 列类型
+        bool m_unsigned;                    // 整数列是否无符号
+        bool m_binary;                      // 字符串列是否为二进制
+        int64_t m_null_count;               // NULL个数
+
+        std::vector<uint8_t> m_validity;    // 有效位图
+        std::vector<int64_t> m_int_values;  // int64值
+        std::vector<double> m_double_values;// double值
+        std::vector<int32_t> m_offsets;     // 字符串偏移, 长度为行数+1
+        std::vector<char> m_data;           // 字符串数据
+
+        bool is_valid(int64_t row) const
+        {
+            return (m_validity[row >> 3] >> (row & 7)) & 1;
+        }
+    };
+
+    class column_set{
+        private:
+        std::vector<column_buffer> m_columns;   // 列
+        int64_t m_row_count;                    // 行数
+
+        // 按字段信息初始化第idx列并按行数预分配
+        void init_column(int idx, const char* name, enum_field_types type, unsigned int flags, size_t row_count);
+        // 逐行读取并填充各列, next_row返回false时结束
+        bool build_rows(size_t row_count, const std::function<bool(MYSQL_ROW&, unsigned long*&)>& next_row, std::string& error);
+        /*
+	    * @brief
+	        批量解码数值列函数。
+	    * @param  [in]  const char* const* texts        各列的文本指针, 每列TEXT_DECODE_CHUNK个\n
+	    * @param  [in]  const unsigned long* lens       各列的文本长度, 每列TEXT_DECODE_CHUNK个\n
+	    * @param  [in]  size_t begin                    本批第一行的行号\n
+	    * @param  [in]  size_t count                    本批行数\n
+	    * @param  [out] std::string& error              错误信息\n
+	    * @return 返回是否全部为合法数值或NULL
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool decode_chunk(const char* const* texts, const unsigned long* lens, size_t begin, size_t count, std::string& error);
+
+        public:
+        column_set();
+        ~column_set();
+
+        /*
+	    * @brief
+	        从已缓存的MYSQL结果集构建列数据函数。
+	    * @param  [in]  MYSQL_RES* res      mysql_store_result返回的结果集, 不会被释放\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回构建是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	        按mysql_num_rows预先分配各数组, 构建前把游标移到第一行; 数值列按TEXT_DECODE_CHUNK行批量解码
+	    * @warning
+	        数值列的文本超出范围或不是合法数值时失败
+	    * @bug
+	    */
+        bool build(MYSQL_RES* res, std::string& error);
+        /*
+	    * @brief
+	        从结果副本构建列数据函数。
+	    * @param  [in]  const cached_result& rows   结果副本, 如db_pool在内存预算内缓冲的结果\n
+	    * @param  [out] std::string& error          错误信息\n
+	    * @return 返回构建是否成功
+	    * @note
+	        与build(MYSQL_RES*)相同
+	    * @warning
+	    * @bug
+	    */
+        bool build(const cached_result& rows, std::string& error);
+        /*
+	    * @brief
+	        获得行数函数。
+	    * @param  无\n
+	    * @return 返回行数
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        int64_t get_row_count() const
+        {
+            return m_row_count;
+        }
+        /*
+	    * @brief
+	        获得列数函数。
+	    * @param  无\n
+	    * @return 返回列数
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        int get_column_count() const
+        {
+            return (int)m_columns.size();
+        }
+        /*
+	    * @brief
+	        获得列函数。
+	    * @param  [in] int idx  列下标\n
+	    * @return 返回列, 下标无效时为0
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        const column_buffer* get_column(int idx) const
+        {
+            return (idx >= 0 && idx < (int)m_columns.size())?&m_columns[idx]:0;
+        }
+        /*
+	    * @brief
+	        根据字段名获得列下标函数。
+	    * @param  [in]  const char* name    字段名\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回列下标
+	    * @return  >=0  成功\n
+	    * @return  -1  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        int get_column_idx_by_name(const char* name, std::string& error) const;
+        /*
+	    * @brief
+	        清空函数。
+	    * @param  无\n
+	    * @return 无\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        void clear();
+    };
+}
+
+#endif
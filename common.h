@@ -24,10 +24,22 @@
 #ifndef zdb_common_h
 #define zdb_common_h
 #include <string>
+#include <chrono>
 namespace zdb{
 
     const int MAX_ASYNC_EXEC_FAILED_COUNT = 3;      // 最大异步执行失败次数
+    const unsigned int MAX_TX_BACKOFF_MS  = 1000;   // 事务重试的最长退避时间(毫秒)
     const int MAX_ASYNC_QUEUE_CAPACITY    = 1<<20;  // 异步执行队列最大容量
+    const int DEFAULT_STMT_CACHE_SIZE     = 64;     // 默认每连接预处理语句缓存数
+    const unsigned int DEFAULT_QUERY_CACHE_TTL = 1000;  // 默认查询结果缓存TTL(毫秒)
+    const size_t DEFAULT_SLOW_LOG_SIZE    = 256;    // 默认保留的慢查询数
+    const int DEFAULT_TX_RETRIES          = 3;      // 默认事务遇到死锁或锁等待超时时的重试次数
+    const unsigned int DEFAULT_TX_BACKOFF_MS = 10;  // 默认事务重试的初始退避时间(毫秒)
+
+    enum result_overflow_policy{
+        result_overflow_abort  = 0,  // 超出结果集内存预算时中止查询
+        result_overflow_stream = 1,  // 超出结果集内存预算时转为流式读取剩余的行
+    };
 
     enum db_pool_size{
         db_pool_min_size = 1,    // 最小连接数
@@ -46,7 +58,11 @@ namespace zdb{
 
         int m_timeout;
 
-        db_setting(): m_host(""), m_user(""), m_pwd(""), m_dbname(""), m_charset(""), m_stmt_sql(""), m_port(3306), m_timeout(0)
+        size_t m_stmt_cache_size;   // 每个连接缓存的预处理语句数
+
+        bool m_multi_statements;    // 是否允许一次发送多条语句(CLIENT_MULTI_STATEMENTS)
+
+        db_setting(): m_host(""), m_user(""), m_pwd(""), m_dbname(""), m_charset(""), m_stmt_sql(""), m_port(3306), m_timeout(0), m_stmt_cache_size(DEFAULT_STMT_CACHE_SIZE), m_multi_statements(false)
         {}
 
         db_setting(const std::string host, const std::string user, const std::string pwd, const std::string dbname, const std::string charset, const size_t port)
@@ -57,6 +73,8 @@ namespace zdb{
             , m_charset(charset)
             , m_port(port)
             , m_timeout(0)
+            , m_stmt_cache_size(DEFAULT_STMT_CACHE_SIZE)
+            , m_multi_statements(false)
             {
                 m_stmt_sql = "";
             }
@@ -70,6 +88,16 @@ namespace zdb{
         {
             m_stmt_sql = val;
         }
+
+        void set_stmt_cache_size(const size_t& val)
+        {
+            m_stmt_cache_size = val;
+        }
+
+        void set_multi_statements(const bool& val)
+        {
+            m_multi_statements = val;
+        }
     };
 
     struct db_pool_setting: public db_setting{
@@ -77,20 +105,78 @@ namespace zdb{
         int m_min_size; // 最小连接数
         int m_max_size; // 最大连接数
 
+        size_t m_query_cache_size;          // 查询结果缓存总内存上限(字节), 0为不启用
+        size_t m_query_cache_entry_size;    // 单条查询结果缓存内存上限(字节), 0为总上限/分片数
+        unsigned int m_query_cache_ttl;     // 查询结果缓存默认TTL(毫秒)
+
+        size_t m_result_query_budget;       // 单个缓冲结果集内存上限(字节), 0不限制
+        size_t m_result_pool_budget;        // 全部存活的缓冲结果集内存上限(字节), 0不限制
+        int m_result_overflow;              // 超出上限时的处理, result_overflow_policy
+
+        bool m_query_stats;                 // 是否按SQL指纹统计语句耗时
+        unsigned int m_slow_query_ms;       // 慢查询阈值(毫秒), 0不记录慢查询
+        size_t m_slow_log_size;             // 保留的慢查询数
+
+        int m_tx_retries;                   // 事务遇到死锁或锁等待超时时的重试次数, 0不重试
+        unsigned int m_tx_backoff_ms;       // 事务重试的初始退避时间(毫秒), 每次翻倍并加随机抖动
+
         db_pool_setting(): m_size(10), m_min_size(db_pool_size::db_pool_min_size), m_max_size(db_pool_size::db_pool_max_size)
+            , m_query_cache_size(0), m_query_cache_entry_size(0), m_query_cache_ttl(DEFAULT_QUERY_CACHE_TTL)
+            , m_result_query_budget(0), m_result_pool_budget(0), m_result_overflow(result_overflow_abort)
+            , m_query_stats(false), m_slow_query_ms(0), m_slow_log_size(DEFAULT_SLOW_LOG_SIZE)
+            , m_tx_retries(DEFAULT_TX_RETRIES), m_tx_backoff_ms(DEFAULT_TX_BACKOFF_MS)
         {}
 
         db_pool_setting(const int size, const int min_size, const int max_size)
             : m_size(size)
             , m_min_size(min_size)
             , m_max_size(max_size)
+            , m_query_cache_size(0)
+            , m_query_cache_entry_size(0)
+            , m_query_cache_ttl(DEFAULT_QUERY_CACHE_TTL)
+            , m_result_query_budget(0)
+            , m_result_pool_budget(0)
+            , m_result_overflow(result_overflow_abort)
+            , m_query_stats(false)
+            , m_slow_query_ms(0)
+            , m_slow_log_size(DEFAULT_SLOW_LOG_SIZE)
+            , m_tx_retries(DEFAULT_TX_RETRIES)
+            , m_tx_backoff_ms(DEFAULT_TX_BACKOFF_MS)
             {}
+
+        void set_query_cache(const size_t& size, const unsigned int& ttl, const size_t& entry_size = 0)
+        {
+            m_query_cache_size = size;
+            m_query_cache_ttl = ttl;
+            m_query_cache_entry_size = entry_size;
+        }
+
+        void set_result_budget(const size_t& query_budget, const size_t& pool_budget, const int& overflow = result_overflow_abort)
+        {
+            m_result_query_budget = query_budget;
+            m_result_pool_budget = pool_budget;
+            m_result_overflow = overflow;
+        }
+
+        void set_query_stats(const bool& enabled, const unsigned int& slow_query_ms = 0, const size_t& slow_log_size = DEFAULT_SLOW_LOG_SIZE)
+        {
+            m_query_stats = enabled;
+            m_slow_query_ms = slow_query_ms;
+            m_slow_log_size = slow_log_size;
+        }
+
+        void set_transaction_retry(const int& retries, const unsigned int& backoff_ms = DEFAULT_TX_BACKOFF_MS)
+        {
+            m_tx_retries = retries;
+            m_tx_backoff_ms = backoff_ms;
+        }
     };
 
     struct async_sql{
         int m_failed_count;
         std::string m_sql;
-        async_sql(const std::string&& sql): m_failed_count(0), m_sql(sql)
+        std::chrono::steady_clock::time_point m_push_time;  // 加入队列的时间
+        async_sql(const std::string&& sql): m_failed_count(0), m_sql(sql), m_push_time(std::chrono::steady_clock::now())
         {}
         ~async_sql(){}
     };
@@ -6,6 +6,9 @@ namespace zdb{
         m_conn = mysql_init(NULL);
         m_stmt = 0;
         m_tmp_flag = temp;
+        m_max_packet = 0;
+        m_bulk_mode = -1;
+        m_multi_stmt = false;
     }
 
     connection::~connection()
@@ -15,6 +18,26 @@ namespace zdb{
 
     bool connection::connect(const zdb::db_setting& cfg, std::string& error)
     {
+        if(!db_interceptors::active()){
+            return do_connect(cfg, error);
+        }
+
+        db_interceptors::scope s(db_op_connect, this, 0);
+        bool ok = do_connect(cfg, error);
+        s.finish(ok, 0, error.c_str());
+
+        return ok;
+    }
+
+    bool connection::do_connect(const zdb::db_setting& cfg, std::string& error)
+    {
+        // close后重连需要重新初始化句柄
+        if(NULL == m_conn){
+            m_conn = mysql_init(NULL);
+        }
+
+        m_stmt_cache.set_capacity(cfg.m_stmt_cache_size);
+
         // set timeout
         if(mysql_options(m_conn, MYSQL_OPT_CONNECT_TIMEOUT, &cfg.m_timeout) != 0){
             error = "failed to call mysql_options, last_error=";
@@ -29,11 +52,13 @@ namespace zdb{
             return false;
         }
 
-        if(!mysql_real_connect(m_conn, cfg.m_host.c_str(), cfg.m_user.c_str(), cfg.m_pwd.c_str(), cfg.m_dbname.c_str(), cfg.m_port, NULL, 0)){
+        unsigned long flags = cfg.m_multi_statements?CLIENT_MULTI_STATEMENTS:0;
+        if(!mysql_real_connect(m_conn, cfg.m_host.c_str(), cfg.m_user.c_str(), cfg.m_pwd.c_str(), cfg.m_dbname.c_str(), cfg.m_port, NULL, flags)){
             error = "failed to call mysql_real_connect, last_error=";
             error += get_last_error();
             return false;
         }
+        m_multi_stmt = cfg.m_multi_statements;
         mysql_query(m_conn, "set names utf8");
         // 重连
         //char value = 1;
@@ -45,6 +70,9 @@ namespace zdb{
     void connection::close()
     {
         stmt_close();
+        m_stmt_cache.clear();
+        m_max_packet = 0;
+        m_bulk_mode = -1;
         if(m_conn){
             mysql_close(m_conn);
             m_conn = NULL;
@@ -71,7 +99,47 @@ namespace zdb{
         return &m_res;
     }
 
+    bool connection::query_stream(const char* sql, result_set& res, std::string& error)
+    {
+        res.close();
+
+        if(!is_open()){
+            error = "not connected to database.";
+            return false;
+        }
+
+        if(mysql_query(m_conn, sql)){
+            error = "failed to call mysql_query, last_error=";
+            error += get_last_error();
+            return false;
+        }
+
+        MYSQL_RES* raw_res = mysql_use_result(m_conn);
+        if(0 == raw_res && mysql_field_count(m_conn) != 0){
+            error = "failed to call mysql_use_result, last_error=";
+            error += get_last_error();
+            return false;
+        }
+
+        return res.bind_stream(raw_res, m_conn, error);
+    }
+
     MYSQL_RES* connection::query(const char* sql, std::string& error)
+    {
+        if(!db_interceptors::active()){
+            return do_query(sql, error);
+        }
+
+        db_interceptors::scope s(db_op_query, this, sql);
+        MYSQL_RES* res = do_query(sql, error);
+        // 非查询语句成功时结果集也为0
+        bool ok = (0 != res) || (is_open() && 0 == mysql_errno(m_conn));
+        s.finish(ok, res?mysql_num_rows(res):0, error.c_str());
+
+        return res;
+    }
+
+    MYSQL_RES* connection::do_query(const char* sql, std::string& error)
     {
         if(!is_open()){
             error = "not connected to database.";
@@ -104,6 +172,21 @@ namespace zdb{
     }
 
     my_ulonglong connection::execute_real_affect_rows(const char* sql, std::string& error)
+    {
+        if(!db_interceptors::active()){
+            return do_execute(sql, error);
+        }
+
+        db_interceptors::scope s(db_op_execute, this, sql);
+        my_ulonglong rows = do_execute(sql, error);
+        // 失败时的返回值与影响行数无法区分, 按错误码判断
+        bool ok = is_open() && 0 == mysql_errno(m_conn);
+        s.finish(ok, ok?rows:0, error.c_str());
+
+        return rows;
+    }
+
+    my_ulonglong connection::do_execute(const char* sql, std::string& error)
     {
         if(!is_open()){
             error = "not connected to database.";
@@ -120,7 +203,64 @@ namespace zdb{
         return mysql_affected_rows(m_conn);
     }
 
+    bool connection::execute_batch(const char* sql, batch_result& res, std::string& error)
+    {
+        res.close();
+
+        if(!is_open()){
+            error = "not connected to database.";
+            return false;
+        }
+
+        if(!m_multi_stmt){
+            error = "multi statements are disabled, see db_setting::set_multi_statements";
+            return false;
+        }
+
+        if(mysql_real_query(m_conn, sql, strlen(sql))){
+            error = "failed to call mysql_real_query, last_error=";
+            error += get_last_error();
+            return false;
+        }
+
+        res.bind(m_conn);
+
+        return true;
+    }
+
+    bool connection::execute_batch(const std::vector<std::string>& sqls, batch_result& res, std::string& error)
+    {
+        size_t len = 0;
+        for(auto& it : sqls){
+            len += it.size() + 1;
+        }
+
+        std::string sql;
+        sql.reserve(len);
+        for(auto& it : sqls){
+            if(!sql.empty()){
+                sql += ';';
+            }
+            sql += it;
+        }
+
+        return execute_batch(sql.c_str(), res, error);
+    }
+
     int connection::ping(std::string& error)
+    {
+        if(!db_interceptors::active()){
+            return do_ping(error);
+        }
+
+        db_interceptors::scope s(db_op_ping, this, 0);
+        int ret = do_ping(error);
+        s.finish(0 == ret, 0, error.c_str());
+
+        return ret;
+    }
+
+    int connection::do_ping(std::string& error)
     {
         if(0 == m_conn){
             error = "not connected to database.";
@@ -210,7 +350,7 @@ namespace zdb{
             return false;
         }
 
-        if(mysql_stmt_execute(m_stmt) != 0){
+        if(execute_stmt(m_stmt, 0) != 0){
             error = "failed to call mysql_stmt_excute, last_error=";
             error += get_last_error();
             return false;
@@ -223,6 +363,26 @@ namespace zdb{
         return true;
     }
 
+    bool connection::stmt_open_cursor(MYSQL_BIND* binds, unsigned long prefetch_rows, std::string& error)
+    {
+        if(NULL == m_stmt){
+            error = "bind error, m_stmt = null";
+            return false;
+        }
+
+        return stmt_cursor::execute(m_stmt, binds, prefetch_rows, error);
+    }
+
+    bool connection::open_cursor(const char* sql, MYSQL_BIND* binds, unsigned long prefetch_rows, stmt_cursor& cursor, std::string& error)
+    {
+        if(!is_open()){
+            error = "not connected to database.";
+            return false;
+        }
+
+        return cursor.open(m_conn, sql, binds, prefetch_rows, error);
+    }
+
     void connection::stmt_close()
     {
         if(m_stmt){
@@ -231,6 +391,159 @@ namespace zdb{
         }
     }
 
+    MYSQL_STMT* connection::get_stmt(const char* sql, std::string& error)
+    {
+        if(!is_open()){
+            error = "not connected to database.";
+            return 0;
+        }
+
+        return m_stmt_cache.get(m_conn, sql, error);
+    }
+
+    bool connection::execute_prepared(const char* sql, MYSQL_BIND* binds, int64_t* pid, std::string& error)
+    {
+        MYSQL_STMT* stmt = get_stmt(sql, error);
+        if(NULL == stmt){
+            return false;
+        }
+
+        if(!execute_bound(stmt, sql, binds, 0, error)){
+            return false;
+        }
+
+        if(pid){
+            *pid = mysql_stmt_insert_id(stmt);
+        }
+
+        mysql_stmt_free_result(stmt);
+
+        return true;
+    }
+
+    MYSQL_STMT* connection::query_prepared(const char* sql, MYSQL_BIND* binds, std::string& error)
+    {
+        MYSQL_STMT* stmt = get_stmt(sql, error);
+        if(NULL == stmt){
+            return 0;
+        }
+
+        if(mysql_stmt_bind_param(stmt, binds) != 0){
+            error = "failed to call mysql_stmt_bind_param, last_error=";
+            error += mysql_stmt_error(stmt);
+            return 0;
+        }
+
+        if(execute_stmt(stmt, sql) != 0){
+            error = "failed to call mysql_stmt_execute, last_error=";
+            error += mysql_stmt_error(stmt);
+            if(stmt_cache::is_invalid_error(mysql_stmt_errno(stmt))){
+                m_stmt_cache.remove(sql);
+            }
+            return 0;
+        }
+
+        if(mysql_stmt_store_result(stmt) != 0){
+            error = "failed to call mysql_stmt_store_result, last_error=";
+            error += mysql_stmt_error(stmt);
+            mysql_stmt_free_result(stmt);
+            return 0;
+        }
+
+        return stmt;
+    }
+
+    bool connection::execute_bound(MYSQL_STMT* stmt, const char* sql, MYSQL_BIND* binds, my_ulonglong* affect_rows, std::string& error)
+    {
+        if(mysql_stmt_bind_param(stmt, binds) != 0){
+            error = "failed to call mysql_stmt_bind_param, last_error=";
+            error += mysql_stmt_error(stmt);
+            return false;
+        }
+
+        if(execute_stmt(stmt, sql) != 0){
+            error = "failed to call mysql_stmt_execute, last_error=";
+            error += mysql_stmt_error(stmt);
+            if(stmt_cache::is_invalid_error(mysql_stmt_errno(stmt))){
+                m_stmt_cache.remove(sql);
+            }
+            return false;
+        }
+
+        if(affect_rows){
+            *affect_rows += mysql_stmt_affected_rows(stmt);
+        }
+
+        return true;
+    }
+
+    int connection::execute_stmt(MYSQL_STMT* stmt, const char* sql)
+    {
+        if(!db_interceptors::active()){
+            return mysql_stmt_execute(stmt);
+        }
+
+        db_interceptors::scope s(db_op_stmt_execute, this, sql);
+        int ret = mysql_stmt_execute(stmt);
+        my_ulonglong rows = 0;
+        if(0 == ret && 0 == mysql_stmt_field_count(stmt)){
+            rows = mysql_stmt_affected_rows(stmt);
+        }
+        s.finish(0 == ret, rows, mysql_stmt_error(stmt));
+
+        return ret;
+    }
+
+    unsigned long connection::get_max_allowed_packet(std::string& error)
+    {
+        if(m_max_packet > 0){
+            return m_max_packet;
+        }
+
+        MYSQL_RES* res = query("select @@max_allowed_packet", error);
+        if(0 == res){
+            return 0;
+        }
+
+        MYSQL_ROW row = mysql_fetch_row(res);
+        if(row && row[0]){
+            m_max_packet = strtoul(row[0], 0, 10);
+        }
+        mysql_free_result(res);
+
+        if(0 == m_max_packet){
+            error = "failed to read max_allowed_packet";
+        }
+
+        return m_max_packet;
+    }
+
+    bool connection::is_bulk_supported()
+    {
+#ifdef ZDB_HAVE_BULK
+        if(m_bulk_mode < 0){
+            // MySQL的版本号都小于100000, MariaDB 10.2.6起支持COM_STMT_BULK_EXECUTE
+            m_bulk_mode = (is_open() && mysql_get_server_version(m_conn) >= 100206)?1:0;
+        }
+
+        return m_bulk_mode == 1;
+#else
+        return false;
+#endif
+    }
+
+    bool connection::query_prepared(const char* sql, MYSQL_BIND* binds, stmt_result_set& res, std::string& error)
+    {
+        res.close();
+
+        MYSQL_STMT* stmt = query_prepared(sql, binds, error);
+        if(NULL == stmt){
+            return false;
+        }
+
+        return res.bind(stmt, error);
+    }
+
     const char* connection::get_last_error()
     {
         if(NULL == m_conn)
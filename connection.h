@@ -24,17 +24,28 @@
 #ifndef zdb_connection_h
 #define zdb_connection_h
 #include <memory>
+#include <vector>
 #include <mysql.h>
 #include "common.h"
 #include "result_set.h"
+#include "stmt_cache.h"
+#include "stmt_binder.h"
+#include "batch_result.h"
+#include "stmt_cursor.h"
+#include "stmt_result_set.h"
+#include "interceptor.h"
 
 namespace zdb{
     class connection: public std::enable_shared_from_this<connection>{
         private:
         MYSQL* m_conn;          // 数据库连接
         MYSQL_STMT* m_stmt;     //
+        stmt_cache m_stmt_cache;// 预处理语句缓存
         result_set m_res;       // 结果集
         bool m_tmp_flag;        // 是否为临时连接
+        unsigned long m_max_packet; // 服务端max_allowed_packet, 0为未获取
+        int m_bulk_mode;        // 是否支持数组批量绑定, -1为未检测
+        bool m_multi_stmt;      // 是否以CLIENT_MULTI_STATEMENTS连接
 
         public:
         connection(bool temp = false);
@@ -73,6 +84,21 @@ namespace zdb{
 		* @bug
 		*/
         result_set* execute_query(const char* sql, std::string& error);
+        /*
+		* @brief	执行SQL语句返回流式结果集函数。
+		* @param 	[in]  const char *sql      SQL语句\n
+		* @param 	[out] result_set& res      流式结果集\n
+		* @param 	[out] std::string& error   错误信息\n
+		* @return 	返回查询是否成功
+		* @return  	false  失败\n
+		* @return  	true   成功\n
+		* @note
+		    基于mysql_use_result, 行在get_next_record时才从服务端读取, 内存占用与结果行数无关
+		* @warning
+		    res读完或关闭前连接不能执行其他语句
+		* @bug
+		*/
+        bool query_stream(const char* sql, result_set& res, std::string& error);
         /*
 		* @brief	执行SQL语句返回mysql原始结果集函数。
 		* @param 	[in]  const char *sql      SQL语句\n
@@ -109,6 +135,22 @@ namespace zdb{
 		* @bug
 		*/
         my_ulonglong execute_real_affect_rows(const char* sql, std::string& error);
+        /*
+		* @brief	一次往返执行多条SQL语句函数。
+		* @param 	[in]  const char *sql       以分号分隔的多条SQL语句\n
+		* @param 	[out] batch_result& res     逐条语句的结果\n
+		* @param 	[out] std::string& error    错误信息\n
+		* @return 	返回发送是否成功
+		* @return  	false  失败\n
+		* @return  	true   成功, 通过res.next读取每条语句的结果\n
+		* @note
+		    需要db_setting::set_multi_statements(true)
+		* @warning
+		    res读完或关闭前连接不能执行其他语句
+		* @bug
+		*/
+        bool execute_batch(const char* sql, batch_result& res, std::string& error);
+        bool execute_batch(const std::vector<std::string>& sqls, batch_result& res, std::string& error);
         /*
 		* @brief	获得最后一次插入的ID函数。
 		* @param 	[out] std::string& error  错误信息\n
@@ -190,6 +232,89 @@ namespace zdb{
 		* @bug
 		*/
         bool stmt_execute(MYSQL_BIND* binds, int64_t* pid, std::string& error);
+        /*
+		* @brief	以服务端只读游标执行stmt函数。
+		* @param 	[in]  MYSQL_BIND *binds             要执行的BIND, 无参数时为0\n
+		* @param 	[in]  unsigned long prefetch_rows   每次取回的行数\n
+		* @param 	[out] std::string& error            错误信息\n
+		* @return 	返回执行stmt成功还是失败
+		* @return  	false  失败\n
+		* @return  	true  成功\n
+		* @note
+		    作用于prepare_stmt准备的stmt, 之后通过get_stmt_handle绑定结果并mysql_stmt_fetch;
+		    每取完prefetch_rows行才访问一次服务端, 期间连接可执行其他语句
+		* @warning
+		* @bug
+		*/
+        bool stmt_open_cursor(MYSQL_BIND* binds, unsigned long prefetch_rows, std::string& error);
+        /*
+		* @brief	获得prepare_stmt准备的stmt函数。
+		* @param 	无\n
+		* @return 	返回stmt, 未准备时为0
+		* @note
+		* @warning
+		* @bug
+		*/
+        MYSQL_STMT* get_stmt_handle()
+        {
+            return m_stmt;
+        }
+        /*
+		* @brief	预处理SQL并以服务端只读游标执行函数。
+		* @param 	[in]  const char *sql               预处理查询语句\n
+		* @param 	[in]  MYSQL_BIND *binds             要执行的BIND, 无参数时为0\n
+		* @param 	[in]  unsigned long prefetch_rows   每次取回的行数\n
+		* @param 	[out] stmt_cursor& cursor           打开的游标\n
+		* @param 	[out] std::string& error            错误信息\n
+		* @return 	返回打开游标是否成功
+		* @return  	false  失败\n
+		* @return  	true  成功\n
+		* @note 	游标使用独立的stmt, 不影响m_stmt及预处理语句缓存
+		* @warning
+		* @bug
+		*/
+        bool open_cursor(const char* sql, MYSQL_BIND* binds, unsigned long prefetch_rows, stmt_cursor& cursor, std::string& error);
+        /*
+		* @brief	以服务端游标分块扫描预处理查询函数。
+		* @param 	[in]  const char *sql               预处理查询语句\n
+		* @param 	[in]  unsigned long prefetch_rows   每次取回的行数\n
+		* @param 	[in]  Fn fn                         bool(std::tuple<Ts...>& row)回调, 返回false时停止\n
+		* @param 	[out] std::string& error            错误信息\n
+		* @param 	[in]  const Args&... args           参数\n
+		* @return 	返回扫描是否成功
+		* @return  	false  失败\n
+		* @return  	true  成功\n
+		* @note
+		    conn->scan_prepared<int64_t, std::string>("select id,name from t where id>?", 1000, fn, error, 0);
+		    客户端同时只保存prefetch_rows行, 无需OFFSET分页
+		* @warning
+		* @bug
+		*/
+        template<typename... Ts, typename Fn, typename... Args>
+        bool scan_prepared(const char* sql, unsigned long prefetch_rows, Fn fn, std::string& error, const Args&... args)
+        {
+            param_binder<param_decay_t<Args>...> binder;
+            binder.set(args...);
+
+            stmt_cursor cursor;
+            if(!open_cursor(sql, binder.binds(), prefetch_rows, cursor, error)){
+                return false;
+            }
+
+            result_binder<Ts...> result;
+            if(!result.bind(cursor.get_stmt(), error)){
+                return false;
+            }
+
+            int ret = 0;
+            while((ret = result.fetch(error)) > 0){
+                if(!fn(result.row())){
+                    break;
+                }
+            }
+
+            return ret >= 0;
+        }
         /*
 		* @brief	关闭stmt函数。
 		* @param 	无\n
@@ -199,6 +324,216 @@ namespace zdb{
 		* @bug
 		*/
         void stmt_close();
+        /*
+		* @brief	从预处理语句缓存中获得stmt函数。
+		* @param 	[in]  const char *sql      预处理SQL语句\n
+		* @param 	[out] std::string& error   错误信息\n
+		* @return 	返回stmt句柄, 句柄归缓存所有, 调用者不可关闭
+		* @return  	0    失败\n
+		* @return  	!=0  成功\n
+		* @note
+		* @warning
+		* @bug
+		*/
+        MYSQL_STMT* get_stmt(const char* sql, std::string& error);
+        /*
+		* @brief	使用缓存的stmt执行预处理SQL语句函数。
+		* @param 	[in]  const char *sql      预处理SQL语句\n
+		* @param 	[in]  MYSQL_BIND *binds    要执行的BIND\n
+		* @param 	[in]  int64_t *pid         执行后获得的id\n
+		* @param 	[out] std::string& error   错误信息\n
+		* @return 	返回执行stmt成功还是失败
+		* @return  	false  失败\n
+		* @return  	true  成功\n
+		* @note
+		* @warning
+		* @bug
+		*/
+        bool execute_prepared(const char* sql, MYSQL_BIND* binds, int64_t* pid, std::string& error);
+        /*
+		* @brief	按类型绑定参数执行预处理SQL语句函数。
+		* @param 	[in]  const char *sql      预处理SQL语句\n
+		* @param 	[out] std::string& error   错误信息\n
+		* @param 	[in]  const Args&... args  参数, 类型见stmt_binder.h\n
+		* @return 	返回执行stmt成功还是失败
+		* @return  	false  失败\n
+		* @return  	true  成功\n
+		* @note
+		    MYSQL_BIND数组在编译期按参数类型生成并位于栈上, 不做堆分配
+		* @warning
+		* @bug
+		*/
+        template<typename... Args>
+        bool execute_prepared(const char* sql, std::string& error, const Args&... args)
+        {
+            param_binder<param_decay_t<Args>...> binder;
+            binder.set(args...);
+
+            return execute_prepared(sql, binder.binds(), 0, error);
+        }
+        /*
+		* @brief	使用缓存的stmt执行预处理查询函数。
+		* @param 	[in]  const char *sql      预处理SQL语句\n
+		* @param 	[in]  MYSQL_BIND *binds    要执行的BIND\n
+		* @param 	[out] std::string& error   错误信息\n
+		* @return 	返回已执行并缓存了结果的stmt, 句柄归缓存所有
+		* @return  	0    失败\n
+		* @return  	!=0  成功\n
+		* @note
+		    读取完毕后调用者需调用mysql_stmt_free_result
+		* @warning
+		* @bug
+		*/
+        MYSQL_STMT* query_prepared(const char* sql, MYSQL_BIND* binds, std::string& error);
+        /*
+		* @brief	执行预处理查询并以二进制协议结果集读取函数。
+		* @param 	[in]  const char *sql      预处理SQL语句\n
+		* @param 	[in]  MYSQL_BIND *binds    要执行的BIND\n
+		* @param 	[out] stmt_result_set& res 结果集\n
+		* @param 	[out] std::string& error   错误信息\n
+		* @return 	返回查询是否成功
+		* @return  	false  失败\n
+		* @return  	true  成功\n
+		* @note
+		    字段值以原生类型解码, 不经过文本解析
+		* @warning
+		    res在本连接再次执行同一SQL前有效
+		* @bug
+		*/
+        bool query_prepared(const char* sql, MYSQL_BIND* binds, stmt_result_set& res, std::string& error);
+        template<typename... Args>
+        bool query_prepared(const char* sql, stmt_result_set& res, std::string& error, const Args&... args)
+        {
+            param_binder<param_decay_t<Args>...> binder;
+            binder.set(args...);
+
+            return query_prepared(sql, binder.binds(), res, error);
+        }
+        /*
+		* @brief	按类型绑定参数执行预处理查询并读取全部行函数。
+		* @param 	[in]  const char *sql                      预处理SQL语句\n
+		* @param 	[out] std::vector<std::tuple<Ts...>>& rows 结果行\n
+		* @param 	[out] std::string& error                   错误信息\n
+		* @param 	[in]  const Args&... args                  参数\n
+		* @return 	返回查询是否成功
+		* @return  	false  失败\n
+		* @return  	true  成功\n
+		* @note
+		* @warning
+		* @bug
+		*/
+        template<typename... Ts, typename... Args>
+        bool query_prepared(const char* sql, std::vector<std::tuple<Ts...>>& rows, std::string& error, const Args&... args)
+        {
+            param_binder<param_decay_t<Args>...> binder;
+            binder.set(args...);
+
+            MYSQL_STMT* stmt = query_prepared(sql, binder.binds(), error);
+            if(NULL == stmt){
+                return false;
+            }
+
+            result_binder<Ts...> result;
+            bool ok = result.bind(stmt, error);
+            if(ok){
+                rows.reserve(rows.size() + (size_t)mysql_stmt_num_rows(stmt));
+
+                int ret = 0;
+                while((ret = result.fetch(error)) > 0){
+                    rows.push_back(result.row());
+                }
+                ok = (ret == 0);
+            }
+
+            mysql_stmt_free_result(stmt);
+
+            return ok;
+        }
+        /*
+		* @brief	批量执行预处理SQL语句函数。
+		* @param 	[in]  const char *sql                            预处理SQL语句\n
+		* @param 	[in]  const std::vector<std::tuple<Args...>>& rows 参数行\n
+		* @param 	[out] my_ulonglong* affect_rows                  影响到的记录数量, 可为空\n
+		* @param 	[out] std::string& error                         错误信息\n
+		* @return 	返回执行是否成功
+		* @return  	false  失败\n
+		* @return  	true  成功\n
+		* @note
+		    服务端及客户端库支持时使用MariaDB的STMT_ATTR_ARRAY_SIZE数组绑定,
+		    否则把INSERT语句扩展为多行VALUES执行。两种方式都按max_allowed_packet切分,
+		    每个分块一次往返。
+		* @warning
+		    分块之间不是原子的, 需要原子性时请在事务中调用
+		* @bug
+		*/
+        template<typename... Args>
+        bool execute_bulk(const char* sql, const std::vector<std::tuple<Args...>>& rows, my_ulonglong* affect_rows, std::string& error)
+        {
+            if(affect_rows){
+                *affect_rows = 0;
+            }
+
+            if(rows.empty()){
+                return true;
+            }
+
+            size_t max_row = 0;
+            for(auto& row : rows){
+                size_t size = row_bind_size(row);
+                max_row = (size > max_row)?size:max_row;
+            }
+
+            unsigned long packet = get_max_allowed_packet(error);
+            if(0 == packet){
+                return false;
+            }
+
+            // 预留10%给包头和语句文本, 每条语句最多65535个占位符
+            size_t chunk = (packet - packet / 10) / max_row;
+            size_t max_params = 65535 / (sizeof...(Args)?sizeof...(Args):1);
+            chunk = (chunk > max_params)?max_params:chunk;
+            chunk = (chunk > rows.size())?rows.size():chunk;
+            chunk = (chunk > 0)?chunk:1;
+
+            for(size_t begin = 0; begin < rows.size(); begin += chunk){
+                size_t count = (rows.size() - begin < chunk)?(rows.size() - begin):chunk;
+                bool ret = false;
+#ifdef ZDB_HAVE_BULK
+                if(is_bulk_supported()){
+                    ret = execute_array_chunk(sql, rows, begin, count, affect_rows, error, std::index_sequence_for<Args...>());
+                }else
+#endif
+                {
+                    ret = execute_multi_row_chunk(sql, rows, begin, count, affect_rows, error);
+                }
+
+                if(!ret){
+                    return false;
+                }
+            }
+
+            return true;
+        }
+        /*
+		* @brief	获得服务端max_allowed_packet函数。
+		* @param 	[out] std::string& error   错误信息\n
+		* @return 	返回max_allowed_packet, 同一连接只查询一次
+		* @return  	0    失败\n
+		* @return  	>0   成功\n
+		* @note
+		* @warning
+		* @bug
+		*/
+        unsigned long get_max_allowed_packet(std::string& error);
+        /*
+		* @brief	服务端是否支持数组批量绑定函数。
+		* @param 	无\n
+		* @return 	返回是否支持(MariaDB 10.2.6及以上)
+		* @note
+    	* @warning
+		* @bug
+		*/
+        bool is_bulk_supported();
         /*
 		* @brief	获得最后一次错误信息函数。
 		* @param 	无\n
@@ -208,6 +543,18 @@ namespace zdb{
 		* @bug
 		*/
         const char* get_last_error();
+		/*
+		* @brief	获得连接在服务端的线程id函数。
+		* @param 	无\n
+		* @return 	返回线程id, 未连接时为0
+		* @note 	可用于KILL QUERY取消正在执行的语句
+    	* @warning
+		* @bug
+		*/
+        unsigned long get_thread_id()
+        {
+            return m_conn?mysql_thread_id(m_conn):0;
+        }
 		/*
 		* @brief	获得连接是否为临时连接状态。
 		* @param 	无\n
@@ -243,6 +590,106 @@ namespace zdb{
         bool is_open()
         {
             return (m_conn == NULL)?false:true;
+        }
+		/*
+		* @brief	获得底层MYSQL句柄函数。
+		* @param 	无\n
+		* @return 	返回MYSQL句柄, 未连接时为0
+		* @note 	用于连接类未封装的C API, 如复制协议
+    	* @warning
+		* @bug
+		*/
+        MYSQL* get_handle()
+        {
+            return m_conn;
+        }
+
+        private:
+        // connect、query、execute_real_affect_rows和ping的实现, 公开函数在其外调用拦截器
+        bool do_connect(const zdb::db_setting& cfg, std::string& error);
+        MYSQL_RES* do_query(const char* sql, std::string& error);
+        my_ulonglong do_execute(const char* sql, std::string& error);
+        int do_ping(std::string& error);
+        /*
+		* @brief	执行stmt函数。
+		* @note 	替代mysql_stmt_execute, 有拦截器时在其外调用; sql只用于拦截器, 可以为0
+		*/
+        int execute_stmt(MYSQL_STMT* stmt, const char* sql);
+        /*
+		* @brief	执行已绑定参数的stmt并累计影响行数函数。
+		* @note 	执行失败时把stmt移出缓存
+		*/
+        bool execute_bound(MYSQL_STMT* stmt, const char* sql, MYSQL_BIND* binds, my_ulonglong* affect_rows, std::string& error);
+
+#ifdef ZDB_HAVE_BULK
+        template<typename... Args, size_t... I>
+        bool execute_array_chunk(const char* sql, const std::vector<std::tuple<Args...>>& rows, size_t begin, size_t count, my_ulonglong* affect_rows, std::string& error, std::index_sequence<I...>)
+        {
+            std::tuple<bulk_column<Args>...> columns;
+            MYSQL_BIND binds[sizeof...(Args)?sizeof...(Args):1];
+            memset(binds, 0, sizeof(binds));
+
+            int expand[] = {0, (std::get<I>(columns).reserve(count), 0)...};
+            for(size_t r = begin; r < begin + count; ++r){
+                int push[] = {0, (std::get<I>(columns).push(std::get<I>(rows[r])), 0)...};
+                (void)push;
+            }
+            int bind[] = {0, (std::get<I>(columns).bind(binds[I]), 0)...};
+            (void)expand;
+            (void)bind;
+
+            MYSQL_STMT* stmt = get_stmt(sql, error);
+            if(NULL == stmt){
+                return false;
+            }
+
+            unsigned int array_size = (unsigned int)count;
+            if(mysql_stmt_attr_set(stmt, STMT_ATTR_ARRAY_SIZE, &array_size) != 0){
+                error = "failed to call mysql_stmt_attr_set, last_error=";
+                error += mysql_stmt_error(stmt);
+                return false;
+            }
+
+            if(!execute_bound(stmt, sql, binds, affect_rows, error)){
+                return false;
+            }
+
+            // 缓存中的stmt还会被单行执行复用, 恢复数组大小
+            array_size = 0;
+            mysql_stmt_attr_set(stmt, STMT_ATTR_ARRAY_SIZE, &array_size);
+
+            return true;
+        }
+#endif
+
+        template<typename... Args>
+        bool execute_multi_row_chunk(const char* sql, const std::vector<std::tuple<Args...>>& rows, size_t begin, size_t count, my_ulonglong* affect_rows, std::string& error)
+        {
+            std::string multi_sql;
+            if(!db_helper::instance().expand_insert_values(sql, count, multi_sql)){
+                error = "bulk execution requires an INSERT ... VALUES(...) statement";
+                return false;
+            }
+
+            const size_t cols = sizeof...(Args);
+            std::unique_ptr<param_binder<Args...>[]> binders(new param_binder<Args...>[count]);
+            std::vector<MYSQL_BIND> binds(count * cols);
+            for(size_t r = 0; r < count; ++r){
+                std::apply([&binders, r](const Args&... args){
+                    binders[r].set(args...);
+                }, rows[begin + r]);
+
+                if(cols){
+                    memcpy(&binds[r * cols], binders[r].binds(), cols * sizeof(MYSQL_BIND));
+                }
+            }
+
+            MYSQL_STMT* stmt = get_stmt(multi_sql.c_str(), error);
+            if(NULL == stmt){
+                return false;
+            }
+
+            return execute_bound(stmt, multi_sql.c_str(), binds.empty()?0:binds.data(), affect_rows, error);
         }
     };
 
@@ -0,0 +1,160 @@
+#include "field_index.h"
+#include <string.h>
+
+namespace zdb{
+    field_index::field_index()
+    {
+        m_mask = 0;
+        m_shape_hash = 0;
+    }
+
+    uint64_t field_index::hash(std::string_view name)
+    {
+        uint64_t h = 14695981039346656037ULL;
+        for(unsigned char c : name){
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+
+        return h;
+    }
+
+    uint64_t field_index::shape_hash(const MYSQL_FIELD* fields, unsigned int count)
+    {
+        uint64_t h = count;
+        for(unsigned int i = 0; i < count; ++i){
+            h = (h ^ hash(std::string_view(fields[i].name, fields[i].name_length))) * 1099511628211ULL;
+        }
+
+        return h;
+    }
+
+    void field_index::build(const MYSQL_FIELD* fields, unsigned int count)
+    {
+        m_names.clear();
+        m_offsets.clear();
+        m_offsets.reserve(count + 1);
+
+        size_t total = 0;
+        for(unsigned int i = 0; i < count; ++i){
+            total += fields[i].name_length;
+        }
+        m_names.reserve(total);
+
+        for(unsigned int i = 0; i < count; ++i){
+            m_offsets.push_back((uint32_t)m_names.size());
+            m_names.append(fields[i].name, fields[i].name_length);
+        }
+        m_offsets.push_back((uint32_t)m_names.size());
+
+        // 装载率不超过1/2
+        size_t slots = 4;
+        while(slots < (size_t)count * 2){
+            slots <<= 1;
+        }
+        m_slots.assign(slots, -1);
+        m_mask = slots - 1;
+
+        for(unsigned int i = 0; i < count; ++i){
+            std::string_view name = name_at(i);
+            size_t pos = hash(name) & m_mask;
+            while(m_slots[pos] >= 0 && name_at(m_slots[pos]) != name){
+                pos = (pos + 1) & m_mask;
+            }
+
+            if(m_slots[pos] < 0){
+                m_slots[pos] = (int)i;
+            }
+        }
+
+        m_shape_hash = shape_hash(fields, count);
+    }
+
+    int field_index::find(std::string_view name) const
+    {
+        if(m_slots.empty()){
+            return -1;
+        }
+
+        size_t pos = hash(name) & m_mask;
+        while(m_slots[pos] >= 0){
+            if(name_at(m_slots[pos]) == name){
+                return m_slots[pos];
+            }
+            pos = (pos + 1) & m_mask;
+        }
+
+        return -1;
+    }
+
+    bool field_index::same_shape(const MYSQL_FIELD* fields, unsigned int count) const
+    {
+        if(size() != count){
+            return false;
+        }
+
+        for(unsigned int i = 0; i < count; ++i){
+            if(name_at(i) != std::string_view(fields[i].name, fields[i].name_length)){
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    field_index_cache::field_index_cache()
+    {
+        m_capacity = DEFAULT_FIELD_INDEX_CACHE_SIZE;
+    }
+
+    ptr_field_index field_index_cache::acquire(const MYSQL_FIELD* fields, unsigned int count)
+    {
+        uint64_t h = field_index::shape_hash(fields, count);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto range = m_index_map.equal_range(h);
+            for(auto it = range.first; it != range.second; ++it){
+                if(it->second->same_shape(fields, count)){
+                    return it->second;
+                }
+            }
+        }
+
+        // 在锁外构建, 插入前再查一次, 避免并发时重复缓存
+        std::shared_ptr<field_index> index = std::make_shared<field_index>();
+        index->build(fields, count);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto range = m_index_map.equal_range(h);
+        for(auto it = range.first; it != range.second; ++it){
+            if(it->second->same_shape(fields, count)){
+                return it->second;
+            }
+        }
+
+        if(m_capacity > 0){
+            if(m_index_map.size() >= m_capacity){
+                m_index_map.clear();
+            }
+            m_index_map.insert(std::make_pair(h, index));
+        }
+
+        return index;
+    }
+
+    void field_index_cache::set_capacity(size_t capacity)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_capacity = capacity;
+        if(m_index_map.size() > m_capacity){
+            m_index_map.clear();
+        }
+    }
+
+    void field_index_cache::clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_index_map.clear();
+    }
+}
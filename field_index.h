@@ -0,0 +1,173 @@
+/*
+* @file
+    field_index.h
+
+* @brief
+    字段名-字段下标索引类及跨查询的索引缓存
+
+* @version
+    V1.0
+
+* @author
+    agent
+
+* @date
+    2026/10/19
+
+* @note
+    field_index把全部字段名存放在一块连续内存中, 用开放寻址表按string_view查找,
+    查找时不构造std::string。field_index_cache按结果集的列结构(字段个数和各字段名)
+    缓存构建好的索引, 同一形状的查询重复执行时直接复用
+
+* @warning
+    field_index构建后只读, 可被多个结果集、多个线程共享
+* @bug
+* @copyright
+*/
+#ifndef zdb_field_index_h
+#define zdb_field_index_h
+#include <mysql.h>
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace zdb{
+    const size_t DEFAULT_FIELD_INDEX_CACHE_SIZE = 1024;    // 默认缓存的列结构个数
+
+    class field_index{
+        private:
+        std::string m_names;                // 全部字段名, 依次存放
+        std::vector<uint32_t> m_offsets;    // 第i个字段名为m_names[m_offsets[i], m_offsets[i+1])
+        std::vector<int> m_slots;           // 开放寻址表, 存字段下标, -1为空
+        size_t m_mask;                      // m_slots.size() - 1
+        uint64_t m_shape_hash;              // 列结构哈希
+
+        public:
+        field_index();
+
+        /*
+		* @brief	计算字段名哈希函数(FNV-1a)。
+		* @param 	[in]  std::string_view name  字段名\n
+		* @return 	返回哈希值
+		* @note
+		* @warning
+		* @bug
+		*/
+        static uint64_t hash(std::string_view name);
+        /*
+		* @brief	计算列结构哈希函数。
+		* @param 	[in]  MYSQL_FIELD* fields   字段数组\n
+		* @param 	[in]  unsigned int count    字段个数\n
+		* @return 	返回哈希值
+		* @note
+		* @warning
+		* @bug
+		*/
+        static uint64_t shape_hash(const MYSQL_FIELD* fields, unsigned int count);
+        /*
+		* @brief	根据字段数组构建索引函数。
+		* @param 	[in]  MYSQL_FIELD* fields   字段数组\n
+		* @param 	[in]  unsigned int count    字段个数\n
+		* @return 	无
+		* @note
+		    字段名重复时保留第一个
+		* @warning
+		* @bug
+		*/
+        void build(const MYSQL_FIELD* fields, unsigned int count);
+        /*
+		* @brief	查找字段下标函数。
+		* @param 	[in]  std::string_view name  字段名\n
+		* @return 	返回字段下标
+		* @return  	>=0  成功\n
+		* @return  	-1   不存在\n
+		* @note
+		* @warning
+		* @bug
+		*/
+        int find(std::string_view name) const;
+        /*
+		* @brief	判断索引是否与字段数组的列结构相同函数。
+		* @param 	[in]  MYSQL_FIELD* fields   字段数组\n
+		* @param 	[in]  unsigned int count    字段个数\n
+		* @return 	返回是否相同
+		* @note
+		* @warning
+		* @bug
+		*/
+        bool same_shape(const MYSQL_FIELD* fields, unsigned int count) const;
+
+        size_t size() const
+        {
+            return m_offsets.empty()?0:m_offsets.size() - 1;
+        }
+
+        uint64_t get_shape_hash() const
+        {
+            return m_shape_hash;
+        }
+
+        // 返回第idx个字段名
+        std::string_view name_at(size_t idx) const
+        {
+            return std::string_view(m_names.data() + m_offsets[idx], m_offsets[idx + 1] - m_offsets[idx]);
+        }
+    };
+
+    typedef std::shared_ptr<const field_index> ptr_field_index;
+
+    class field_index_cache{
+        public:
+            static field_index_cache& instance()
+            {
+                static field_index_cache m_cache;
+                return m_cache;
+            }
+        private:
+            field_index_cache();
+            field_index_cache(const field_index_cache&);
+            field_index_cache& operator=(const field_index_cache&);
+
+        private:
+            std::mutex m_mutex;
+            std::unordered_multimap<uint64_t, ptr_field_index> m_index_map;    // 列结构哈希-索引
+            size_t m_capacity;                                                  // 最大缓存个数
+
+        public:
+        /*
+		* @brief	获取列结构对应的索引函数, 不存在时构建并缓存。
+		* @param 	[in]  MYSQL_FIELD* fields   字段数组\n
+		* @param 	[in]  unsigned int count    字段个数\n
+		* @return 	返回索引
+		* @note
+		    线程安全; 超出容量时清空缓存, 已取得的索引不受影响
+		* @warning
+		* @bug
+		*/
+        ptr_field_index acquire(const MYSQL_FIELD* fields, unsigned int count);
+        /*
+		* @brief	设置缓存容量函数。
+		* @param 	[in]  size_t capacity  最大缓存的列结构个数, 0表示不缓存\n
+		* @return 	无
+		* @note
+		* @warning
+		* @bug
+		*/
+        void set_capacity(size_t capacity);
+        /*
+		* @brief	清空缓存函数。
+		* @param 	无\n
+		* @return 	无
+		* @note
+		* @warning
+		* @bug
+		*/
+        void clear();
+    };
+}
+
+#endif
@@ -8,8 +8,27 @@
 */
 #include "helper.h"
 #include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <algorithm>
 
 namespace zdb{
+    static bool is_word_char(char c)
+    {
+        return isalnum((unsigned char)c) || c == '_';
+    }
+
+    static bool match_keyword(const char* p, const char* keyword)
+    {
+        for(; *keyword; ++p, ++keyword){
+            if(tolower((unsigned char)*p) != *keyword){
+                return false;
+            }
+        }
+
+        return !is_word_char(*p);
+    }
+
     void db_helper::init_mysql_time(MYSQL_TIME& val)
     {
         val.year          = 0;
@@ -23,18 +42,886 @@ namespace zdb{
         val.time_type     = MYSQL_TIMESTAMP_DATETIME;
     }
 
-    void db_helper::to_datetime(const char* str, MYSQL_TIME& val)
+    // 读取n位数字, 遇到非数字返回false
+    static inline bool read_digits(const char* p, int n, unsigned int& val)
+    {
+        unsigned int v = 0;
+        for(int i = 0; i < n; ++i){
+            unsigned int d = (unsigned char)p[i] - '0';
+            if(d > 9){
+                return false;
+            }
+            v = v * 10 + d;
+        }
+
+        val = v;
+        return true;
+    }
+
+    // 读取小数秒, 不足6位补0, 超过6位截断
+    static inline bool read_fraction(const char* p, const char* end, unsigned long& val)
+    {
+        unsigned long v = 0;
+        int n = 0;
+        for(; p < end; ++p){
+            unsigned int d = (unsigned char)*p - '0';
+            if(d > 9){
+                return false;
+            }
+            if(n < 6){
+                v = v * 10 + d;
+                ++n;
+            }
+        }
+
+        for(; n < 6; ++n){
+            v *= 10;
+        }
+
+        val = v;
+        return true;
+    }
+
+    static inline char* write_2digits(char* p, unsigned int v)
+    {
+        p[0] = (char)('0' + v / 10 % 10);
+        p[1] = (char)('0' + v % 10);
+        return p + 2;
+    }
+
+    bool db_helper::to_datetime(const char* str, MYSQL_TIME& val)
+    {
+        return to_datetime(str, str?strlen(str):0, val);
+    }
+
+    bool db_helper::to_datetime(const char* str, size_t len, MYSQL_TIME& val)
+    {
+        init_mysql_time(val);
+
+        if(0 == str){
+            return false;
+        }
+
+        const char* end = str + len;
+
+        // YYYY-MM-DD[ HH:MM:SS[.ffffff]]
+        if(len >= 10 && str[4] == '-' && str[7] == '-'){
+            if(!read_digits(str, 4, val.year) || !read_digits(str + 5, 2, val.month) || !read_digits(str + 8, 2, val.day)){
+                init_mysql_time(val);
+                return false;
+            }
+
+            if(10 == len){
+                val.time_type = MYSQL_TIMESTAMP_DATE;
+                return true;
+            }
+
+            if(len < 19 || (str[10] != ' ' && str[10] != 'T') || str[13] != ':' || str[16] != ':'
+                || !read_digits(str + 11, 2, val.hour) || !read_digits(str + 14, 2, val.minute) || !read_digits(str + 17, 2, val.second)
+                || (len > 19 && (str[19] != '.' || !read_fraction(str + 20, end, val.second_part)))){
+                init_mysql_time(val);
+                return false;
+            }
+
+            val.time_type = MYSQL_TIMESTAMP_DATETIME;
+            return true;
+        }
+
+        // [-]HHH:MM:SS[.ffffff]
+        const char* p = str;
+        if(p < end && *p == '-'){
+            val.neg = true;
+            ++p;
+        }
+
+        const char* colon = (const char*)memchr(p, ':', end - p);
+        int hour_len = colon?(int)(colon - p):0;
+        if(hour_len < 1 || hour_len > 3 || end - colon < 6 || colon[3] != ':'
+            || !read_digits(p, hour_len, val.hour) || !read_digits(colon + 1, 2, val.minute) || !read_digits(colon + 4, 2, val.second)
+            || (end - colon > 6 && (colon[6] != '.' || !read_fraction(colon + 7, end, val.second_part)))){
+            init_mysql_time(val);
+            return false;
+        }
+
+        val.time_type = MYSQL_TIMESTAMP_TIME;
+        return true;
+    }
+
+    int db_helper::to_string(const MYSQL_TIME& val, char* str, int len)
+    {
+        char buf[32];
+        char* p = buf;
+
+        if(val.time_type == MYSQL_TIMESTAMP_TIME){
+            if(val.neg){
+                *p++ = '-';
+            }
+            if(val.hour >= 100){
+                *p++ = (char)('0' + val.hour / 100 % 10);
+            }
+            p = write_2digits(p, val.hour);
+        }else{
+            p = write_2digits(p, val.year / 100);
+            p = write_2digits(p, val.year);
+            *p++ = '-';
+            p = write_2digits(p, val.month);
+            *p++ = '-';
+            p = write_2digits(p, val.day);
+
+            if(val.time_type != MYSQL_TIMESTAMP_DATE){
+                *p++ = ' ';
+                p = write_2digits(p, val.hour);
+            }
+        }
+
+        if(val.time_type != MYSQL_TIMESTAMP_DATE){
+            *p++ = ':';
+            p = write_2digits(p, val.minute);
+            *p++ = ':';
+            p = write_2digits(p, val.second);
+
+            if(val.second_part > 0){
+                unsigned long us = val.second_part % 1000000;
+                *p++ = '.';
+                p = write_2digits(p, (unsigned int)(us / 10000));
+                p = write_2digits(p, (unsigned int)(us / 100));
+                p = write_2digits(p, (unsigned int)us);
+            }
+        }
+
+        int n = (int)(p - buf);
+        if(0 == str || len <= n){
+            if(str && len > 0){
+                str[0] = 0;
+            }
+            return 0;
+        }
+
+        memcpy(str, buf, n);
+        str[n] = 0;
+
+        return n;
+    }
+
+    // 公历日期与1970-01-01之间的天数互转(H. Hinnant, days_from_civil/civil_from_days)
+    static long long days_from_civil(long long y, unsigned int m, unsigned int d)
+    {
+        y -= m <= 2;
+        long long era = (y >= 0?y:y - 399) / 400;
+        unsigned int yoe = (unsigned int)(y - era * 400);
+        unsigned int doy = (153 * (m + (m > 2?-3:9)) + 2) / 5 + d - 1;
+        unsigned int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+        return era * 146097 + (long long)doe - 719468;
+    }
+
+    static void civil_from_days(long long z, unsigned int& y, unsigned int& m, unsigned int& d)
+    {
+        z += 719468;
+        long long era = (z >= 0?z:z - 146096) / 146097;
+        unsigned int doe = (unsigned int)(z - era * 146097);
+        unsigned int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        unsigned int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        unsigned int mp = (5 * doy + 2) / 153;
+
+        d = doy - (153 * mp + 2) / 5 + 1;
+        m = mp < 10?mp + 3:mp - 9;
+        y = (unsigned int)(yoe + era * 400 + (m <= 2));
+    }
+
+    bool db_helper::to_time_point(const MYSQL_TIME& val, std::chrono::system_clock::time_point& tp)
+    {
+        if(val.time_type == MYSQL_TIMESTAMP_TIME || val.month < 1 || val.month > 12){
+            return false;
+        }
+
+        long long days = days_from_civil(val.year, val.month, val.day);
+        long long secs = days * 86400 + val.hour * 3600 + val.minute * 60 + val.second;
+        std::chrono::microseconds us(secs * 1000000 + (long long)val.second_part);
+
+        tp = std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(us));
+
+        return true;
+    }
+
+    void db_helper::from_time_point(const std::chrono::system_clock::time_point& tp, MYSQL_TIME& val)
+    {
+        init_mysql_time(val);
+
+        long long us = std::chrono::duration_cast<std::chrono::microseconds>(tp.time_since_epoch()).count();
+        long long secs = (us >= 0?us:us - 999999) / 1000000;
+        long long days = (secs >= 0?secs:secs - 86399) / 86400;
+        long long rem = secs - days * 86400;
+
+        civil_from_days(days, val.year, val.month, val.day);
+        val.hour = (unsigned int)(rem / 3600);
+        val.minute = (unsigned int)(rem % 3600 / 60);
+        val.second = (unsigned int)(rem % 60);
+        val.second_part = (unsigned long)(us - secs * 1000000);
+    }
+
+    bool db_helper::expand_insert_values(const char* sql, size_t rows, std::string& out)
+    {
+        const char* values = 0;
+        char quote = 0;
+        int depth = 0;
+
+        // 找到引号及括号外的第一个VALUES关键字
+        for(const char* p = sql; *p && 0 == values; ++p){
+            if(quote){
+                if(*p == '\\' && p[1]){
+                    ++p;
+                }else if(*p == quote){
+                    quote = 0;
+                }
+                continue;
+            }
+
+            if(*p == '\'' || *p == '"' || *p == '`'){
+                quote = *p;
+                continue;
+            }
+
+            if(*p == '('){
+                ++depth;
+            }else if(*p == ')'){
+                --depth;
+            }else if(0 == depth && (p == sql || !is_word_char(p[-1])) && match_keyword(p, "values")){
+                values = p + 6;
+            }
+        }
+
+        if(0 == values){
+            return false;
+        }
+
+        const char* begin = values;
+        while(isspace((unsigned char)*begin)){
+            ++begin;
+        }
+
+        if(*begin != '('){
+            return false;
+        }
+
+        const char* end = begin;
+        depth = 0;
+        quote = 0;
+        for(; *end; ++end){
+            if(quote){
+                if(*end == '\\' && end[1]){
+                    ++end;
+                }else if(*end == quote){
+                    quote = 0;
+                }
+            }else if(*end == '\'' || *end == '"'){
+                quote = *end;
+            }else if(*end == '('){
+                ++depth;
+            }else if(*end == ')' && --depth == 0){
+                ++end;
+                break;
+            }
+        }
+
+        if(depth != 0){
+            return false;
+        }
+
+        size_t tuple_len = end - begin;
+        out.clear();
+        out.reserve(strlen(sql) + (tuple_len + 1) * (rows > 0?rows - 1:0));
+        out.append(sql, end - sql);
+        for(size_t i = 1; i < rows; ++i){
+            out += ',';
+            out.append(begin, tuple_len);
+        }
+        out.append(end);
+
+        return true;
+    }
+
+    // SQL词法单元: 单词(含反引号标识符)、标点, 跳过空白、注释和字符串常量
+    struct sql_token{
+        enum kind{ end, word, quoted_word, punct };
+        kind m_kind;
+        std::string m_text;     // 单词为小写, 标点为单个字符
+    };
+
+    static const char* skip_blank(const char* p)
+    {
+        for(;;){
+            while(isspace((unsigned char)*p)){
+                ++p;
+            }
+
+            if(*p == '#' || (p[0] == '-' && p[1] == '-' && (p[2] == 0 || isspace((unsigned char)p[2])))){
+                while(*p && *p != '\n'){
+                    ++p;
+                }
+            }else if(p[0] == '/' && p[1] == '*'){
+                const char* e = strstr(p + 2, "*/");
+                p = e?e + 2:p + strlen(p);
+            }else{
+                return p;
+            }
+        }
+    }
+
+    static const char* next_token(const char* p, sql_token& token)
+    {
+        for(;;){
+            p = skip_blank(p);
+            token.m_text.clear();
+
+            if(0 == *p){
+                token.m_kind = sql_token::end;
+                return p;
+            }
+
+            if(*p == '\'' || *p == '"'){
+                char quote = *p++;
+                for(; *p; ++p){
+                    if(*p == '\\' && p[1]){
+                        ++p;
+                    }else if(*p == quote){
+                        if(p[1] == quote){
+                            ++p;
+                        }else{
+                            ++p;
+                            break;
+                        }
+                    }
+                }
+                continue;
+            }
+
+            if(*p == '`'){
+                token.m_kind = sql_token::quoted_word;
+                for(++p; *p; ++p){
+                    if(*p == '`'){
+                        if(p[1] != '`'){
+                            ++p;
+                            break;
+                        }
+                        ++p;
+                    }
+                    token.m_text += (char)tolower((unsigned char)*p);
+                }
+                return p;
+            }
+
+            if(is_word_char(*p) || *p == '$'){
+                token.m_kind = sql_token::word;
+                for(; is_word_char(*p) || *p == '$'; ++p){
+                    token.m_text += (char)tolower((unsigned char)*p);
+                }
+                return p;
+            }
+
+            token.m_kind = sql_token::punct;
+            token.m_text = *p++;
+            return p;
+        }
+    }
+
+    void db_helper::normalize_sql(const char* sql, std::string& out)
+    {
+        out.clear();
+        if(0 == sql){
+            return;
+        }
+
+        out.reserve(strlen(sql));
+
+        char quote = 0;
+        bool space = false;
+        for(const char* p = sql; *p; ++p){
+            char c = *p;
+            if(quote){
+                out += c;
+                if(c == '\\' && p[1]){
+                    out += *++p;
+                }else if(c == quote){
+                    quote = 0;
+                }
+                continue;
+            }
+
+            if(isspace((unsigned char)c)){
+                space = true;
+                continue;
+            }
+
+            if(space && !out.empty()){
+                out += ' ';
+            }
+            space = false;
+
+            // 单行注释保留到换行符, 以免与下一行合并
+            if(c == '#' || (c == '-' && p[1] == '-' && (p[2] == 0 || isspace((unsigned char)p[2])))){
+                for(; *p && *p != '\n'; ++p){
+                    out += *p;
+                }
+                if(0 == *p){
+                    break;
+                }
+                out += '\n';
+                continue;
+            }
+
+            if(c == '\'' || c == '"' || c == '`'){
+                quote = c;
+            }
+            out += c;
+        }
+
+        while(!out.empty() && (out.back() == ';' || out.back() == ' ')){
+            out.pop_back();
+        }
+    }
+
+    enum fingerprint_char_class{
+        fp_space = 1,   // 空白
+        fp_digit = 2,   // 数字
+        fp_word  = 4,   // 标识符字符
+        fp_xdigit = 8,  // 十六进制数字
+    };
+
+    // 字符分类表, 避免逐字符调用与区域设置有关的isspace/isalnum
+    static const unsigned char* get_fingerprint_classes()
+    {
+        static unsigned char classes[256] = {0};
+        static bool inited = false;
+        if(!inited){
+            for(int c = 0; c < 256; ++c){
+                unsigned char v = 0;
+                if(c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v'){
+                    v |= fp_space;
+                }
+                if(c >= '0' && c <= '9'){
+                    v |= fp_digit | fp_word | fp_xdigit;
+                }
+                if((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == '$' || c >= 0x80){
+                    v |= fp_word;
+                }
+                if((c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')){
+                    v |= fp_xdigit;
+                }
+                classes[c] = v;
+            }
+            inited = true;
+        }
+
+        return classes;
+    }
+
+    // 输出?, 紧跟在"?,"或"?+,"之后时合并为"?+"
+    static void put_placeholder(std::string& out)
+    {
+        size_t n = out.size();
+        if(n >= 2 && out[n - 1] == ',' && (out[n - 2] == '?' || (n >= 3 && out[n - 2] == '+' && out[n - 3] == '?'))){
+            out.pop_back();
+            if(out.back() == '?'){
+                out += '+';
+            }
+            return;
+        }
+
+        out += '?';
+    }
+
+    uint64_t db_helper::fingerprint_sql(const char* sql, std::string& out)
+    {
+        static const unsigned char* classes = get_fingerprint_classes();
+        const int MAX_DEPTH = 32;
+        size_t open[MAX_DEPTH];         // 各层'('在out中的位置
+        size_t prev_start[MAX_DEPTH];   // 各层上一个闭合的(...)的起止位置
+        size_t prev_end[MAX_DEPTH];
+        int depth = 0;
+        bool space = false;
+
+        out.clear();
+        prev_end[0] = std::string::npos;
+
+        // 只在单词(含?和*)之前、单词或')'之后保留一个空格, "a = 1"与"a=1"得到相同的指纹
+        auto put_space = [&out, &space](bool word){
+            if(space && word && !out.empty()){
+                unsigned char last = (unsigned char)out.back();
+                if((classes[last] & fp_word) || last == '?' || last == '*' || last == ')'){
+                    out += ' ';
+                }
+            }
+            space = false;
+        };
+
+        for(const unsigned char* p = (const unsigned char*)(sql?sql:""); *p; ){
+            unsigned char c = *p;
+            unsigned char cls = classes[c];
+            if(cls & fp_space){
+                space = true;
+                ++p;
+                continue;
+            }
+
+            if(cls & fp_digit || (c == '.' && (classes[p[1]] & fp_digit))){
+                if(c == '0' && (p[1] == 'x' || p[1] == 'X')){
+                    for(p += 2; classes[*p] & fp_xdigit; ++p){
+                    }
+                }else{
+                    while((classes[*p] & fp_digit) || *p == '.'){
+                        ++p;
+                    }
+                    if((*p == 'e' || *p == 'E') && ((classes[p[1]] & fp_digit) || ((p[1] == '+' || p[1] == '-') && (classes[p[2]] & fp_digit)))){
+                        for(p += 2; classes[*p] & fp_digit; ++p){
+                        }
+                    }
+                }
+                put_space(true);
+                put_placeholder(out);
+                continue;
+            }
+
+            if(cls & fp_word){
+                // x'..'、b'..'、n'..'形式的常量
+                if(p[1] == '\'' && strchr("xXbBnN", c)){
+                    ++p;
+                    continue;
+                }
+
+                put_space(true);
+                for(; classes[*p] & fp_word; ++p){
+                    out += (char)((*p >= 'A' && *p <= 'Z')?*p + 32:*p);
+                }
+                continue;
+            }
+
+            if(c == '\'' || c == '"'){
+                for(++p; *p; ++p){
+                    if(*p == '\\' && p[1]){
+                        ++p;
+                    }else if(*p == c){
+                        if(p[1] != c){
+                            break;
+                        }
+                        ++p;
+                    }
+                }
+                if(*p){
+                    ++p;
+                }
+                put_space(true);
+                put_placeholder(out);
+                continue;
+            }
+
+            if(c == '`'){
+                put_space(true);
+                for(++p; *p; ++p){
+                    if(*p == '`'){
+                        if(p[1] != '`'){
+                            ++p;
+                            break;
+                        }
+                        ++p;
+                    }
+                    out += (char)((*p >= 'A' && *p <= 'Z')?*p + 32:*p);
+                }
+                continue;
+            }
+
+            if(c == '/' && p[1] == '*'){
+                const char* end = strstr((const char*)p + 2, "*/");
+                p = end?(const unsigned char*)end + 2:p + strlen((const char*)p);
+                space = true;
+                continue;
+            }
+
+            if(c == '#' || (c == '-' && p[1] == '-' && (p[2] == 0 || (classes[p[2]] & fp_space)))){
+                while(*p && *p != '\n'){
+                    ++p;
+                }
+                space = true;
+                continue;
+            }
+
+            ++p;
+            if(c == '?'){
+                put_space(true);
+                put_placeholder(out);
+                continue;
+            }
+
+            put_space(c == '*');
+            out += (char)c;
+            if(c == '('){
+                if(depth < MAX_DEPTH){
+                    open[depth] = out.size() - 1;
+                }
+                if(depth + 1 < MAX_DEPTH){
+                    prev_end[depth + 1] = std::string::npos;
+                }
+                ++depth;
+            }else if(c == ')' && depth > 0){
+                --depth;
+                if(depth >= MAX_DEPTH){
+                    continue;
+                }
+
+                // 与紧邻的上一个(...)相同时去掉",(...)", 多行VALUES只保留一行
+                size_t start = open[depth];
+                size_t len = out.size() - start;
+                if(start > 0 && prev_end[depth] == start - 1 && out[start - 1] == ','
+                    && prev_end[depth] - prev_start[depth] == len && 0 == out.compare(prev_start[depth], len, out, start, len)){
+                    out.resize(start - 1);
+                }else{
+                    prev_start[depth] = start;
+                    prev_end[depth] = out.size();
+                }
+            }
+        }
+
+        while(!out.empty() && (out.back() == ';' || out.back() == ' ')){
+            out.pop_back();
+        }
+
+        // FNV-1a
+        uint64_t hash = 14695981039346656037ULL;
+        for(char c : out){
+            hash = (hash ^ (unsigned char)c) * 1099511628211ULL;
+        }
+
+        return hash;
+    }
+
+    std::string db_helper::get_sql_verb(const char* sql)
     {
-        sscanf_s(str, "%d-%d-%d %d:%d:%d", &val.year, &val.month, &val.day, &val.hour, &val.minute, &val.second);
-        val.second_part = 0;
-        val.neg = false;
-        val.time_type = MYSQL_TIMESTAMP_DATE;
+        sql_token token;
+        const char* p = sql?sql:"";
+        do{
+            p = next_token(p, token);
+        }while(token.m_kind == sql_token::punct && token.m_text == "(");
+
+        return (token.m_kind == sql_token::word)?token.m_text:std::string();
     }
 
-    void db_helper::to_string(const MYSQL_TIME& val, char* str, int len)
+    std::string db_helper::get_main_verb(const char* sql)
     {
-        char buf[20] = {0};
-        sprintf_s(buf, "%04d-%02d-%02d %02d:%02d:%02d", val.year, val.month, val.day, val.hour, val.minute, val.second);
-        strncpy_s(str, sizeof(str), buf, len);
+        std::string verb = get_sql_verb(sql);
+        if(verb != "with"){
+            return verb;
+        }
+
+        // with [recursive] name [(列)] as (...) [, name [(列)] as (...)] 主语句
+        sql_token token;
+        const char* p = sql;
+        int depth = 0;
+        bool cte_body = false;      // 当前最外层括号是否为"as (...)"
+        bool after_cte = false;     // 刚结束一个"as (...)"
+        std::string prev = "";
+        for(p = next_token(p, token); token.m_kind != sql_token::end; p = next_token(p, token)){
+            if(token.m_kind == sql_token::punct && token.m_text == "("){
+                if(0 == depth){
+                    cte_body = (prev == "as");
+                }
+                ++depth;
+                continue;
+            }
+
+            if(token.m_kind == sql_token::punct && token.m_text == ")"){
+                if(depth > 0 && 0 == --depth){
+                    after_cte = cte_body;
+                    prev.clear();
+                }
+                continue;
+            }
+
+            if(depth > 0){
+                continue;
+            }
+
+            if(after_cte && token.m_kind == sql_token::word){
+                return token.m_text;
+            }
+
+            after_cte = false;
+            prev = (token.m_kind == sql_token::word)?token.m_text:std::string();
+        }
+
+        return verb;
+    }
+
+    void db_helper::split_statements(const char* sql, std::vector<std::string>& statements)
+    {
+        statements.clear();
+        if(0 == sql){
+            return;
+        }
+
+        sql_token token;
+        const char* begin = sql;
+        const char* p = sql;
+        int depth = 0;
+        bool empty = true;
+        for(;;){
+            p = next_token(p, token);
+            bool at_end = (token.m_kind == sql_token::end);
+            if(!at_end && token.m_kind == sql_token::punct){
+                if(token.m_text == "("){
+                    ++depth;
+                }else if(token.m_text == ")" && depth > 0){
+                    --depth;
+                }
+            }
+
+            if(at_end || (0 == depth && token.m_kind == sql_token::punct && token.m_text == ";")){
+                if(!empty){
+                    statements.emplace_back(begin, (at_end?p:p - 1) - begin);
+                }
+                if(at_end){
+                    return;
+                }
+                begin = p;
+                empty = true;
+                continue;
+            }
+
+            empty = false;
+        }
+    }
+
+    bool db_helper::is_cacheable_sql(const char* sql)
+    {
+        static const char* volatile_words[] = {
+            "sql_no_cache", "into", "now", "sysdate", "curdate", "curtime", "current_date", "current_time",
+            "current_timestamp", "localtime", "localtimestamp", "utc_date", "utc_time", "utc_timestamp",
+            "unix_timestamp", "rand", "uuid", "uuid_short", "connection_id", "last_insert_id", "found_rows",
+            "row_count", "get_lock", "sleep", "current_user", "user", "database", 0};
+
+        if(get_sql_verb(sql) != "select"){
+            return false;
+        }
+
+        sql_token token;
+        std::string prev = "";
+        const char* p = sql;
+        for(p = next_token(p, token); token.m_kind != sql_token::end; p = next_token(p, token)){
+            if(token.m_kind != sql_token::word){
+                prev.clear();
+                continue;
+            }
+
+            if((prev == "for" && (token.m_text == "update" || token.m_text == "share")) || (prev == "lock" && token.m_text == "in")){
+                return false;
+            }
+
+            for(int i = 0; volatile_words[i]; ++i){
+                if(token.m_text == volatile_words[i]){
+                    return false;
+                }
+            }
+
+            prev = token.m_text;
+        }
+
+        return true;
+    }
+
+    void db_helper::get_sql_tables(const char* sql, std::vector<std::string>& tables)
+    {
+        static const char* list_words[] = {"from", "update", "into", "table", "tables", "using", "truncate", 0};
+        static const char* stop_words[] = {"where", "set", "on", "group", "order", "limit", "having", "union",
+            "values", "value", "select", "window", "for", "to", "partition", "straight_join", 0};
+        static const char* modifier_words[] = {"low_priority", "high_priority", "delayed", "ignore", "quick",
+            "if", "not", "exists", "only", "lateral", "table", 0};
+
+        auto in_list = [](const std::string& word, const char** list){
+            for(int i = 0; list[i]; ++i){
+                if(word == list[i]){
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        tables.clear();
+        if(0 == sql){
+            return;
+        }
+
+        std::vector<int> list_depth;    // 处于表列表中的括号深度
+        int depth = 0;
+        bool expect = false;            // 下一个单词是表名
+        bool qualified = false;         // 刚读到"库名."
+        std::string prev = "";          // 上一个关键字
+        sql_token token;
+        const char* p = sql;
+
+        for(p = next_token(p, token); token.m_kind != sql_token::end; p = next_token(p, token)){
+            if(token.m_kind == sql_token::punct){
+                char c = token.m_text[0];
+                if(c == '.' && qualified){
+                    expect = true;
+                    continue;
+                }
+
+                qualified = false;
+                expect = false;
+                if(c == '('){
+                    ++depth;
+                }else if(c == ')'){
+                    --depth;
+                    while(!list_depth.empty() && list_depth.back() > depth){
+                        list_depth.pop_back();
+                    }
+                }else if(c == ',' && !list_depth.empty() && list_depth.back() == depth){
+                    expect = true;
+                }
+                continue;
+            }
+
+            bool quoted = (token.m_kind == sql_token::quoted_word);
+
+            if(expect && !quoted && in_list(token.m_text, modifier_words)){
+                continue;
+            }
+
+            if(expect){
+                // db.t中先读到db, 读到t后替换
+                if(qualified && !tables.empty()){
+                    tables.pop_back();
+                }
+                tables.push_back(token.m_text);
+                expect = false;
+                qualified = true;
+                continue;
+            }
+            qualified = false;
+
+            if(quoted){
+                prev.clear();
+                continue;
+            }
+
+            if(token.m_text == "join"){
+                expect = true;
+            }else if(token.m_text == "update" && (prev == "key" || prev == "for")){
+                // ON DUPLICATE KEY UPDATE / FOR UPDATE
+            }else if(in_list(token.m_text, list_words)){
+                expect = true;
+                if(list_depth.empty() || list_depth.back() != depth){
+                    list_depth.push_back(depth);
+                }
+            }else if(in_list(token.m_text, stop_words)){
+                if(!list_depth.empty() && list_depth.back() == depth){
+                    list_depth.pop_back();
+                }
+            }
+
+            prev = token.m_text;
+        }
+
+        std::sort(tables.begin(), tables.end());
+        tables.erase(std::unique(tables.begin(), tables.end()), tables.end());
     }
-}
\ No newline at end of file
+}
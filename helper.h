@@ -24,6 +24,10 @@
 #ifndef db_helper_h
 #define db_helper_h
 #include <mysql.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <chrono>
 
 namespace zdb{
     struct db_helper{
@@ -52,25 +56,146 @@ namespace zdb{
 		*/
         void init_mysql_time(MYSQL_TIME& val);
         /*
-	    * @brief    把MYSQL_TIME转成时间字符串转成函数。
-	    * @param    [in]  char* str         时间字符串
-	    * @param    [out] MYSQL_TIME & val  要转换的MYSQL_TIME类型的值
-	    * @return   无\n
+	    * @brief    把时间字符串转成MYSQL_TIME的函数。
+	    * @param    [in]  const char* str   时间字符串, 以0结尾
+	    * @param    [in]  size_t len        时间字符串长度
+	    * @param    [out] MYSQL_TIME & val  转换好的MYSQL_TIME类型的值
+	    * @return   返回转换是否成功
+	    * @return   true   成功\n
+	    * @return   false  格式错误, val被初始化\n
 	    * @note
+	        支持YYYY-MM-DD、YYYY-MM-DD HH:MM:SS[.ffffff]及[-]HHH:MM:SS[.ffffff],
+	        time_type分别为DATE、DATETIME和TIME。按固定位置解析, 与区域设置无关
 	    * @warning
 	    * @bug
 	    */
-        void to_datetime(const char* str, MYSQL_TIME& val);
+        bool to_datetime(const char* str, MYSQL_TIME& val);
+        bool to_datetime(const char* str, size_t len, MYSQL_TIME& val);
         /*
-	    * @brief    把时间字符串转成MYSQL_TIME的函数。
-	    * @param    [in]  MYSQL_TIME & val    转换好的MYSQL_TIME类型的值\n
+	    * @brief    把MYSQL_TIME转成时间字符串的函数。
+	    * @param    [in]  MYSQL_TIME & val    要转换的MYSQL_TIME类型的值\n
 	    * @param    [out] char* str           时间字符串\n
+	    * @param    [in]  int len             str的大小, 含结尾的0\n
+	    * @return   返回写入的字符数, 不含结尾的0; 缓冲区不足时为0\n
+	    * @note
+	        按time_type输出DATE、DATETIME或TIME格式, second_part不为0时带6位微秒;
+	        最长需要27字节
+	    * @warning
+	    * @bug
+	    */
+        int to_string(const MYSQL_TIME& val, char* str, int len);
+        /*
+	    * @brief    把MYSQL_TIME转成std::chrono时间点的函数。
+	    * @param    [in]  MYSQL_TIME & val                              按UTC解释的日期时间\n
+	    * @param    [out] std::chrono::system_clock::time_point& tp     时间点\n
+	    * @return   返回转换是否成功, TIME类型返回false\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool to_time_point(const MYSQL_TIME& val, std::chrono::system_clock::time_point& tp);
+        /*
+	    * @brief    把std::chrono时间点转成MYSQL_TIME的函数。
+	    * @param    [in]  std::chrono::system_clock::time_point& tp     时间点\n
+	    * @param    [out] MYSQL_TIME & val                              UTC日期时间, 精确到微秒\n
+	    * @return   无\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        void from_time_point(const std::chrono::system_clock::time_point& tp, MYSQL_TIME& val);
+        /*
+	    * @brief    把单行INSERT语句扩展为多行INSERT语句的函数。
+	    * @param    [in]  const char* sql   形如insert into t(a,b) values(?,?) ...的语句
+	    * @param    [in]  size_t rows       扩展后的行数
+	    * @param    [out] std::string& out  扩展后的语句
+	    * @return   返回扩展是否成功
+	    * @return   true   成功\n
+	    * @return   false  语句中没有VALUES(...)子句\n
+	    * @note
+	        VALUES之后的子句(如ON DUPLICATE KEY UPDATE)原样保留
+	    * @warning
+	    * @bug
+	    */
+        bool expand_insert_values(const char* sql, size_t rows, std::string& out);
+        /*
+	    * @brief    规范化SQL文本的函数。
+	    * @param    [in]  const char* sql   SQL语句
+	    * @param    [out] std::string& out  规范化后的语句
+	    * @return   无\n
+	    * @note
+	        引号外的连续空白合并为一个空格, 去掉首尾空白和结尾的分号, 引号内原样保留;
+	        用作查询结果缓存的键
+	    * @warning
+	    * @bug
+	    */
+        void normalize_sql(const char* sql, std::string& out);
+        /*
+	    * @brief    计算SQL指纹的函数。
+	    * @param    [in]  const char* sql   SQL语句
+	    * @param    [out] std::string& out  指纹文本
+	    * @return   返回指纹的64位哈希\n
+	    * @note
+	        一次扫描完成: 字符串、数字和十六进制常量替换为?, 连续的?,?合并为?+,
+	        重复的(...)值组只保留一组; 去掉注释、反引号和结尾的分号, 引号外转小写,
+	        空白只保留在单词之间。参数不同的同一语句得到相同的指纹, 用于按语句聚合耗时
+	    * @warning
+	    * @bug
+	    */
+        uint64_t fingerprint_sql(const char* sql, std::string& out);
+        /*
+	    * @brief    获得SQL语句的第一个关键字的函数。
+	    * @param    [in]  const char* sql   SQL语句
+	    * @return   返回小写的关键字, 如select、insert; 跳过开头的空白、注释和括号
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        std::string get_sql_verb(const char* sql);
+        /*
+	    * @brief    获得SQL语句的主语句关键字的函数。
+	    * @param    [in]  const char* sql   SQL语句
+	    * @return   返回小写的关键字; WITH语句返回公用表表达式之后的主语句关键字, 如select、update,
+	                无法识别时返回with
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        std::string get_main_verb(const char* sql);
+        /*
+	    * @brief    判断SELECT语句的结果是否可以缓存的函数。
+	    * @param    [in]  const char* sql   SQL语句
+	    * @return   返回是否可以缓存
+	    * @note
+	        不是SELECT、带锁读(FOR UPDATE/FOR SHARE/LOCK IN SHARE MODE)、SELECT ... INTO、
+	        SQL_NO_CACHE以及调用NOW()/RAND()等非确定函数的语句不可缓存
+	    * @warning
+	    * @bug
+	    */
+        bool is_cacheable_sql(const char* sql);
+        /*
+	    * @brief    提取SQL语句引用的表名的函数。
+	    * @param    [in]  const char* sql                   SQL语句
+	    * @param    [out] std::vector<std::string>& tables  小写的表名, 不含库名, 不重复
+	    * @return   无\n
+	    * @note
+	        识别FROM/JOIN/INTO/UPDATE/TABLE/USING之后的表及逗号分隔的表列表, 含子查询。
+	        只做词法分析, 宁多勿少, 用于写操作后失效查询结果缓存
+	    * @warning
+	    * @bug
+	    */
+        void get_sql_tables(const char* sql, std::vector<std::string>& tables);
+        /*
+	    * @brief    按顶层分号拆分多条SQL语句的函数。
+	    * @param    [in]  const char* sql                       SQL文本, 可含多条语句(set_multi_statements)
+	    * @param    [out] std::vector<std::string>& statements  各条语句, 不含分号, 跳过空语句
 	    * @return   无\n
 	    * @note
+	        字符串常量、注释和括号中的分号不拆分; 存储过程体等复合语句会被拆开, 只用于保守地判断写操作
 	    * @warning
 	    * @bug
 	    */
-        void to_string(const MYSQL_TIME& val, char* str, int len);
+        void split_statements(const char* sql, std::vector<std::string>& statements);
     };
 }
 
@@ -0,0 +1,83 @@
+#include "interceptor.h"
+#include <algorithm>
+
+namespace zdb{
+    std::atomic<bool> db_interceptors::m_active(false);
+    std::mutex db_interceptors::m_mtx;
+    db_interceptors::ptr_chain db_interceptors::m_chain;
+
+    db_interceptors::scope::scope(db_op op, connection* conn, const char* sql)
+        : m_chain(std::atomic_load(&db_interceptors::m_chain))
+        , m_call(op, conn, sql)
+    {
+        m_call.m_start = std::chrono::steady_clock::now();
+        if(!m_chain){
+            return;
+        }
+
+        for(size_t i = 0; i < m_chain->size(); ++i){
+            m_data[i] = 0;
+            (*m_chain)[i]->before(m_call, m_data[i]);
+        }
+    }
+
+    void db_interceptors::scope::finish(bool ok, my_ulonglong rows, const char* error)
+    {
+        m_call.m_elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_call.m_start).count();
+        m_call.m_ok = ok;
+        m_call.m_rows = rows;
+        m_call.m_error = ok?0:error;
+        if(!m_chain){
+            return;
+        }
+
+        for(size_t i = m_chain->size(); i > 0; --i){
+            (*m_chain)[i - 1]->after(m_call, m_data[i - 1]);
+        }
+    }
+
+    bool db_interceptors::add(ptr_db_interceptor interceptor)
+    {
+        if(!interceptor){
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mtx);
+        ptr_chain old = std::atomic_load(&m_chain);
+        std::shared_ptr<chain> next = old?std::make_shared<chain>(*old):std::make_shared<chain>();
+        if(next->size() >= DB_INTERCEPTOR_MAX_COUNT || std::find(next->begin(), next->end(), interceptor) != next->end()){
+            return false;
+        }
+
+        next->push_back(interceptor);
+        std::atomic_store(&m_chain, ptr_chain(next));
+        m_active = true;
+
+        return true;
+    }
+
+    void db_interceptors::remove(ptr_db_interceptor interceptor)
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        ptr_chain old = std::atomic_load(&m_chain);
+        if(!old){
+            return;
+        }
+
+        std::shared_ptr<chain> next = std::make_shared<chain>(*old);
+        next->erase(std::remove(next->begin(), next->end(), interceptor), next->end());
+        if(next->empty()){
+            m_active = false;
+            std::atomic_store(&m_chain, ptr_chain());
+        }else{
+            std::atomic_store(&m_chain, ptr_chain(next));
+        }
+    }
+
+    void db_interceptors::clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_active = false;
+        std::atomic_store(&m_chain, ptr_chain());
+    }
+}
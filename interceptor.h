@@ -0,0 +1,176 @@
+/*
+* @file
+    interceptor.h
+
+* @brief
+    连接操作拦截器
+
+* @version
+    V1.0
+
+* @author
+    agent
+
+* @date
+    2026/10/19
+
+* @note
+    在connection的connect、ping、query、execute_real_affect_rows和预处理语句执行前后
+    依次调用已注册的拦截器, 用于接入链路追踪、指标和审计而不修改连接池代码。
+    before按注册顺序调用, after按相反顺序调用; 拦截器可在before中通过data保存span等数据,
+    在after中取回。
+
+    没有注册拦截器时每个操作只多一次原子读和一个可预测的分支;
+    定义ZDB_DISABLE_INTERCEPTORS时db_interceptors::active()为常量false, 拦截代码被完全消除。
+
+    class audit: public zdb::db_interceptor{
+        void after(const zdb::db_call& call, void* data) override { ... }
+    };
+    zdb::db_interceptors::add(std::make_shared<audit>());
+
+* @warning
+    拦截器在执行操作的线程中同步调用, 须线程安全且不抛出异常
+* @bug
+* @copyright
+*/
+#ifndef zdb_interceptor_h
+#define zdb_interceptor_h
+#include <mysql.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace zdb{
+    class connection;
+
+    const size_t DB_INTERCEPTOR_MAX_COUNT = 8;     // 最多注册的拦截器数
+
+    enum db_op{
+        db_op_connect      = 0,    // connection::connect
+        db_op_ping         = 1,    // connection::ping
+        db_op_query        = 2,    // connection::query
+        db_op_execute      = 3,    // connection::execute_real_affect_rows
+        db_op_stmt_execute = 4,    // 预处理语句执行, 含stmt_execute、execute_prepared、query_prepared和execute_bulk
+    };
+
+    // 一次被拦截的操作
+    struct db_call{
+        db_op m_op;                                     // 操作
+        connection* m_conn;                             // 执行操作的连接
+        const char* m_sql;                              // SQL语句, connect/ping及stmt_execute为0
+        std::chrono::steady_clock::time_point m_start;  // 开始时间
+        uint64_t m_elapsed_us;                          // 耗时(微秒), after时有效
+        bool m_ok;                                      // 是否成功, after时有效
+        my_ulonglong m_rows;                            // 结果集行数或影响行数, after时有效
+        const char* m_error;                            // 失败时的错误信息, 成功时为0
+
+        db_call(db_op op, connection* conn, const char* sql)
+            : m_op(op), m_conn(conn), m_sql(sql), m_elapsed_us(0), m_ok(false), m_rows(0), m_error(0)
+        {}
+    };
+
+    class db_interceptor{
+        public:
+        virtual ~db_interceptor(){}
+
+        /*
+		* @brief	操作执行前调用函数。
+		* @param 	[in]  const db_call& call   操作\n
+		* @param 	[out] void*& data           本拦截器的数据, 原样传给after, 初值为0\n
+		* @return 	无
+		* @note
+		* @warning
+		* @bug
+		*/
+        virtual void before(const db_call&, void*&)
+        {
+        }
+        /*
+		* @brief	操作执行后调用函数。
+		* @param 	[in]  const db_call& call   操作, 含耗时、结果和错误\n
+		* @param 	[in]  void* data            before中保存的数据\n
+		* @return 	无
+		* @note
+		* @warning
+		* @bug
+		*/
+        virtual void after(const db_call&, void*)
+        {
+        }
+    };
+
+    typedef std::shared_ptr<db_interceptor> ptr_db_interceptor;
+
+    /*
+    * @brief
+        全局拦截器链。注册和移除时整体替换链的快照, 正在执行的操作使用旧快照。
+    */
+    class db_interceptors{
+        private:
+        typedef std::vector<ptr_db_interceptor> chain;
+        typedef std::shared_ptr<const chain> ptr_chain;
+
+        static std::atomic<bool> m_active;  // 是否有拦截器
+        static std::mutex m_mtx;            // 保护注册和移除
+        static ptr_chain m_chain;           // 拦截器链的快照, 通过std::atomic_load读取
+
+        public:
+        /*
+		* @brief	一次被拦截的操作的作用域。
+		* @note
+		    构造时调用before, finish时计时并调用after
+		*/
+        class scope{
+            private:
+            ptr_chain m_chain;
+            void* m_data[DB_INTERCEPTOR_MAX_COUNT];
+
+            scope(const scope&);
+            scope& operator=(const scope&);
+
+            public:
+            db_call m_call;
+
+            scope(db_op op, connection* conn, const char* sql);
+            /*
+			* @brief	操作完成函数。
+			* @param 	[in]  bool ok               是否成功\n
+			* @param 	[in]  my_ulonglong rows     结果集行数或影响行数\n
+			* @param 	[in]  const char* error     失败时的错误信息\n
+			* @return 	无
+			* @note
+			* @warning
+			* @bug
+			*/
+            void finish(bool ok, my_ulonglong rows, const char* error);
+        };
+
+        // 返回是否有拦截器, 操作执行前用此判断是否进入拦截路径
+        static bool active()
+        {
+#ifdef ZDB_DISABLE_INTERCEPTORS
+            return false;
+#else
+            return m_active.load(std::memory_order_relaxed);
+#endif
+        }
+
+        /*
+		* @brief	注册拦截器函数。
+		* @param 	[in]  ptr_db_interceptor interceptor  拦截器\n
+		* @return 	返回是否成功, 已注册或超过DB_INTERCEPTOR_MAX_COUNT时失败
+		* @note
+		    对之后开始的操作生效
+		* @warning
+		* @bug
+		*/
+        static bool add(ptr_db_interceptor interceptor);
+        static void remove(ptr_db_interceptor interceptor);
+        static void clear();
+    };
+}
+
+#endif
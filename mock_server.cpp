@@ -0,0 +1,1084 @@
+#include "mock_server.h"
+#include "helper.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <chrono>
+#include <map>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace zdb{
+    // 握手时声明的能力
+    static const uint32_t MOCK_CLIENT_LONG_PASSWORD     = 0x00000001;
+    static const uint32_t MOCK_CLIENT_FOUND_ROWS        = 0x00000002;
+    static const uint32_t MOCK_CLIENT_LONG_FLAG         = 0x00000004;
+    static const uint32_t MOCK_CLIENT_CONNECT_WITH_DB   = 0x00000008;
+    static const uint32_t MOCK_CLIENT_PROTOCOL_41       = 0x00000200;
+    static const uint32_t MOCK_CLIENT_TRANSACTIONS      = 0x00002000;
+    static const uint32_t MOCK_CLIENT_SECURE_CONNECTION = 0x00008000;
+    static const uint32_t MOCK_CLIENT_MULTI_STATEMENTS  = 0x00010000;
+    static const uint32_t MOCK_CLIENT_MULTI_RESULTS     = 0x00020000;
+    static const uint32_t MOCK_CLIENT_PS_MULTI_RESULTS  = 0x00040000;
+    static const uint32_t MOCK_CLIENT_PLUGIN_AUTH       = 0x00080000;
+    static const uint32_t MOCK_CLIENT_CONNECT_ATTRS     = 0x00100000;
+    static const uint32_t MOCK_CLIENT_PLUGIN_AUTH_LENENC = 0x00200000;
+
+    static const uint32_t MOCK_SERVER_CAPABILITIES = MOCK_CLIENT_LONG_PASSWORD | MOCK_CLIENT_FOUND_ROWS | MOCK_CLIENT_LONG_FLAG
+        | MOCK_CLIENT_CONNECT_WITH_DB | MOCK_CLIENT_PROTOCOL_41 | MOCK_CLIENT_TRANSACTIONS | MOCK_CLIENT_SECURE_CONNECTION
+        | MOCK_CLIENT_MULTI_STATEMENTS | MOCK_CLIENT_MULTI_RESULTS | MOCK_CLIENT_PS_MULTI_RESULTS | MOCK_CLIENT_PLUGIN_AUTH
+        | MOCK_CLIENT_CONNECT_ATTRS | MOCK_CLIENT_PLUGIN_AUTH_LENENC;
+
+    static const uint16_t MOCK_STATUS_AUTOCOMMIT = 0x0002;
+    static const uint16_t MOCK_STATUS_MORE_RESULTS = 0x0008;
+
+    static const size_t MOCK_MAX_PACKET = 0xffffff;
+    static const char* MOCK_AUTH_PLUGIN = "mysql_native_password";
+
+    enum mock_command{
+        MOCK_COM_QUIT          = 0x01,
+        MOCK_COM_INIT_DB       = 0x02,
+        MOCK_COM_QUERY         = 0x03,
+        MOCK_COM_PING          = 0x0e,
+        MOCK_COM_STMT_PREPARE  = 0x16,
+        MOCK_COM_STMT_EXECUTE  = 0x17,
+        MOCK_COM_STMT_SEND_LONG_DATA = 0x18,
+        MOCK_COM_STMT_CLOSE    = 0x19,
+        MOCK_COM_STMT_RESET    = 0x1a,
+        MOCK_COM_SET_OPTION    = 0x1b,
+        MOCK_COM_RESET_CONNECTION = 0x1f,
+        MOCK_COM_STMT_BULK_EXECUTE = 0xfa,
+    };
+
+    struct mock_stmt{
+        std::string m_sql;              // 预处理语句
+        uint16_t m_param_count;         // 参数个数
+    };
+
+    struct mock_server::session{
+        int m_fd;
+        uint32_t m_id;
+        uint8_t m_seq;                                  // 下一个包的序号
+        uint32_t m_commands;                            // 已处理的命令数
+        std::map<uint32_t, mock_stmt> m_stmts;          // 预处理语句
+        uint32_t m_next_stmt_id;
+        std::thread m_thread;
+        std::atomic<bool> m_done;
+
+        session(int fd, uint32_t id)
+            : m_fd(fd), m_id(id), m_seq(0), m_commands(0), m_next_stmt_id(1), m_done(false)
+        {}
+    };
+
+    static void put_int(std::string& out, uint64_t val, int bytes)
+    {
+        for(int i = 0; i < bytes; ++i){
+            out += (char)((val >> (8 * i)) & 0xff);
+        }
+    }
+
+    static void put_lenenc(std::string& out, uint64_t val)
+    {
+        if(val < 251){
+            put_int(out, val, 1);
+        }else if(val < (1 << 16)){
+            out += (char)0xfc;
+            put_int(out, val, 2);
+        }else if(val < (1 << 24)){
+            out += (char)0xfd;
+            put_int(out, val, 3);
+        }else{
+            out += (char)0xfe;
+            put_int(out, val, 8);
+        }
+    }
+
+    static void put_lenenc_str(std::string& out, const std::string& str)
+    {
+        put_lenenc(out, str.size());
+        out += str;
+    }
+
+    static uint64_t get_int(const std::string& in, size_t& pos, int bytes)
+    {
+        uint64_t val = 0;
+        for(int i = 0; i < bytes && pos < in.size(); ++i, ++pos){
+            val |= (uint64_t)(unsigned char)in[pos] << (8 * i);
+        }
+
+        return val;
+    }
+
+    static uint64_t get_lenenc(const std::string& in, size_t& pos)
+    {
+        if(pos >= in.size()){
+            return 0;
+        }
+
+        unsigned char c = (unsigned char)in[pos++];
+        if(c < 251){
+            return c;
+        }else if(0xfc == c){
+            return get_int(in, pos, 2);
+        }else if(0xfd == c){
+            return get_int(in, pos, 3);
+        }else if(0xfe == c){
+            return get_int(in, pos, 8);
+        }
+
+        return 0;
+    }
+
+    static std::string get_cstr(const std::string& in, size_t& pos)
+    {
+        size_t end = in.find('\0', pos);
+        if(std::string::npos == end){
+            end = in.size();
+        }
+
+        std::string str = in.substr(pos, end - pos);
+        pos = (end < in.size())?end + 1:end;
+
+        return str;
+    }
+
+    static bool send_all(int fd, const char* buf, size_t len)
+    {
+        while(len > 0){
+            ssize_t n = ::send(fd, buf, len, MSG_NOSIGNAL);
+            if(n < 0 && EINTR == errno){
+                continue;
+            }
+            if(n <= 0){
+                return false;
+            }
+            buf += n;
+            len -= (size_t)n;
+        }
+
+        return true;
+    }
+
+    static bool recv_all(int fd, char* buf, size_t len)
+    {
+        while(len > 0){
+            ssize_t n = ::recv(fd, buf, len, 0);
+            if(n < 0 && EINTR == errno){
+                continue;
+            }
+            if(n <= 0){
+                return false;
+            }
+            buf += n;
+            len -= (size_t)n;
+        }
+
+        return true;
+    }
+
+    /*
+	* @brief	发送一个逻辑包函数。
+	* @param 	[in]  int fd                    套接字\n
+	* @param 	[in]  uint8_t& seq              包序号, 发送后递增\n
+	* @param 	[in]  const std::string& payload    包内容\n
+	* @return 	返回是否成功
+	* @note
+	    超过16M的包按协议拆分
+	* @warning
+	* @bug
+	*/
+    static bool write_packet(int fd, uint8_t& seq, const std::string& payload)
+    {
+        size_t pos = 0;
+        for(;;){
+            size_t len = std::min(MOCK_MAX_PACKET, payload.size() - pos);
+            char header[4] = {(char)(len & 0xff), (char)((len >> 8) & 0xff), (char)((len >> 16) & 0xff), (char)seq++};
+            if(!send_all(fd, header, 4) || !send_all(fd, payload.data() + pos, len)){
+                return false;
+            }
+
+            pos += len;
+            if(len < MOCK_MAX_PACKET){
+                return true;
+            }
+        }
+    }
+
+    static bool read_packet(int fd, uint8_t& seq, std::string& payload)
+    {
+        payload.clear();
+        for(;;){
+            unsigned char header[4];
+            if(!recv_all(fd, (char*)header, 4)){
+                return false;
+            }
+
+            size_t len = header[0] | (header[1] << 8) | (header[2] << 16);
+            seq = header[3] + 1;
+
+            size_t old = payload.size();
+            payload.resize(old + len);
+            if(len > 0 && !recv_all(fd, &payload[old], len)){
+                return false;
+            }
+
+            if(len < MOCK_MAX_PACKET){
+                return true;
+            }
+        }
+    }
+
+    static std::string make_ok(uint64_t affected_rows, uint64_t insert_id, uint16_t status)
+    {
+        std::string out(1, '\0');
+        put_lenenc(out, affected_rows);
+        put_lenenc(out, insert_id);
+        put_int(out, status, 2);
+        put_int(out, 0, 2);
+
+        return out;
+    }
+
+    static std::string make_err(unsigned int code, const std::string& msg)
+    {
+        std::string out(1, (char)0xff);
+        put_int(out, code, 2);
+        out += "#HY000";
+        out += msg;
+
+        return out;
+    }
+
+    static std::string make_eof(uint16_t status)
+    {
+        std::string out(1, (char)0xfe);
+        put_int(out, 0, 2);
+        put_int(out, status, 2);
+
+        return out;
+    }
+
+    static bool is_numeric_type(enum_field_types type)
+    {
+        switch(type){
+            case MYSQL_TYPE_TINY:
+            case MYSQL_TYPE_SHORT:
+            case MYSQL_TYPE_LONG:
+            case MYSQL_TYPE_INT24:
+            case MYSQL_TYPE_LONGLONG:
+            case MYSQL_TYPE_FLOAT:
+            case MYSQL_TYPE_DOUBLE:
+            case MYSQL_TYPE_YEAR:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    static std::string make_column_def(const mock_column& col)
+    {
+        bool numeric = is_numeric_type(col.m_type);
+        bool real = (MYSQL_TYPE_FLOAT == col.m_type || MYSQL_TYPE_DOUBLE == col.m_type);
+
+        std::string out = "";
+        put_lenenc_str(out, "def");
+        put_lenenc_str(out, "");
+        put_lenenc_str(out, "");
+        put_lenenc_str(out, "");
+        put_lenenc_str(out, col.m_name);
+        put_lenenc_str(out, col.m_name);
+        put_lenenc(out, 0x0c);
+        put_int(out, numeric?63:255, 2);             // binary或utf8mb4
+        put_int(out, numeric?21:1024, 4);            // 显示长度
+        put_int(out, (uint64_t)col.m_type, 1);
+        put_int(out, numeric?(0x0080 | 0x8000):0, 2);   // BINARY_FLAG | NUM_FLAG
+        put_int(out, real?0x1f:0, 1);
+        put_int(out, 0, 2);
+
+        return out;
+    }
+
+    /*
+	* @brief	把文本值按字段类型编码为二进制协议值函数。
+	* @param 	[out] std::string& out          输出\n
+	* @param 	[in]  enum_field_types type     字段类型\n
+	* @param 	[in]  const std::string& val    文本值\n
+	* @return 	无
+	* @note
+	* @warning
+	* @bug
+	*/
+    static void put_binary_value(std::string& out, enum_field_types type, const std::string& val)
+    {
+        switch(type){
+            case MYSQL_TYPE_TINY:
+                put_int(out, (uint64_t)strtoll(val.c_str(), 0, 10), 1);
+                break;
+            case MYSQL_TYPE_SHORT:
+            case MYSQL_TYPE_YEAR:
+                put_int(out, (uint64_t)strtoll(val.c_str(), 0, 10), 2);
+                break;
+            case MYSQL_TYPE_LONG:
+            case MYSQL_TYPE_INT24:
+                put_int(out, (uint64_t)strtoll(val.c_str(), 0, 10), 4);
+                break;
+            case MYSQL_TYPE_LONGLONG:
+                put_int(out, (uint64_t)strtoll(val.c_str(), 0, 10), 8);
+                break;
+            case MYSQL_TYPE_FLOAT:{
+                float f = strtof(val.c_str(), 0);
+                out.append((const char*)&f, sizeof(f));
+                break;
+            }
+            case MYSQL_TYPE_DOUBLE:{
+                double d = strtod(val.c_str(), 0);
+                out.append((const char*)&d, sizeof(d));
+                break;
+            }
+            case MYSQL_TYPE_DATE:
+            case MYSQL_TYPE_DATETIME:
+            case MYSQL_TYPE_TIMESTAMP:{
+                MYSQL_TIME t;
+                memset(&t, 0, sizeof(t));
+                db_helper::instance().to_datetime(val.c_str(), val.size(), t);
+                out += (char)(t.second_part?11:7);
+                put_int(out, t.year, 2);
+                put_int(out, t.month, 1);
+                put_int(out, t.day, 1);
+                put_int(out, t.hour, 1);
+                put_int(out, t.minute, 1);
+                put_int(out, t.second, 1);
+                if(t.second_part){
+                    put_int(out, t.second_part, 4);
+                }
+                break;
+            }
+            case MYSQL_TYPE_TIME:{
+                MYSQL_TIME t;
+                memset(&t, 0, sizeof(t));
+                db_helper::instance().to_datetime(val.c_str(), val.size(), t);
+                out += (char)(t.second_part?12:8);
+                put_int(out, t.neg?1:0, 1);
+                put_int(out, t.hour / 24, 4);
+                put_int(out, t.hour % 24, 1);
+                put_int(out, t.minute, 1);
+                put_int(out, t.second, 1);
+                if(t.second_part){
+                    put_int(out, t.second_part, 4);
+                }
+                break;
+            }
+            default:
+                put_lenenc_str(out, val);
+                break;
+        }
+    }
+
+    static std::string to_lower_sql(const std::string& sql)
+    {
+        std::string out = "";
+        db_helper::instance().normalize_sql(sql.c_str(), out);
+        for(auto& c : out){
+            c = (char)tolower((unsigned char)c);
+        }
+
+        return out;
+    }
+
+    // 按不在引号中的';'拆分多条语句
+    static void split_statements(const std::string& sql, std::vector<std::string>& out)
+    {
+        std::string cur = "";
+        char quote = 0;
+        for(size_t i = 0; i < sql.size(); ++i){
+            char c = sql[i];
+            if(quote){
+                if('\\' == c && i + 1 < sql.size()){
+                    cur += c;
+                    c = sql[++i];
+                }else if(c == quote){
+                    quote = 0;
+                }
+            }else if('\'' == c || '"' == c || '`' == c){
+                quote = c;
+            }else if(';' == c){
+                if(cur.find_first_not_of(" \t\r\n") != std::string::npos){
+                    out.push_back(cur);
+                }
+                cur.clear();
+                continue;
+            }
+            cur += c;
+        }
+
+        if(cur.find_first_not_of(" \t\r\n") != std::string::npos || out.empty()){
+            out.push_back(cur);
+        }
+    }
+
+    static uint16_t count_params(const std::string& sql)
+    {
+        uint16_t count = 0;
+        char quote = 0;
+        for(size_t i = 0; i < sql.size(); ++i){
+            char c = sql[i];
+            if(quote){
+                if('\\' == c){
+                    ++i;
+                }else if(c == quote){
+                    quote = 0;
+                }
+            }else if('\'' == c || '"' == c || '`' == c){
+                quote = c;
+            }else if('?' == c){
+                ++count;
+            }
+        }
+
+        return count;
+    }
+
+    mock_rule::mock_rule(const std::string& pattern)
+        : m_pattern(to_lower_sql(pattern))
+        , m_error_code(0)
+        , m_affected_rows(0)
+        , m_insert_id(0)
+        , m_delay_ms(0)
+    {
+    }
+
+    mock_server::mock_server()
+        : m_rng(0)
+        , m_listen_fd(-1)
+        , m_port(0)
+        , m_running(false)
+        , m_next_conn_id(1)
+        , m_connections(0)
+        , m_commands(0)
+        , m_queries(0)
+        , m_dropped(0)
+        , m_disconnects(0)
+        , m_refused(0)
+    {
+    }
+
+    mock_server::~mock_server()
+    {
+        stop();
+    }
+
+    void mock_server::add_rule(const mock_rule& rule)
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_rules.push_back(rule);
+    }
+
+    void mock_server::clear_rules()
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_rules.clear();
+    }
+
+    void mock_server::set_fault(const mock_fault& fault, uint64_t seed)
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_fault = fault;
+        m_rng.seed(seed);
+    }
+
+    bool mock_server::load_script(const char* path, std::string& error)
+    {
+        static const std::map<std::string, enum_field_types> types = {
+            {"tiny", MYSQL_TYPE_TINY}, {"short", MYSQL_TYPE_SHORT}, {"long", MYSQL_TYPE_LONG},
+            {"longlong", MYSQL_TYPE_LONGLONG}, {"float", MYSQL_TYPE_FLOAT}, {"double", MYSQL_TYPE_DOUBLE},
+            {"string", MYSQL_TYPE_VAR_STRING}, {"blob", MYSQL_TYPE_BLOB}, {"date", MYSQL_TYPE_DATE},
+            {"datetime", MYSQL_TYPE_DATETIME}, {"time", MYSQL_TYPE_TIME}, {"decimal", MYSQL_TYPE_NEWDECIMAL},
+        };
+
+        FILE* fp = fopen(path, "r");
+        if(0 == fp){
+            error = "failed to open script file: ";
+            error += path;
+            return false;
+        }
+
+        std::vector<mock_rule> rules;
+        char buf[65536];
+        int line_no = 0;
+        bool ret = true;
+        while(ret && fgets(buf, sizeof(buf), fp)){
+            ++line_no;
+            std::string line = buf;
+            while(!line.empty() && ('\n' == line.back() || '\r' == line.back())){
+                line.pop_back();
+            }
+
+            size_t sp = line.find(' ');
+            std::string cmd = line.substr(0, sp);
+            std::string arg = (std::string::npos == sp)?"":line.substr(sp + 1);
+            if(cmd.empty() || '#' == cmd[0]){
+                continue;
+            }
+
+            if("match" == cmd){
+                rules.push_back(mock_rule(arg));
+                continue;
+            }
+
+            if(rules.empty()){
+                error = "script line " + std::to_string(line_no) + ": expected match";
+                ret = false;
+                break;
+            }
+
+            mock_rule& rule = rules.back();
+            if("column" == cmd){
+                size_t pos = arg.find(' ');
+                auto fi = types.find((std::string::npos == pos)?"":arg.substr(pos + 1));
+                if(fi == types.end()){
+                    error = "script line " + std::to_string(line_no) + ": unknown column type";
+                    ret = false;
+                    break;
+                }
+                rule.column(arg.substr(0, pos), fi->second);
+            }else if("row" == cmd){
+                std::vector<std::optional<std::string>> vals;
+                size_t start = 0;
+                for(;;){
+                    size_t tab = arg.find('\t', start);
+                    std::string val = arg.substr(start, (std::string::npos == tab)?std::string::npos:tab - start);
+                    vals.push_back(("\\N" == val)?std::optional<std::string>():std::optional<std::string>(val));
+                    if(std::string::npos == tab){
+                        break;
+                    }
+                    start = tab + 1;
+                }
+                rule.row(vals);
+            }else if("error" == cmd){
+                char* end = 0;
+                unsigned long code = strtoul(arg.c_str(), &end, 10);
+                rule.error((unsigned int)code, (*end == ' ')?end + 1:end);
+            }else if("ok" == cmd){
+                char* end = 0;
+                unsigned long long affected_rows = strtoull(arg.c_str(), &end, 10);
+                rule.ok(affected_rows, strtoull(end, 0, 10));
+            }else if("delay" == cmd){
+                rule.delay((unsigned int)strtoul(arg.c_str(), 0, 10));
+            }else{
+                error = "script line " + std::to_string(line_no) + ": unknown command " + cmd;
+                ret = false;
+            }
+        }
+        fclose(fp);
+
+        if(!ret){
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_rules.insert(m_rules.end(), rules.begin(), rules.end());
+
+        return true;
+    }
+
+    bool mock_server::start(const char* host, unsigned short port, std::string& error)
+    {
+        if(m_running){
+            error = "mock server is already running.";
+            return false;
+        }
+
+        m_listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if(m_listen_fd < 0){
+            error = "failed to create socket.";
+            return false;
+        }
+
+        int on = 1;
+        setsockopt(m_listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        if(inet_pton(AF_INET, (host && *host)?host:"127.0.0.1", &addr.sin_addr) != 1){
+            ::close(m_listen_fd);
+            m_listen_fd = -1;
+            error = "invalid listen address.";
+            return false;
+        }
+
+        socklen_t len = sizeof(addr);
+        if(::bind(m_listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(m_listen_fd, 128) != 0
+            || getsockname(m_listen_fd, (struct sockaddr*)&addr, &len) != 0){
+            error = "failed to listen, errno=" + std::to_string(errno);
+            ::close(m_listen_fd);
+            m_listen_fd = -1;
+            return false;
+        }
+
+        m_port = ntohs(addr.sin_port);
+        m_running = true;
+        m_accept_thread = std::thread(&mock_server::accept_thread_func, this);
+
+        return true;
+    }
+
+    void mock_server::stop()
+    {
+        if(!m_running){
+            return;
+        }
+
+        m_running = false;
+        ::shutdown(m_listen_fd, SHUT_RDWR);
+        if(m_accept_thread.joinable()){
+            m_accept_thread.join();
+        }
+        ::close(m_listen_fd);
+        m_listen_fd = -1;
+
+        // 已结束会话的描述符已关闭, 可能被进程内其他套接字重用, 须在锁内跳过
+        std::list<std::shared_ptr<session>> sessions;
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            sessions.swap(m_sessions);
+            for(auto& s : sessions){
+                if(!s->m_done){
+                    ::shutdown(s->m_fd, SHUT_RDWR);
+                }
+            }
+        }
+
+        for(auto& s : sessions){
+            if(s->m_thread.joinable()){
+                s->m_thread.join();
+            }
+        }
+    }
+
+    void mock_server::disconnect_all()
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        for(auto& s : m_sessions){
+            if(!s->m_done){
+                ::shutdown(s->m_fd, SHUT_RDWR);
+            }
+        }
+    }
+
+    mock_server_stats mock_server::get_stats() const
+    {
+        mock_server_stats stats;
+        stats.m_connections = m_connections;
+        stats.m_commands = m_commands;
+        stats.m_queries = m_queries;
+        stats.m_dropped = m_dropped;
+        stats.m_disconnects = m_disconnects;
+        stats.m_refused = m_refused;
+
+        return stats;
+    }
+
+    void mock_server::accept_thread_func()
+    {
+        while(m_running){
+            int fd = ::accept(m_listen_fd, 0, 0);
+            if(fd < 0){
+                if(EINTR == errno || ECONNABORTED == errno){
+                    continue;
+                }
+                break;
+            }
+
+            int on = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+            ++m_connections;
+
+            std::shared_ptr<session> s = std::make_shared<session>(fd, m_next_conn_id++);
+
+            std::lock_guard<std::mutex> lock(m_mtx);
+
+            // 回收已结束的会话
+            for(auto it = m_sessions.begin(); it != m_sessions.end();){
+                if((*it)->m_done){
+                    (*it)->m_thread.join();
+                    it = m_sessions.erase(it);
+                }else{
+                    ++it;
+                }
+            }
+
+            m_sessions.push_back(s);
+            s->m_thread = std::thread(&mock_server::session_thread_func, this, s);
+        }
+    }
+
+    void mock_server::session_thread_func(std::shared_ptr<session> s)
+    {
+        if(handshake(*s)){
+            std::string packet = "";
+            while(m_running && read_packet(s->m_fd, s->m_seq, packet)){
+                if(!dispatch(*s, packet)){
+                    break;
+                }
+            }
+        }
+
+        // 与stop/disconnect_all互斥, 先标记结束再关闭, 它们不会shutdown已被重用的描述符
+        std::lock_guard<std::mutex> lock(m_mtx);
+        s->m_done = true;
+        ::close(s->m_fd);
+        s->m_fd = -1;
+    }
+
+    bool mock_server::handshake(session& s)
+    {
+        char scramble[21];
+        for(int i = 0; i < 20; ++i){
+            scramble[i] = (char)('0' + (s.m_id * 7 + i * 13) % 64);
+        }
+        scramble[20] = 0;
+
+        std::string out = "";
+        put_int(out, 10, 1);
+        out += "8.0.30-zdb-mock";
+        out += '\0';
+        put_int(out, s.m_id, 4);
+        out.append(scramble, 8);
+        out += '\0';
+        put_int(out, MOCK_SERVER_CAPABILITIES & 0xffff, 2);
+        put_int(out, 255, 1);
+        put_int(out, MOCK_STATUS_AUTOCOMMIT, 2);
+        put_int(out, MOCK_SERVER_CAPABILITIES >> 16, 2);
+        put_int(out, 21, 1);
+        out.append(10, '\0');
+        out.append(scramble + 8, 13);
+        out += MOCK_AUTH_PLUGIN;
+        out += '\0';
+
+        s.m_seq = 0;
+        if(!write_packet(s.m_fd, s.m_seq, out)){
+            return false;
+        }
+
+        std::string packet = "";
+        if(!read_packet(s.m_fd, s.m_seq, packet) || packet.size() < 32){
+            return false;
+        }
+
+        size_t pos = 0;
+        uint32_t caps = (uint32_t)get_int(packet, pos, 4);
+        pos += 4 + 1 + 23;
+        get_cstr(packet, pos);
+        if(caps & MOCK_CLIENT_PLUGIN_AUTH_LENENC){
+            pos += get_lenenc(packet, pos);
+        }else if(caps & MOCK_CLIENT_SECURE_CONNECTION){
+            pos += get_int(packet, pos, 1);
+        }else{
+            get_cstr(packet, pos);
+        }
+        if(caps & MOCK_CLIENT_CONNECT_WITH_DB){
+            get_cstr(packet, pos);
+        }
+        std::string plugin = (caps & MOCK_CLIENT_PLUGIN_AUTH)?get_cstr(packet, pos):MOCK_AUTH_PLUGIN;
+
+        // 客户端使用其他认证插件时切换到mysql_native_password, 不校验密码
+        if(!plugin.empty() && plugin != MOCK_AUTH_PLUGIN){
+            std::string sw(1, (char)0xfe);
+            sw += MOCK_AUTH_PLUGIN;
+            sw += '\0';
+            sw.append(scramble, 21);
+            if(!write_packet(s.m_fd, s.m_seq, sw) || !read_packet(s.m_fd, s.m_seq, packet)){
+                return false;
+            }
+        }
+
+        bool refuse = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            refuse = m_fault.m_refuse_rate > 0 && std::uniform_real_distribution<double>(0, 1)(m_rng) < m_fault.m_refuse_rate;
+        }
+
+        if(refuse){
+            ++m_refused;
+            write_packet(s.m_fd, s.m_seq, make_err(1040, "Too many connections"));
+            return false;
+        }
+
+        return write_packet(s.m_fd, s.m_seq, make_ok(0, 0, MOCK_STATUS_AUTOCOMMIT));
+    }
+
+    int mock_server::inject_fault(session& s)
+    {
+        unsigned int delay_us = 0;
+        int action = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            std::uniform_real_distribution<double> dist(0, 1);
+            if(m_fault.m_disconnect_after > 0 && s.m_commands > m_fault.m_disconnect_after){
+                action = 2;
+            }else if(m_fault.m_disconnect_rate > 0 && dist(m_rng) < m_fault.m_disconnect_rate){
+                action = 2;
+            }else if(m_fault.m_drop_rate > 0 && dist(m_rng) < m_fault.m_drop_rate){
+                action = 1;
+            }
+
+            delay_us = m_fault.m_latency_us;
+            if(m_fault.m_jitter_us > 0){
+                delay_us += std::uniform_int_distribution<unsigned int>(0, m_fault.m_jitter_us)(m_rng);
+            }
+        }
+
+        if(delay_us > 0 && 0 == action){
+            std::this_thread::sleep_for(std::chrono::microseconds(delay_us));
+        }
+
+        if(2 == action){
+            ++m_disconnects;
+        }else if(1 == action){
+            ++m_dropped;
+        }
+
+        return action;
+    }
+
+    bool mock_server::dispatch(session& s, const std::string& packet)
+    {
+        if(packet.empty()){
+            return false;
+        }
+
+        unsigned char cmd = (unsigned char)packet[0];
+        if(MOCK_COM_QUIT == cmd){
+            return false;
+        }
+
+        ++m_commands;
+        ++s.m_commands;
+
+        // 没有应答的命令不注入故障
+        if(MOCK_COM_STMT_CLOSE == cmd){
+            size_t pos = 1;
+            s.m_stmts.erase((uint32_t)get_int(packet, pos, 4));
+            return true;
+        }
+
+        if(MOCK_COM_STMT_SEND_LONG_DATA == cmd){
+            return true;
+        }
+
+        int action = inject_fault(s);
+        if(2 == action){
+            return false;
+        }else if(1 == action){
+            return true;
+        }
+
+        switch(cmd){
+            case MOCK_COM_QUERY:
+                ++m_queries;
+                on_query(s, packet.substr(1));
+                break;
+            case MOCK_COM_STMT_PREPARE:
+                on_stmt_prepare(s, packet.substr(1));
+                break;
+            case MOCK_COM_STMT_EXECUTE:
+                ++m_queries;
+                on_stmt_execute(s, packet);
+                break;
+            case MOCK_COM_SET_OPTION:
+                write_packet(s.m_fd, s.m_seq, make_eof(MOCK_STATUS_AUTOCOMMIT));
+                break;
+            case MOCK_COM_INIT_DB:
+            case MOCK_COM_PING:
+            case MOCK_COM_STMT_RESET:
+            case MOCK_COM_RESET_CONNECTION:
+            case MOCK_COM_STMT_BULK_EXECUTE:
+                write_packet(s.m_fd, s.m_seq, make_ok(0, 0, MOCK_STATUS_AUTOCOMMIT));
+                break;
+            default:
+                write_packet(s.m_fd, s.m_seq, make_err(1047, "Unknown command"));
+                break;
+        }
+
+        return true;
+    }
+
+    bool mock_server::find_rule(const std::string& sql, mock_rule& rule)
+    {
+        std::string key = to_lower_sql(sql);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            for(auto& r : m_rules){
+                if(0 == key.compare(0, r.m_pattern.size(), r.m_pattern)){
+                    rule = r;
+                    return true;
+                }
+            }
+        }
+
+        // 没有规则时, select <数字>返回该数字, 其他SELECT返回表不存在, 其他语句返回OK
+        rule = mock_rule();
+        std::string verb = db_helper::instance().get_sql_verb(key.c_str());
+        if(verb != "select" && verb != "show"){
+            return false;
+        }
+
+        std::string literal = (key.size() > 7)?key.substr(7):"";
+        char* end = 0;
+        strtod(literal.c_str(), &end);
+        if(!literal.empty() && end && 0 == *end){
+            rule.column(literal, (std::string::npos == literal.find('.'))?MYSQL_TYPE_LONGLONG:MYSQL_TYPE_DOUBLE).row({literal});
+        }else{
+            rule.error(1146, "Table doesn't exist in mock server: " + sql);
+        }
+
+        return false;
+    }
+
+    void mock_server::on_query(session& s, const std::string& sql)
+    {
+        std::vector<std::string> stmts;
+        split_statements(sql, stmts);
+
+        for(size_t i = 0; i < stmts.size(); ++i){
+            uint16_t status = MOCK_STATUS_AUTOCOMMIT | ((i + 1 < stmts.size())?MOCK_STATUS_MORE_RESULTS:0);
+
+            mock_rule rule;
+            find_rule(stmts[i], rule);
+            if(rule.m_delay_ms > 0){
+                std::this_thread::sleep_for(std::chrono::milliseconds(rule.m_delay_ms));
+            }
+
+            // 出错时不再执行后面的语句
+            if(rule.m_error_code != 0){
+                write_packet(s.m_fd, s.m_seq, make_err(rule.m_error_code, rule.m_error_msg));
+                return;
+            }
+
+            if(rule.m_columns.empty()){
+                write_packet(s.m_fd, s.m_seq, make_ok(rule.m_affected_rows, rule.m_insert_id, status));
+                continue;
+            }
+
+            std::string out = "";
+            put_lenenc(out, rule.m_columns.size());
+            write_packet(s.m_fd, s.m_seq, out);
+            for(auto& col : rule.m_columns){
+                write_packet(s.m_fd, s.m_seq, make_column_def(col));
+            }
+            write_packet(s.m_fd, s.m_seq, make_eof(MOCK_STATUS_AUTOCOMMIT));
+
+            for(auto& row : rule.m_rows){
+                out.clear();
+                for(size_t c = 0; c < rule.m_columns.size(); ++c){
+                    if(c < row.size() && row[c]){
+                        put_lenenc_str(out, *row[c]);
+                    }else{
+                        out += (char)0xfb;
+                    }
+                }
+                write_packet(s.m_fd, s.m_seq, out);
+            }
+            write_packet(s.m_fd, s.m_seq, make_eof(status));
+        }
+    }
+
+    void mock_server::on_stmt_prepare(session& s, const std::string& sql)
+    {
+        mock_rule rule;
+        find_rule(sql, rule);
+        if(rule.m_error_code != 0 && rule.m_error_code != 1146){
+            write_packet(s.m_fd, s.m_seq, make_err(rule.m_error_code, rule.m_error_msg));
+            return;
+        }
+
+        uint32_t stmt_id = s.m_next_stmt_id++;
+        mock_stmt& stmt = s.m_stmts[stmt_id];
+        stmt.m_sql = sql;
+        stmt.m_param_count = count_params(sql);
+
+        std::string out(1, '\0');
+        put_int(out, stmt_id, 4);
+        put_int(out, rule.m_columns.size(), 2);
+        put_int(out, stmt.m_param_count, 2);
+        put_int(out, 0, 1);
+        put_int(out, 0, 2);
+        write_packet(s.m_fd, s.m_seq, out);
+
+        if(stmt.m_param_count > 0){
+            mock_column param{"?", MYSQL_TYPE_VAR_STRING};
+            for(uint16_t i = 0; i < stmt.m_param_count; ++i){
+                write_packet(s.m_fd, s.m_seq, make_column_def(param));
+            }
+            write_packet(s.m_fd, s.m_seq, make_eof(MOCK_STATUS_AUTOCOMMIT));
+        }
+
+        if(!rule.m_columns.empty()){
+            for(auto& col : rule.m_columns){
+                write_packet(s.m_fd, s.m_seq, make_column_def(col));
+            }
+            write_packet(s.m_fd, s.m_seq, make_eof(MOCK_STATUS_AUTOCOMMIT));
+        }
+    }
+
+    void mock_server::on_stmt_execute(session& s, const std::string& packet)
+    {
+        size_t pos = 1;
+        uint32_t stmt_id = (uint32_t)get_int(packet, pos, 4);
+        auto fi = s.m_stmts.find(stmt_id);
+        if(fi == s.m_stmts.end()){
+            write_packet(s.m_fd, s.m_seq, make_err(1243, "Unknown prepared statement handler"));
+            return;
+        }
+
+        // 参数值不参与匹配, 不解析
+        mock_rule rule;
+        find_rule(fi->second.m_sql, rule);
+        if(rule.m_delay_ms > 0){
+            std::this_thread::sleep_for(std::chrono::milliseconds(rule.m_delay_ms));
+        }
+
+        if(rule.m_error_code != 0){
+            write_packet(s.m_fd, s.m_seq, make_err(rule.m_error_code, rule.m_error_msg));
+            return;
+        }
+
+        if(rule.m_columns.empty()){
+            write_packet(s.m_fd, s.m_seq, make_ok(rule.m_affected_rows, rule.m_insert_id, MOCK_STATUS_AUTOCOMMIT));
+            return;
+        }
+
+        std::string out = "";
+        put_lenenc(out, rule.m_columns.size());
+        write_packet(s.m_fd, s.m_seq, out);
+        for(auto& col : rule.m_columns){
+            write_packet(s.m_fd, s.m_seq, make_column_def(col));
+        }
+        write_packet(s.m_fd, s.m_seq, make_eof(MOCK_STATUS_AUTOCOMMIT));
+
+        // 二进制行: 0x00, NULL位图(偏移2位), 非NULL字段的值
+        size_t columns = rule.m_columns.size();
+        for(auto& row : rule.m_rows){
+            out.assign(1, '\0');
+            size_t bitmap_pos = out.size();
+            out.append((columns + 7 + 2) / 8, '\0');
+            for(size_t c = 0; c < columns; ++c){
+                if(c < row.size() && row[c]){
+                    put_binary_value(out, rule.m_columns[c].m_type, *row[c]);
+                }else{
+                    out[bitmap_pos + (c + 2) / 8] |= (char)(1 << ((c + 2) % 8));
+                }
+            }
+            write_packet(s.m_fd, s.m_seq, out);
+        }
+        write_packet(s.m_fd, s.m_seq, make_eof(MOCK_STATUS_AUTOCOMMIT));
+    }
+}
@@ -0,0 +1,253 @@
+/*
+* @file
+    mock_server.h
+
+* @brief
+    本地MySQL协议模拟服务端类
+
+* @version
+    V1.0
+
+* @author
+    agent
+
+* @date
+    2026/10/19
+
+* @note
+    实现连接池测试所需的最小MySQL协议子集: 握手(mysql_native_password, 不校验密码)、
+    COM_QUERY、COM_PING、COM_INIT_DB、COM_STMT_PREPARE/EXECUTE/CLOSE/RESET,
+    返回文本或二进制结果集。按规则匹配SQL返回预设的结果、错误或OK,
+    并可注入延迟、抖动、丢包(不应答)和断开连接, 随机数种子固定时行为可重现。
+
+    zdb::mock_server server;
+    server.add_rule(zdb::mock_rule("select 1").column("1", MYSQL_TYPE_LONGLONG).row({"1"}));
+    server.start("127.0.0.1", 0, error);
+    cfg.m_port = server.get_port();
+
+* @warning
+    只用于测试和性能测试, 不支持SSL、压缩协议和服务端游标; 只支持POSIX平台
+* @bug
+* @copyright
+*/
+#ifndef zdb_mock_server_h
+#define zdb_mock_server_h
+#include <mysql.h>
+#include <stdint.h>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace zdb{
+    struct mock_column{
+        std::string m_name;         // 字段名
+        enum_field_types m_type;    // 字段类型, 决定二进制结果集中的编码
+    };
+
+    // 一条应答规则: SQL(规范化并转小写后)以m_pattern开头时使用
+    class mock_rule{
+        public:
+        std::string m_pattern;                                      // SQL前缀, 小写
+        std::vector<mock_column> m_columns;                         // 结果集字段, 为空时应答OK或错误
+        std::vector<std::vector<std::optional<std::string>>> m_rows;    // 文本格式的字段值, 空为NULL
+        unsigned int m_error_code;                                  // 非0时应答错误
+        std::string m_error_msg;                                    // 错误信息
+        uint64_t m_affected_rows;                                   // OK包的影响行数
+        uint64_t m_insert_id;                                       // OK包的自增id
+        unsigned int m_delay_ms;                                    // 应答前额外等待的毫秒数
+
+        mock_rule(const std::string& pattern = "");
+
+        mock_rule& column(const std::string& name, enum_field_types type)
+        {
+            m_columns.push_back(mock_column{name, type});
+            return *this;
+        }
+
+        mock_rule& row(const std::vector<std::optional<std::string>>& vals)
+        {
+            m_rows.push_back(vals);
+            return *this;
+        }
+
+        mock_rule& error(unsigned int code, const std::string& msg)
+        {
+            m_error_code = code;
+            m_error_msg = msg;
+            return *this;
+        }
+
+        mock_rule& ok(uint64_t affected_rows, uint64_t insert_id = 0)
+        {
+            m_affected_rows = affected_rows;
+            m_insert_id = insert_id;
+            return *this;
+        }
+
+        mock_rule& delay(unsigned int ms)
+        {
+            m_delay_ms = ms;
+            return *this;
+        }
+    };
+
+    // 故障注入设置, 概率取值[0, 1]
+    struct mock_fault{
+        unsigned int m_latency_us;      // 每次应答前的固定延迟(微秒)
+        unsigned int m_jitter_us;       // 在固定延迟上增加[0, m_jitter_us]的随机延迟
+        double m_drop_rate;             // 收到命令后不应答的概率, 客户端只能等待超时
+        double m_disconnect_rate;       // 收到命令后直接断开的概率
+        double m_refuse_rate;           // 握手时返回Too many connections的概率
+        unsigned int m_disconnect_after;    // 每个连接处理该数量的命令后断开, 0不限制
+
+        mock_fault()
+            : m_latency_us(0), m_jitter_us(0), m_drop_rate(0), m_disconnect_rate(0), m_refuse_rate(0), m_disconnect_after(0)
+        {}
+    };
+
+    struct mock_server_stats{
+        uint64_t m_connections;     // 接受的连接数
+        uint64_t m_commands;        // 处理的命令数
+        uint64_t m_queries;         // COM_QUERY和COM_STMT_EXECUTE数
+        uint64_t m_dropped;         // 注入的不应答次数
+        uint64_t m_disconnects;     // 注入的断开次数
+        uint64_t m_refused;         // 注入的拒绝连接次数
+    };
+
+    class mock_server{
+        private:
+        struct session;
+
+        std::mutex m_mtx;                           // 保护规则、故障设置、随机数和会话列表
+        std::vector<mock_rule> m_rules;             // 应答规则, 先添加的优先
+        mock_fault m_fault;                         // 故障注入设置
+        std::mt19937_64 m_rng;                      // 随机数, 种子固定时可重现
+        std::list<std::shared_ptr<session>> m_sessions;     // 连接会话
+
+        int m_listen_fd;                            // 监听套接字
+        unsigned short m_port;                      // 实际监听端口
+        std::atomic<bool> m_running;
+        std::thread m_accept_thread;
+        std::atomic<uint32_t> m_next_conn_id;
+
+        std::atomic<uint64_t> m_connections;
+        std::atomic<uint64_t> m_commands;
+        std::atomic<uint64_t> m_queries;
+        std::atomic<uint64_t> m_dropped;
+        std::atomic<uint64_t> m_disconnects;
+        std::atomic<uint64_t> m_refused;
+
+        mock_server(const mock_server&);
+        mock_server& operator=(const mock_server&);
+
+        public:
+        mock_server();
+        ~mock_server();
+
+        /*
+		* @brief	添加应答规则函数。
+		* @param 	[in]  const mock_rule& rule  应答规则\n
+		* @return 	无
+		* @note
+		    可在运行中调用; 没有匹配的规则时, SELECT返回错误1146, 其他语句返回OK
+		* @warning
+		* @bug
+		*/
+        void add_rule(const mock_rule& rule);
+        void clear_rules();
+        /*
+		* @brief	从脚本文件加载应答规则函数。
+		* @param 	[in]  const char* path      脚本文件路径\n
+		* @param 	[out] std::string& error    错误信息\n
+		* @return 	返回是否成功
+		* @note
+		    每行一条指令, #开头为注释:
+		    match <SQL前缀>         开始一条规则
+		    column <字段名> <类型>  类型为tiny/short/long/longlong/float/double/decimal/string/blob/date/datetime/time
+		    row <值>\t<值>...       \N为NULL
+		    error <错误码> <信息>
+		    ok <影响行数> [自增id]
+		    delay <毫秒>
+		* @warning
+		* @bug
+		*/
+        bool load_script(const char* path, std::string& error);
+        /*
+		* @brief	设置故障注入函数。
+		* @param 	[in]  const mock_fault& fault  故障注入设置\n
+		* @param 	[in]  uint64_t seed            随机数种子\n
+		* @return 	无
+		* @note
+		    可在运行中调用, 立即对所有连接生效
+		* @warning
+		* @bug
+		*/
+        void set_fault(const mock_fault& fault, uint64_t seed = 0);
+        /*
+		* @brief	开始监听函数。
+		* @param 	[in]  const char* host          监听地址\n
+		* @param 	[in]  unsigned short port       监听端口, 0为由系统分配\n
+		* @param 	[out] std::string& error        错误信息\n
+		* @return 	返回是否成功
+		* @note
+		    每个连接一个线程
+		* @warning
+		* @bug
+		*/
+        bool start(const char* host, unsigned short port, std::string& error);
+        /*
+		* @brief	停止监听并断开所有连接函数。
+		* @param 	无\n
+		* @return 	无
+		* @note
+		* @warning
+		* @bug
+		*/
+        void stop();
+        /*
+		* @brief	断开所有已建立的连接函数。
+		* @param 	无\n
+		* @return 	无
+		* @note
+		    用于测试连接池的重连, 监听不受影响
+		* @warning
+		* @bug
+		*/
+        void disconnect_all();
+
+        unsigned short get_port() const
+        {
+            return m_port;
+        }
+
+        mock_server_stats get_stats() const;
+
+        private:
+        void accept_thread_func();
+        void session_thread_func(std::shared_ptr<session> s);
+        bool handshake(session& s);
+        bool dispatch(session& s, const std::string& packet);
+        void on_query(session& s, const std::string& sql);
+        void on_stmt_prepare(session& s, const std::string& sql);
+        void on_stmt_execute(session& s, const std::string& packet);
+        bool find_rule(const std::string& sql, mock_rule& rule);
+        /*
+		* @brief	按故障设置决定本次命令的处理方式函数。
+		* @param 	[in]  session& s  会话\n
+		* @return 	返回0正常应答, 1不应答, 2断开
+		* @note
+		    需要延迟时在此等待
+		* @warning
+		* @bug
+		*/
+        int inject_fault(session& s);
+    };
+}
+
+#endif
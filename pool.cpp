@@ -1,13 +1,269 @@
 #include "pool.h"
+#include "result_snapshot.h"
 #include <thread>
 #include <chrono>
 #include <algorithm>
+#include <functional>
+#include <random>
 
 namespace zdb{
+    result_stream::result_stream()
+    : m_pool(nullptr)
+    , m_conn(nullptr)
+    {
+    }
+
+    result_stream::~result_stream()
+    {
+        close();
+    }
+
+    bool result_stream::next(std::string& error)
+    {
+        if(!m_conn){
+            return false;
+        }
+
+        if(m_res.get_next_record(error)){
+            return true;
+        }
+
+        close();
+
+        return false;
+    }
+
+    void result_stream::cancel()
+    {
+        if(!m_conn || !m_pool){
+            return;
+        }
+
+        std::string error = "";
+        m_pool->kill_query(m_conn->get_thread_id(), error);
+
+        close();
+    }
+
+    void result_stream::close()
+    {
+        m_res.close();
+
+        if(m_conn && m_pool){
+            m_pool->back(m_conn);
+        }
+
+        m_conn = nullptr;
+        m_pool = nullptr;
+    }
+
+    db_transaction::db_transaction()
+    : m_pool(nullptr)
+    , m_conn(nullptr)
+    , m_depth(0)
+    , m_errno(0)
+    {
+    }
+
+    db_transaction::~db_transaction()
+    {
+        rollback();
+    }
+
+    bool db_transaction::begin(db_pool& pool, std::string& error)
+    {
+        rollback();
+
+        m_errno = 0;
+        m_writes.clear();
+        m_conn = pool.get_connect(error);
+        if(!m_conn){
+            return false;
+        }
+        m_pool = &pool;
+
+        if(!run("START TRANSACTION", 0, error)){
+            release();
+            return false;
+        }
+
+        return true;
+    }
+
+    bool db_transaction::commit(std::string& error)
+    {
+        if(!m_conn){
+            error = "transaction is not open";
+            return false;
+        }
+
+        query_timer timer(m_pool->m_query_stats, m_pool->m_capture, "COMMIT");
+        timer.leased();
+        if(m_conn->commit(error) != 0){
+            save_errno();
+            if(error.empty()){
+                error = "failed to call mysql_commit, last_error=";
+                error += m_conn->get_last_error();
+            }
+            rollback();
+            return false;
+        }
+        timer.set_ok(true);
+
+        db_pool* pool = m_pool;
+        std::vector<std::string> writes;
+        writes.swap(m_writes);
+        release();
+
+        for(auto& sql : writes){
+            pool->m_query_cache.invalidate_sql(sql.c_str());
+        }
+
+        return true;
+    }
+
+    void db_transaction::rollback()
+    {
+        if(!m_conn){
+            return;
+        }
+
+        // 与COMMIT一样计入统计和录制, 重放时事务才能在原连接上结束
+        query_timer timer(m_pool->m_query_stats, m_pool->m_capture, "ROLLBACK");
+        timer.leased();
+        std::string error = "";
+        timer.set_ok(m_conn->roll_back(error) == 0);
+        release();
+    }
+
+    my_ulonglong db_transaction::execute(const char* sql, std::string& error)
+    {
+        my_ulonglong affect_rows = 0;
+        if(!run(sql, &affect_rows, error)){
+            return 0;
+        }
+
+        return affect_rows;
+    }
+
+    MYSQL_RES* db_transaction::query(const char* sql, std::string& error)
+    {
+        if(!m_conn){
+            error = "transaction is not open";
+            return 0;
+        }
+
+        query_timer timer(m_pool->m_query_stats, m_pool->m_capture, sql);
+        timer.leased();
+
+        std::string query_error = "";
+        MYSQL_RES* res = m_conn->query(sql, query_error);
+        if(!query_error.empty()){
+            save_errno();
+            error = query_error;
+            return 0;
+        }
+        timer.set_ok(true);
+        m_errno = 0;
+
+        add_write(sql);
+
+        return res;
+    }
+
+    bool db_transaction::savepoint(const std::function<bool(db_transaction&, std::string&)>& fn, std::string& error)
+    {
+        if(!m_conn){
+            error = "transaction is not open";
+            return false;
+        }
+
+        std::string name = "zdb_sp_" + std::to_string(m_depth + 1);
+        if(!run(("SAVEPOINT " + name).c_str(), 0, error)){
+            return false;
+        }
+
+        ++m_depth;
+        bool ok = fn(*this, error);
+        --m_depth;
+
+        // fn中结束了事务
+        if(!m_conn){
+            return false;
+        }
+
+        if(ok){
+            return run(("RELEASE SAVEPOINT " + name).c_str(), 0, error);
+        }
+
+        // 死锁时整个事务已被回滚, 保存点不存在, 保留导致失败的错误码
+        unsigned int code = m_errno;
+        std::string rollback_error = "";
+        run(("ROLLBACK TO SAVEPOINT " + name).c_str(), 0, rollback_error);
+        m_errno = code;
+
+        return false;
+    }
+
+    bool db_transaction::run(const char* sql, my_ulonglong* affect_rows, std::string& error)
+    {
+        if(!m_conn){
+            error = "transaction is not open";
+            return false;
+        }
+
+        query_timer timer(m_pool->m_query_stats, m_pool->m_capture, sql);
+        timer.leased();
+
+        // execute_real_affect_rows失败时的返回值与影响行数无法区分, 按错误信息判断
+        std::string exec_error = "";
+        my_ulonglong rows = m_conn->execute_real_affect_rows(sql, exec_error);
+        if(!exec_error.empty()){
+            save_errno();
+            error = exec_error;
+            return false;
+        }
+        timer.set_ok(true);
+        m_errno = 0;
+
+        if(affect_rows){
+            *affect_rows = rows;
+        }
+
+        add_write(sql);
+
+        return true;
+    }
+
+    void db_transaction::add_write(const char* sql)
+    {
+        if(m_pool && m_pool->m_query_cache.enabled() && query_cache::is_write_sql(sql)){
+            m_writes.push_back(sql);
+        }
+    }
+
+    void db_transaction::save_errno()
+    {
+        MYSQL* handle = m_conn?m_conn->get_handle():0;
+        m_errno = handle?mysql_errno(handle):0;
+    }
+
+    void db_transaction::release()
+    {
+        if(m_conn && m_pool){
+            m_pool->back(m_conn);
+        }
+
+        m_conn = nullptr;
+        m_pool = nullptr;
+        m_depth = 0;
+    }
+
     db_pool::db_pool()
     : m_running(false)
     , m_is_exited(false)
     , m_async_conn(nullptr)
+    , m_result_budget(std::make_shared<result_budget>())
     {
         m_async_list.reserve(1<<15);  
     }
@@ -37,6 +293,9 @@ namespace zdb{
         }
 
         m_pool_setting = cfg;
+        m_query_cache.configure(cfg.m_query_cache_size, cfg.m_query_cache_entry_size, cfg.m_query_cache_ttl);
+        m_result_budget->set_limit(cfg.m_result_pool_budget);
+        m_query_stats.configure(cfg.m_query_stats, cfg.m_slow_query_ms, cfg.m_slow_log_size);
 
         if((int)m_idle_list.size() < m_pool_setting.m_size){
             for(int i = 0; i < m_pool_setting.m_size; ++i){
@@ -81,6 +340,20 @@ namespace zdb{
 
     void db_pool::close()
     {
+        // 后台校验线程会租用连接, 须在加池锁前结束
+        std::vector<std::thread> snapshot_threads;
+        {
+            std::lock_guard<std::mutex> lock(m_snapshot_mtx);
+            snapshot_threads.swap(m_snapshot_threads);
+        }
+        for(auto& t : snapshot_threads){
+            t.join();
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_snapshot_mtx);
+            m_snapshot_finished.clear();
+        }
+
         std::lock_guard<std::mutex> lock(m_mtx);
 
         stop_async_thread();
@@ -169,52 +442,529 @@ namespace zdb{
 
     bool db_pool::query(const char* sql, result_set& res, std::string& error)
     {
+        return query(sql, res, m_query_cache.get_ttl(), error);
+    }
+
+    bool db_pool::query(const char* sql, result_set& res, unsigned int ttl, std::string& error)
+    {
+        bool budgeted = (m_pool_setting.m_result_query_budget > 0 || m_pool_setting.m_result_pool_budget > 0);
+        bool cacheable = m_query_cache.enabled() && ttl > 0 && db_helper::instance().is_cacheable_sql(sql);
+        if(!cacheable){
+            if(budgeted){
+                std::shared_ptr<cached_result> result;
+                return query_buffered(sql, res, result, error);
+            }
+
+            return res.bind(query(sql, error), error);
+        }
+
+        std::string key = "";
+        db_helper::instance().normalize_sql(sql, key);
+
+        ptr_cached_result cached = m_query_cache.get(key);
+        if(cached){
+            return res.bind_cached(cached, error);
+        }
+
+        // 在查询前取得失效序号, 查询期间有写操作时不缓存
+        uint64_t epoch = m_query_cache.get_epoch();
+        if(budgeted){
+            std::shared_ptr<cached_result> copy;
+            if(!query_buffered(sql, res, copy, error)){
+                return false;
+            }
+
+            // 已是紧凑副本, 直接放入缓存, 转为流式的结果不缓存; 放入后由缓存按容量计量, 归还连接池预算
+            if(copy){
+                std::vector<std::string> tables;
+                db_helper::instance().get_sql_tables(sql, tables);
+                if(m_query_cache.put(key, copy, tables, ttl, epoch)){
+                    copy->release_budget();
+                }
+            }
+
+            return true;
+        }
+
+        MYSQL_RES* raw_res = query(sql, error);
+        if(0 == raw_res){
+            return res.bind(raw_res, error);
+        }
+
+        std::shared_ptr<cached_result> copy = std::make_shared<cached_result>();
+        if(copy->build(raw_res, m_query_cache.get_max_entry_bytes())){
+            std::vector<std::string> tables;
+            db_helper::instance().get_sql_tables(sql, tables);
+            m_query_cache.put(key, copy, tables, ttl, epoch);
+        }
+
+        return res.bind(raw_res, error);
+    }
+
+    bool db_pool::query_buffered(const char* sql, result_set& res, std::shared_ptr<cached_result>& result, std::string& error, bool allow_stream)
+    {
+        result.reset();
+        res.close();
+
+        query_timer timer(m_query_stats, m_capture, sql);
         ptr_connection conn = get_connect(error);
-        if(conn == nullptr){
+        if(0 == conn){
             return false;
         }
+        timer.leased();
 
-        MYSQL_RES* raw_res = conn->query(sql, error);
-        back(conn);
+        result_set stream;
+        if(!conn->query_stream(sql, stream, error)){
+            back(conn);
+            return false;
+        }
 
-        return res.bind(raw_res, error);
+        std::shared_ptr<cached_result> copy = std::make_shared<cached_result>();
+        copy->begin(stream.m_query_res, m_result_budget);
+
+        size_t query_budget = m_pool_setting.m_result_query_budget;
+        bool overflow = false;
+        MYSQL_ROW row = 0;
+        unsigned long* lengths = 0;
+        while((row = stream.fetch_row(lengths)) != NULL){
+            bool in_pool_budget = copy->append(row, lengths);
+            if(!in_pool_budget || (query_budget > 0 && copy->get_charged() > query_budget)){
+                overflow = true;
+                break;
+            }
+        }
+        copy->finish();
+
+        if(!overflow){
+            bool ok = (0 == mysql_errno(stream.m_stream_conn));
+            if(!ok){
+                error = "failed to call mysql_fetch_row, last_error=";
+                error += mysql_error(stream.m_stream_conn);
+            }
+
+            stream.close();
+            back(conn);
+            m_query_cache.invalidate_sql(sql);
+            if(!ok){
+                return false;
+            }
+
+            result = copy;
+            timer.set_ok(true);
+            return res.bind_cached(copy, error);
+        }
+
+        if(!allow_stream || m_pool_setting.m_result_overflow != result_overflow_stream){
+            m_result_budget->on_aborted();
+            copy.reset();
+
+            // 中止服务端的查询, 避免读完剩余的行
+            std::string kill_error = "";
+            kill_query(conn->get_thread_id(), kill_error);
+            stream.close();
+            back(conn);
+
+            error = "result set exceeds memory budget, query aborted.";
+            return false;
+        }
+
+        // 已复制的行留在副本中, 剩余的行从连接流式读取, 连接在res close时归还
+        m_result_budget->on_streamed();
+        res.m_cached = copy;
+        res.m_cached_pos = 0;
+        res.m_field_count = copy->get_field_count();
+        res.m_field_index = copy->get_field_index();
+        res.m_query_res = stream.m_query_res;
+        res.m_stream_conn = stream.m_stream_conn;
+        res.m_release = [this, conn](){ back(conn); };
+
+        stream.m_query_res = 0;
+        stream.m_stream_conn = 0;
+        timer.set_ok(true);
+
+        return true;
+    }
+
+    bool db_pool::query_validator(const char* sql, std::string& validator, std::string& error)
+    {
+        validator = "";
+
+        MYSQL_RES* res = query(sql, error);
+        if(0 == res){
+            return false;
+        }
+
+        // 各字段以'\x1f'分隔, NULL记为"\N", 无记录时为空串
+        MYSQL_ROW row = mysql_fetch_row(res);
+        if(row){
+            unsigned long* lengths = mysql_fetch_lengths(res);
+            unsigned int count = mysql_num_fields(res);
+            for(unsigned int i = 0; i < count; ++i){
+                if(i > 0){
+                    validator += '\x1f';
+                }
+
+                if(row[i]){
+                    validator.append(row[i], lengths[i]);
+                }else{
+                    validator += "\\N";
+                }
+            }
+        }
+        mysql_free_result(res);
+
+        return true;
+    }
+
+    bool db_pool::refresh_snapshot(const char* sql, const char* path, const std::string& validator, ptr_cached_result& result, std::string& error)
+    {
+        MYSQL_RES* raw_res = query(sql, error);
+        if(0 == raw_res){
+            return false;
+        }
+
+        std::shared_ptr<cached_result> copy = std::make_shared<cached_result>();
+        bool ret = copy->build(raw_res, 0);
+        mysql_free_result(raw_res);
+        if(!ret){
+            error = "failed to copy result set.";
+            return false;
+        }
+
+        result = copy;
+        result_snapshot::save(path, *copy, validator, error);
+
+        return true;
+    }
+
+    void db_pool::revalidate_snapshot(std::string sql, std::string validate_sql, std::string path, std::string validator, std::function<void(result_set&)> fn)
+    {
+        std::string error = "";
+        std::string current = "";
+        if(!query_validator(validate_sql.c_str(), current, error) || current == validator){
+            return;
+        }
+
+        ptr_cached_result result;
+        if(!refresh_snapshot(sql.c_str(), path.c_str(), current, result, error) || !fn){
+            return;
+        }
+
+        result_set res;
+        if(res.bind_cached(result, error)){
+            fn(res);
+        }
+    }
+
+    void db_pool::reap_snapshot_threads()
+    {
+        // 线程持m_snapshot_mtx登记, 调用者持锁看到登记时线程只剩返回, join不会久等
+        for(auto& id : m_snapshot_finished){
+            for(auto it = m_snapshot_threads.begin(); it != m_snapshot_threads.end(); ++it){
+                if(it->get_id() == id){
+                    it->join();
+                    m_snapshot_threads.erase(it);
+                    break;
+                }
+            }
+        }
+        m_snapshot_finished.clear();
+    }
+
+    bool db_pool::query_snapshot(const char* sql, const char* validate_sql, const char* path, result_set& res, std::string& error,
+        const std::function<void(result_set&)>& on_refresh)
+    {
+        ptr_cached_result result;
+        std::string validator = "";
+        std::string load_error = "";
+        if(result_snapshot::load(path, result, validator, false, load_error)){
+            std::lock_guard<std::mutex> lock(m_snapshot_mtx);
+            reap_snapshot_threads();
+            m_snapshot_threads.emplace_back([this, sql = std::string(sql), validate_sql = std::string(validate_sql),
+                path = std::string(path), validator, on_refresh](){
+                revalidate_snapshot(sql, validate_sql, path, validator, on_refresh);
+
+                std::lock_guard<std::mutex> lock(m_snapshot_mtx);
+                m_snapshot_finished.push_back(std::this_thread::get_id());
+            });
+
+            return res.bind_cached(result, error);
+        }
+
+        // 先取校验串再查询, 两者之间的修改会在下次校验时发现
+        if(!query_validator(validate_sql, validator, error)){
+            return false;
+        }
+
+        std::string save_error = "";
+        if(!refresh_snapshot(sql, path, validator, result, save_error)){
+            error = save_error;
+            return false;
+        }
+
+        return res.bind_cached(result, error);
     }
 
     MYSQL_RES* db_pool::query(const char* sql, std::string& error)
     {
+        query_timer timer(m_query_stats, m_capture, sql);
         ptr_connection conn = get_connect(error);
         if(0 == conn){
             return nullptr;
         }
+        timer.leased();
 
         MYSQL_RES* res = conn->query(sql, error);
+        timer.set_ok(res != 0);
         back(conn);
-        
+        m_query_cache.invalidate_sql(sql);
+
         return res;
     }
 
+    bool db_pool::query(const char* sql, column_set& cols, std::string& error)
+    {
+        cols.clear();
+
+        // 列式结果须完整物化, 超出预算时中止而不转为流式
+        if(m_pool_setting.m_result_query_budget > 0 || m_pool_setting.m_result_pool_budget > 0){
+            result_set res;
+            std::shared_ptr<cached_result> copy;
+            if(!query_buffered(sql, res, copy, error, false)){
+                return false;
+            }
+
+            if(!copy){
+                error = "failed to buffer the result set.";
+                return false;
+            }
+
+            return cols.build(*copy, error);
+        }
+
+        MYSQL_RES* res = query(sql, error);
+        if(0 == res){
+            return false;
+        }
+
+        bool ret = cols.build(res, error);
+        mysql_free_result(res);
+
+        return ret;
+    }
+
+    bool db_pool::query_stream(const char* sql, result_stream& stream, std::string& error)
+    {
+        stream.close();
+
+        // 只计到得到结果集为止, 读取行的时间由调用者决定
+        query_timer timer(m_query_stats, m_capture, sql);
+        ptr_connection conn = get_connect(error);
+        if(0 == conn){
+            return false;
+        }
+        timer.leased();
+
+        if(!conn->query_stream(sql, stream.m_res, error)){
+            back(conn);
+            return false;
+        }
+
+        stream.m_pool = this;
+        stream.m_conn = conn;
+        timer.set_ok(true);
+
+        return true;
+    }
+
+    bool db_pool::query_stream(const char* sql, const std::function<bool(result_set&)>& fn, std::string& error)
+    {
+        result_stream stream;
+        if(!query_stream(sql, stream, error)){
+            return false;
+        }
+
+        std::string next_error = "";
+        while(stream.next(next_error)){
+            if(fn && !fn(stream.get_result())){
+                stream.cancel();
+                return true;
+            }
+        }
+
+        if(!next_error.empty()){
+            error = next_error;
+            return false;
+        }
+
+        return true;
+    }
+
+    bool db_pool::transact(const std::function<bool(db_transaction&, std::string&)>& fn, std::string& error)
+    {
+        thread_local std::mt19937 rng(std::random_device{}());
+
+        for(int attempt = 0; ; ++attempt){
+            error = "";
+            db_transaction tx;
+            if(!tx.begin(*this, error)){
+                return false;
+            }
+
+            if(fn(tx, error) && tx.commit(error)){
+                return true;
+            }
+
+            unsigned int code = tx.get_last_errno();
+            tx.rollback();
+            if(error.empty()){
+                error = "transaction is rolled back";
+            }
+
+            // 1213死锁, 1205锁等待超时
+            if(attempt >= m_pool_setting.m_tx_retries || (code != 1213 && code != 1205)){
+                return false;
+            }
+
+            // 退避时间每次翻倍, 在[一半, 全部]之间随机, 避免冲突的事务同时重试
+            unsigned int backoff = std::min(m_pool_setting.m_tx_backoff_ms << std::min(attempt, 10), MAX_TX_BACKOFF_MS);
+            unsigned int delay = backoff / 2 + (unsigned int)(rng() % (backoff / 2 + 1));
+            std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+        }
+    }
+
+    bool db_pool::kill_query(unsigned long thread_id, std::string& error)
+    {
+        if(0 == thread_id){
+            error = "invalid thread id";
+            return false;
+        }
+
+        ptr_connection conn = get_connect(error);
+        if(0 == conn){
+            return false;
+        }
+
+        std::string sql = "KILL QUERY " + std::to_string(thread_id);
+        std::string kill_error = "";
+        conn->execute_real_affect_rows(sql.c_str(), kill_error);
+        back(conn);
+
+        if(!kill_error.empty()){
+            error = kill_error;
+            return false;
+        }
+
+        return true;
+    }
+
     my_ulonglong db_pool::execute_affect_rows(const char* sql, std::string& error)
     {
+        query_timer timer(m_query_stats, m_capture, sql);
         ptr_connection conn = get_connect(error);
         if(0 == conn){
             return 0;
         }
+        timer.leased();
 
         my_ulonglong ret = conn->execute_affect_rows(sql, error);
+        timer.set_ok(error.empty());
         back(conn);
+        m_query_cache.invalidate_sql(sql);
 
         return ret;
     }
     my_ulonglong db_pool::execute_real_affect_rows(const char *sql, std::string& error)
     {
+        query_timer timer(m_query_stats, m_capture, sql);
         ptr_connection conn = get_connect(error);
         if(0 == conn){
             return 0;
         }
+        timer.leased();
 
         my_ulonglong ret = conn->execute_real_affect_rows(sql, error);
+        timer.set_ok(error.empty());
+        back(conn);
+        m_query_cache.invalidate_sql(sql);
+
+        return ret;
+    }
+
+    bool db_pool::execute_batch(const std::vector<std::string>& sqls, const std::function<bool(batch_result&)>& fn, std::string& error)
+    {
+        // 一次往返无法区分各语句的耗时, 统计按拼接后的语句记录; 录制逐条记录, 以便重放时单条执行
+        std::string batch_sql = "";
+        if(m_query_stats.enabled()){
+            for(auto& sql : sqls){
+                batch_sql += sql;
+                batch_sql += ';';
+            }
+        }
+
+        query_timer timer(m_query_stats, m_capture, batch_sql.c_str());
+        ptr_connection conn = get_connect(error);
+        if(0 == conn){
+            return false;
+        }
+        timer.leased();
+
+        bool ret = false;
+        size_t ok_count = 0;
+        {
+            batch_result res;
+            if(conn->execute_batch(sqls, res, error)){
+                std::string next_error = "";
+                while(res.next(next_error)){
+                    ++ok_count;
+                    if(fn && !fn(res)){
+                        break;
+                    }
+                }
+
+                if(next_error.empty()){
+                    ret = true;
+                }else{
+                    error = next_error;
+                }
+            }
+        }
+        timer.set_ok(ret);
+        timer.set_batch(sqls, ok_count);
         back(conn);
 
+        for(auto& sql : sqls){
+            m_query_cache.invalidate_sql(sql.c_str());
+        }
+
+        return ret;
+    }
+
+    bool db_pool::execute_batch(const std::vector<std::string>& sqls, std::vector<my_ulonglong>& affect_rows, std::string& error)
+    {
+        affect_rows.clear();
+        affect_rows.reserve(sqls.size());
+
+        return execute_batch(sqls, [&affect_rows](batch_result& res){
+            affect_rows.push_back(res.get_affect_rows());
+            return true;
+        }, error);
+    }
+
+    bool db_pool::execute_prepared(const char* sql, MYSQL_BIND* binds, int64_t* pid, std::string& error)
+    {
+        query_timer timer(m_query_stats, m_capture, sql, true);
+        ptr_connection conn = get_connect(error);
+        if(0 == conn){
+            return false;
+        }
+        timer.leased();
+
+        bool ret = conn->execute_prepared(sql, binds, pid, error);
+        timer.set_ok(ret);
+        back(conn);
+        m_query_cache.invalidate_sql(sql);
+
         return ret;
     }
 
@@ -304,8 +1054,24 @@ namespace zdb{
         }
 
         if(m_async_conn){
+            // 排队时间记为等待连接的时间
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
             my_ulonglong res = 0;
             res = m_async_conn->execute_real_affect_rows(ptr_data->m_sql.c_str(), error);
+            m_query_cache.invalidate_sql(ptr_data->m_sql.c_str());
+
+            if(m_query_stats.enabled() || m_capture.active()){
+                std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+                uint64_t queue_us = std::chrono::duration_cast<std::chrono::microseconds>(start - ptr_data->m_push_time).count();
+                uint64_t exec_us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+                if(m_query_stats.enabled()){
+                    m_query_stats.record(ptr_data->m_sql.c_str(), queue_us, exec_us, error.empty());
+                }
+                if(m_capture.active()){
+                    m_capture.record(ptr_data->m_push_time, ptr_data->m_sql.c_str(), queue_us, exec_us,
+                        workload_flag_async | (error.empty()?workload_flag_ok:0));
+                }
+            }
 
             if((my_ulonglong)-1 == res){
                 if(m_async_conn->ping(error) != 0){
@@ -332,6 +1098,9 @@ namespace zdb{
 
     bool db_pool::push_async(const std::string& sql)
     {
+        // 执行前先失效一次, 执行后异步线程会再失效一次
+        m_query_cache.invalidate_sql(sql.c_str());
+
         std::lock_guard<std::mutex> lock(m_mtx);
         m_async_list.push_back(new async_sql(std::move(sql)));
 
@@ -29,11 +29,201 @@
 #include <mutex>
 #include <vector>
 #include <atomic>
+#include <functional>
+#include <thread>
 #include "connection.h"
+#include "column_set.h"
+#include "row_mapper.h"
+#include "query_cache.h"
+#include "query_stats.h"
 
 namespace zdb{
+    class db_pool;
+
+    /*
+    * @brief
+        流式查询结果。持有租用的连接, 读完、close或析构时才归还给连接池。
+    */
+    class result_stream{
+        private:
+        friend class db_pool;
+
+        db_pool* m_pool;        // 连接所属连接池
+        ptr_connection m_conn;  // 租用的连接
+        result_set m_res;       // 流式结果集
+
+        public:
+        result_stream();
+        ~result_stream();
+
+        result_stream(const result_stream&) = delete;
+        result_stream& operator=(const result_stream&) = delete;
+
+        /*
+		* @brief    读取下一行函数。
+		* @param    [out] std::string& error  错误信息\n
+		* @return   返回是否读到一行
+		* @return   true   成功, 通过get_result读取字段\n
+		* @return   false  读完(error为空)或失败, 两种情况都已归还连接\n
+		* @note
+		* @warning
+		* @bug
+		*/
+        bool next(std::string& error);
+        /*
+		* @brief    获得当前行所在结果集函数。
+		* @param    无\n
+		* @return   返回结果集
+		* @note
+		* @warning
+		* @bug
+		*/
+        result_set& get_result()
+        {
+            return m_res;
+        }
+        /*
+		* @brief    取消查询函数。
+		* @param    无\n
+		* @return   无\n
+		* @note
+		    通过另一个连接发送KILL QUERY, 避免把剩余的行全部读完再归还连接
+		* @warning
+		* @bug
+		*/
+        void cancel();
+        /*
+		* @brief    关闭并归还连接函数。
+		* @param    无\n
+		* @return   无\n
+		* @note     未读完的行会被读出丢弃
+		* @warning
+		* @bug
+		*/
+        void close();
+    };
+
+    /*
+    * @brief
+        事务。begin时租用一个连接并开始事务, commit或rollback后归还; 析构时未提交的事务被回滚。
+        一般通过db_pool::transact使用。
+    */
+    class db_transaction{
+        private:
+        friend class db_pool;
+
+        db_pool* m_pool;                        // 连接所属连接池
+        ptr_connection m_conn;                  // 租用的连接
+        int m_depth;                            // 当前保存点层数
+        unsigned int m_errno;                   // 最近一条语句的错误码, 成功时清零
+        std::vector<std::string> m_writes;      // 写语句, 提交后失效查询结果缓存
+
+        // 执行不返回结果集的语句, 记录错误码
+        bool run(const char* sql, my_ulonglong* affect_rows, std::string& error);
+        // 记录连接上最近的错误码
+        void save_errno();
+        // 归还连接
+        void release();
+
+        public:
+        db_transaction();
+        ~db_transaction();
+
+        db_transaction(const db_transaction&) = delete;
+        db_transaction& operator=(const db_transaction&) = delete;
+
+        /*
+		* @brief    开始事务函数。
+		* @param    [in]  db_pool& pool         连接池
+		* @param    [out] std::string& error    错误信息
+		* @return   返回是否成功
+		* @note
+		* @warning
+		* @bug
+		*/
+        bool begin(db_pool& pool, std::string& error);
+        /*
+		* @brief    提交事务并归还连接函数。
+		* @param    [out] std::string& error    错误信息
+		* @return   返回是否成功, 失败时事务已回滚
+		* @note
+		* @warning
+		* @bug
+		*/
+        bool commit(std::string& error);
+        /*
+		* @brief    回滚事务并归还连接函数。
+		* @param    无
+		* @return   无
+		* @note     未开始或已结束时不做处理
+		* @warning
+		* @bug
+		*/
+        void rollback();
+
+        bool is_open() const
+        {
+            return m_conn != nullptr;
+        }
+
+        /*
+		* @brief    在事务中执行SQL语句函数。
+		* @param    [in]  const char *sql       SQL语句
+		* @param    [out] std::string& error    错误信息
+		* @return   返回影响到的记录数量, 失败时为0且error不为空
+		* @note
+		* @warning
+		* @bug
+		*/
+        my_ulonglong execute(const char* sql, std::string& error);
+        /*
+		* @brief    在事务中执行查询函数。
+		* @param    [in]  const char *sql       SQL语句
+		* @param    [out] std::string& error    错误信息
+		* @return   返回结果集, 由调用者mysql_free_result, 失败时为0且error不为空
+		* @note
+		* @warning
+		* @bug
+		*/
+        MYSQL_RES* query(const char* sql, std::string& error);
+        /*
+		* @brief    在保存点中执行函数。
+		* @param    [in]  fn                    在保存点中执行的函数, 返回false时回滚到保存点
+		* @param    [out] std::string& error    错误信息
+		* @return   返回fn是否成功
+		* @note     可以嵌套; 返回false时外层事务仍然有效, 可以继续执行或提交
+		* @warning  死锁或锁等待超时会回滚整个事务, 此时应让transact的函数也返回false以便重试
+		* @bug
+		*/
+        bool savepoint(const std::function<bool(db_transaction&, std::string&)>& fn, std::string& error);
+
+        // 返回事务使用的连接, 用于预处理语句等未封装的操作; 这些操作的错误码不会被记录, 写语句须用add_write登记
+        connection& get_connection()
+        {
+            return *m_conn;
+        }
+
+        /*
+		* @brief    登记写语句函数。
+		* @param    [in]  const char *sql       经get_connection执行的SQL语句
+		* @return   无
+		* @note     提交后按语句引用的表失效查询结果缓存, 与execute/query执行的写语句相同; 读语句和未启用缓存时忽略
+		* @warning
+		* @bug
+		*/
+        void add_write(const char* sql);
+
+        // 返回最近一条语句的MySQL错误码, 0表示成功; 其后的语句成功时清零, 只有结束事务的失败才会触发transact重试
+        unsigned int get_last_errno() const
+        {
+            return m_errno;
+        }
+    };
+
     class db_pool{
         private:
+        friend class db_transaction;
+
         std::list<ptr_connection> m_work_list;  // 工作连接池
         std::list<ptr_connection> m_idle_list;  // 空闲连接池
 
@@ -42,6 +232,13 @@ namespace zdb{
         std::atomic<bool> m_running;            // 异步线程是否运行
         std::atomic<bool> m_is_exited;          // 异步线程退出标志
         ptr_connection m_async_conn;            // 异步线程使用的数据库连接
+        query_cache m_query_cache;              // 查询结果缓存
+        ptr_result_budget m_result_budget;      // 缓冲结果集内存计量
+        query_stats m_query_stats;              // 语句耗时统计
+        workload_capture m_capture;             // 语句负载录制
+        std::mutex m_snapshot_mtx;
+        std::vector<std::thread> m_snapshot_threads;    // 快照后台校验线程
+        std::vector<std::thread::id> m_snapshot_finished;   // 已结束待回收的校验线程
 
 		public:
 		std::mutex m_async_mtx;
@@ -120,6 +317,61 @@ namespace zdb{
 		* @bug
 		*/
         void execute_async_sql(async_sql* ptr_data);
+        /*
+		* @brief    在内存预算内缓冲查询结果函数。
+		* @param    [in]  const char* sql               查询语句\n
+		* @param    [out] result_set& res               结果集\n
+		* @param    [out] std::shared_ptr<cached_result>& result    完整缓冲时为结果副本, 中止或转为流式时为空\n
+		* @param    [out] std::string& error            错误信息\n
+		* @param    [in]  bool allow_stream             为false时超出预算总是中止, 用于必须完整缓冲的调用者\n
+		* @return   返回查询是否成功
+		* @note
+		    用mysql_use_result逐行复制, 每行记入预算; 超出单查询或全池预算时,
+		    result_overflow_abort通过KILL QUERY中止, result_overflow_stream则把已复制的行和
+		    剩余的流绑定到res, 连接在res close时归还
+		* @warning
+		* @bug
+		*/
+        bool query_buffered(const char* sql, result_set& res, std::shared_ptr<cached_result>& result, std::string& error, bool allow_stream = true);
+        /*
+		* @brief    执行校验语句得到校验串函数。
+		* @param    [in]  const char* sql           校验语句, 取第一行各字段\n
+		* @param    [out] std::string& validator    校验串\n
+		* @param    [out] std::string& error        错误信息\n
+		* @return   返回是否成功
+		* @note
+		* @warning
+		* @bug
+		*/
+        bool query_validator(const char* sql, std::string& validator, std::string& error);
+        /*
+		* @brief    执行查询并重写快照文件函数。
+		* @param    [in]  const char* sql               查询语句\n
+		* @param    [in]  const char* path              快照文件路径\n
+		* @param    [in]  const std::string& validator  查询前得到的校验串\n
+		* @param    [out] ptr_cached_result& result     查询结果副本\n
+		* @param    [out] std::string& error            错误信息\n
+		* @return   返回查询是否成功, 写快照失败时仍返回true, 错误信息在error中
+		* @note
+		* @warning
+		* @bug
+		*/
+        bool refresh_snapshot(const char* sql, const char* path, const std::string& validator, ptr_cached_result& result, std::string& error);
+        /*
+		* @brief    快照后台校验线程函数。
+		* @param    [in]  std::string sql           查询语句\n
+		* @param    [in]  std::string validate_sql  校验语句\n
+		* @param    [in]  std::string path          快照文件路径\n
+		* @param    [in]  std::string validator     快照中的校验串\n
+		* @param    [in]  fn                        数据有变化时的回调\n
+		* @return   无
+		* @note
+		* @warning
+		* @bug
+		*/
+        void revalidate_snapshot(std::string sql, std::string validate_sql, std::string path, std::string validator, std::function<void(result_set&)> fn);
+        // 回收已结束的快照校验线程, 调用前持m_snapshot_mtx
+        void reap_snapshot_threads();
 
         public:
         /*
@@ -184,11 +436,264 @@ namespace zdb{
 		* @return   true  成功
 		* @return   false  失败
 		* @note
+		    启用查询结果缓存(db_pool_setting::m_query_cache_size)时, 可缓存的SELECT优先从缓存读取,
+		    未命中时把结果副本按默认TTL放入缓存
 		* @warning
 		* @bug
 		*/
         bool query(const char* sql, result_set& res, std::string& error);
+        /*
+		* @brief    执行SQL语句返回MYSQL_RES函数。
+		* @param    [in]  const char *sql       SQL语句
+		* @param    [out] std::string& error    错误信息
+		* @return   返回mysql_store_result的结果集, 由调用者mysql_free_result, 失败时为0
+		* @note
+		* @warning  结果集内存预算(db_pool_setting::set_result_budget)不适用于此函数, 不计入get_result_memory_stats;
+		            可能返回大量行时使用query(sql, result_set&)
+		* @bug
+		*/
         MYSQL_RES* query(const char* sql, std::string& error);
+        /*
+		* @brief    执行SQL语句返回结果集函数, 指定本次结果的缓存TTL。
+		* @param    [in]  const char *sql       SQL语句
+		* @param    [out] result_set& res       结果集
+		* @param    [in]  unsigned int ttl      缓存TTL(毫秒), 0为不缓存本次结果
+		* @param    [out] std::string& error    错误信息
+		* @return   返回查询是否成功
+		* @note
+		* @warning
+		* @bug
+		*/
+        bool query(const char* sql, result_set& res, unsigned int ttl, std::string& error);
+        /*
+		* @brief    通过快照文件执行查询函数。
+		* @param    [in]  const char* sql           查询语句, 通常是参照表的全表查询\n
+		* @param    [in]  const char* validate_sql  校验语句, 如select max(updated_at),count(*) from t或checksum table t\n
+		* @param    [in]  const char* path          快照文件路径\n
+		* @param    [out] result_set& res           结果集\n
+		* @param    [out] std::string& error        错误信息\n
+		* @param    [in]  on_refresh                后台校验发现数据变化并重新加载后的回调, 可为空\n
+		* @return   返回查询是否成功
+		* @note
+		    快照文件存在时直接映射为结果集返回, 不访问数据库; 之后在后台线程执行校验语句,
+		    结果与快照中记录的不同时重新查询、重写快照并以新结果调用on_refresh。
+		    快照不存在或损坏时查询数据库并写快照。
+		* @warning
+		    on_refresh在后台线程中调用
+		* @bug
+		*/
+        bool query_snapshot(const char* sql, const char* validate_sql, const char* path, result_set& res, std::string& error,
+            const std::function<void(result_set&)>& on_refresh = nullptr);
+        /*
+		* @brief    获得缓冲结果集内存统计函数。
+		* @param    无
+		* @return   返回统计信息
+		* @note     只统计启用结果集内存预算后经db_pool::query缓冲的结果集(含查询结果缓存中的副本)
+		* @warning
+		* @bug
+		*/
+        result_memory_stats get_result_memory_stats()
+        {
+            return m_result_budget->get_stats();
+        }
+        /*
+		* @brief    获得查询结果缓存统计信息函数。
+		* @param    无
+		* @return   返回统计信息
+		* @note
+		* @warning
+		* @bug
+		*/
+        query_cache_stats get_query_cache_stats()
+        {
+            return m_query_cache.get_stats();
+        }
+        /*
+		* @brief    清空查询结果缓存函数。
+		* @param    无
+		* @return   无
+		* @note     连接池之外修改了数据时调用
+		* @warning
+		* @bug
+		*/
+        void clear_query_cache()
+        {
+            m_query_cache.clear();
+        }
+        /*
+		* @brief    获得查询结果缓存函数。
+		* @param    无
+		* @return   返回查询结果缓存
+		* @note     用于binlog_listener等外部失效来源
+		* @warning
+		* @bug
+		*/
+        query_cache& get_query_cache()
+        {
+            return m_query_cache;
+        }
+        /*
+		* @brief    获得按SQL指纹聚合的语句耗时函数。
+		* @param    [out] std::vector<query_digest>& digests  各指纹的汇总, 按执行时间之和降序
+		* @return   无
+		* @note     需要db_pool_setting::set_query_stats(true); 命中查询结果缓存的查询不计入
+		* @warning
+		* @bug
+		*/
+        void get_query_digests(std::vector<query_digest>& digests)
+        {
+            m_query_stats.get_digests(digests);
+        }
+        /*
+		* @brief    获得最近的慢查询函数。
+		* @param    [out] std::vector<slow_query>& queries  慢查询, 按完成时间升序
+		* @return   返回启用以来的慢查询总数
+		* @note     等待连接与执行时间之和超过db_pool_setting::m_slow_query_ms的语句
+		* @warning
+		* @bug
+		*/
+        uint64_t get_slow_queries(std::vector<slow_query>& queries)
+        {
+            return m_query_stats.get_slow_queries(queries);
+        }
+        /*
+		* @brief    设置慢查询回调函数。
+		* @param    [in]  const slow_query_handler& fn  回调, 为空时取消
+		* @return   无
+		* @note     在执行语句的线程中调用, 可用于写日志
+		* @warning
+		* @bug
+		*/
+        void set_slow_query_handler(const slow_query_handler& fn)
+        {
+            m_query_stats.set_slow_handler(fn);
+        }
+        /*
+		* @brief    清空语句耗时统计和慢查询日志函数。
+		* @param    无
+		* @return   无
+		* @note
+		* @warning
+		* @bug
+		*/
+        void reset_query_stats()
+        {
+            m_query_stats.reset();
+        }
+        /*
+		* @brief    开始录制语句负载函数。
+		* @param    [in]  const char* path      录制文件路径, 已存在时覆盖
+		* @param    [in]  uint64_t max_bytes    文件大小上限(字节), 达到后不再录制, 0不限制
+		* @param    [out] std::string& error    错误信息
+		* @return   返回是否成功
+		* @note     之后经由连接池执行的语句都被录制, 用zdb_replay重放, 格式见workload_capture.h;
+		            命中查询结果缓存的查询不录制
+		* @warning
+		* @bug
+		*/
+        bool start_capture(const char* path, uint64_t max_bytes, std::string& error)
+        {
+            return m_capture.start(path, max_bytes, error);
+        }
+        /*
+		* @brief    停止录制语句负载函数。
+		* @param    无
+		* @return   返回录制的语句数
+		* @note
+		* @warning
+		* @bug
+		*/
+        uint64_t stop_capture()
+        {
+            return m_capture.stop();
+        }
+        /*
+		* @brief    执行SQL语句返回列式结果集函数。
+		* @param    [in]  const char *sql       SQL语句
+		* @param    [out] column_set& cols      列式结果集
+		* @param    [out] std::string& error    错误信息
+		* @return   返回查询是否成功
+		* @return   true  成功
+		* @return   false  失败
+		* @note     见column_set; 启用结果集内存预算时先在预算内缓冲, 超出时中止查询
+		* @warning
+		* @bug
+		*/
+        bool query(const char* sql, column_set& cols, std::string& error);
+        /*
+		* @brief    执行SQL语句并把结果映射为结构体数组函数。
+		* @param    [in]  const char *sql       SQL语句
+		* @param    [out] std::vector<T>& rows  结构体数组, 结果追加在末尾
+		* @param    [out] std::string& error    错误信息
+		* @return   返回查询是否成功
+		* @return   true  成功
+		* @return   false  失败
+		* @note     T需用ZDB_ROW_MAPPING声明映射, 见row_mapper.h
+		* @warning
+		* @bug
+		*/
+        template<typename T>
+        bool query(const char* sql, std::vector<T>& rows, std::string& error)
+        {
+            result_set res;
+            if(!query(sql, res, error)){
+                return false;
+            }
+
+            return map_rows(res, rows, error);
+        }
+        /*
+		* @brief    执行SQL语句返回流式结果函数。
+		* @param    [in]  const char *sql         SQL语句
+		* @param    [out] result_stream& stream   流式结果, 读完前一直占用一个连接
+		* @param    [out] std::string& error      错误信息
+		* @return   返回查询是否成功
+		* @return   true  成功
+		* @return   false  失败
+		* @note
+		    基于mysql_use_result, 内存占用与结果行数无关, 适合导出、对账等大结果集扫描
+		* @warning
+		* @bug
+		*/
+        bool query_stream(const char* sql, result_stream& stream, std::string& error);
+        /*
+		* @brief    执行SQL语句并逐行回调函数。
+		* @param    [in]  const char *sql       SQL语句
+		* @param    [in]  fn                    每行的回调, 返回false时取消查询
+		* @param    [out] std::string& error    错误信息
+		* @return   返回查询是否成功
+		* @return   true  成功(包括被回调取消)
+		* @return   false  失败
+		* @note
+		* @warning
+		* @bug
+		*/
+        bool query_stream(const char* sql, const std::function<bool(result_set&)>& fn, std::string& error);
+        /*
+		* @brief    在事务中执行函数。
+		* @param    [in]  fn                    事务中执行的函数, 通过db_transaction执行语句, 返回true提交, false回滚
+		* @param    [out] std::string& error    错误信息
+		* @return   返回事务是否提交成功
+		* @return   true  成功
+		* @return   false  fn返回false或提交失败, 事务已回滚
+		* @note
+		    整个事务使用同一个连接。遇到死锁(1213)或锁等待超时(1205)时回滚并重新执行fn,
+		    最多db_pool_setting::m_tx_retries次, 每次等待的退避时间翻倍并加随机抖动;
+		    fn可能被执行多次, 事务外的副作用须可重复。fn抛出异常时回滚并归还连接
+		* @warning
+		* @bug
+		*/
+        bool transact(const std::function<bool(db_transaction&, std::string&)>& fn, std::string& error);
+        /*
+		* @brief    取消指定线程上正在执行的语句函数。
+		* @param    [in]  unsigned long thread_id  服务端线程id
+		* @param    [out] std::string& error       错误信息
+		* @return   返回是否成功
+		* @note     使用连接池中的另一个连接发送KILL QUERY
+		* @warning
+		* @bug
+		*/
+        bool kill_query(unsigned long thread_id, std::string& error);
         /*
 		* @brief    执行SQL语句函数获得受影响函数。
 		* @param    [in]  const char *sql       SQL语句
@@ -213,6 +718,203 @@ namespace zdb{
 		* @bug
 		*/
 		my_ulonglong execute_real_affect_rows( const char *sql, std::string& error);
+        /*
+		* @brief    一次往返执行多条SQL语句函数。
+		* @param    [in]  const std::vector<std::string>& sqls  SQL语句列表
+		* @param    [in]  fn                                    每条语句结果的回调, 返回false时停止读取
+		* @param    [out] std::string& error                    错误信息
+		* @return   返回全部语句是否执行成功
+		* @return   true  成功
+		* @return   false  失败, 失败语句之后的语句不会被执行
+		* @note
+		    需要db_setting::set_multi_statements(true)
+		* @warning
+		* @bug
+		*/
+        bool execute_batch(const std::vector<std::string>& sqls, const std::function<bool(batch_result&)>& fn, std::string& error);
+        /*
+		* @brief    一次往返执行多条SQL语句并获得每条影响记录数函数。
+		* @param    [in]  const std::vector<std::string>& sqls  SQL语句列表
+		* @param    [out] std::vector<my_ulonglong>& affect_rows 每条语句影响到的记录数量
+		* @param    [out] std::string& error                    错误信息
+		* @return   返回全部语句是否执行成功
+		* @return   true  成功
+		* @return   false  失败
+		* @note
+		* @warning
+		* @bug
+		*/
+        bool execute_batch(const std::vector<std::string>& sqls, std::vector<my_ulonglong>& affect_rows, std::string& error);
+        /*
+		* @brief    使用连接缓存的预处理语句执行SQL函数。
+		* @param    [in]  const char *sql       预处理SQL语句
+		* @param    [in]  MYSQL_BIND *binds     要执行的BIND
+		* @param    [out] int64_t *pid          执行后获得的id, 可为空
+		* @param    [out] std::string& error    错误信息
+		* @return   返回执行是否成功
+		* @return   true  成功
+		* @return   false  失败
+		* @note
+		    同一SQL在各连接上只预处理一次, 之后的租用直接复用缓存句柄
+		* @warning
+		* @bug
+		*/
+        bool execute_prepared(const char* sql, MYSQL_BIND* binds, int64_t* pid, std::string& error);
+        /*
+		* @brief    按类型绑定参数执行预处理SQL函数。
+		* @param    [in]  const char *sql       预处理SQL语句
+		* @param    [out] std::string& error    错误信息
+		* @param    [in]  const Args&... args   参数, 类型见stmt_binder.h
+		* @return   返回执行是否成功
+		* @return   true  成功
+		* @return   false  失败
+		* @note
+		    zdb_pool.execute_prepared("insert into t(id,name) values(?,?)", error, id, name);
+		* @warning
+		* @bug
+		*/
+        template<typename... Args>
+        bool execute_prepared(const char* sql, std::string& error, const Args&... args)
+        {
+            query_timer timer(m_query_stats, m_capture, sql, true);
+            ptr_connection conn = get_connect(error);
+            if(0 == conn){
+                return false;
+            }
+            timer.leased();
+
+            bool ret = conn->execute_prepared(sql, error, args...);
+            timer.set_ok(ret);
+            back(conn);
+            m_query_cache.invalidate_sql(sql);
+
+            return ret;
+        }
+        /*
+		* @brief    批量执行预处理SQL函数。
+		* @param    [in]  const char *sql                               预处理INSERT语句
+		* @param    [in]  const std::vector<std::tuple<Args...>>& rows  参数行
+		* @param    [out] my_ulonglong* affect_rows                     影响到的记录数量, 可为空
+		* @param    [out] std::string& error                            错误信息
+		* @return   返回执行是否成功
+		* @return   true  成功
+		* @return   false  失败
+		* @note     见connection::execute_bulk
+		* @warning
+		* @bug
+		*/
+        template<typename... Args>
+        bool execute_bulk(const char* sql, const std::vector<std::tuple<Args...>>& rows, my_ulonglong* affect_rows, std::string& error)
+        {
+            query_timer timer(m_query_stats, m_capture, sql, true);
+            ptr_connection conn = get_connect(error);
+            if(0 == conn){
+                return false;
+            }
+            timer.leased();
+
+            bool ret = conn->execute_bulk(sql, rows, affect_rows, error);
+            timer.set_ok(ret);
+            back(conn);
+            m_query_cache.invalidate_sql(sql);
+
+            return ret;
+        }
+        /*
+		* @brief    执行预处理查询并以二进制协议结果集回调函数。
+		* @param    [in]  const char *sql       预处理SQL语句
+		* @param    [in]  fn                    结果集回调, 回调期间连接保持租用
+		* @param    [out] std::string& error    错误信息
+		* @param    [in]  const Args&... args   参数
+		* @return   返回查询是否成功
+		* @return   true  成功
+		* @return   false  失败
+		* @note
+		* @warning
+		* @bug
+		*/
+        template<typename... Args>
+        bool query_prepared(const char* sql, const std::function<void(stmt_result_set&)>& fn, std::string& error, const Args&... args)
+        {
+            query_timer timer(m_query_stats, m_capture, sql, true);
+            ptr_connection conn = get_connect(error);
+            if(0 == conn){
+                return false;
+            }
+            timer.leased();
+
+            bool ret = false;
+            {
+                stmt_result_set res;
+                ret = conn->query_prepared(sql, res, error, args...);
+                if(ret && fn){
+                    fn(res);
+                }
+            }
+            timer.set_ok(ret);
+            back(conn);
+
+            return ret;
+        }
+        /*
+		* @brief    以服务端游标分块扫描预处理查询函数。
+		* @param    [in]  const char *sql               预处理查询语句
+		* @param    [in]  unsigned long prefetch_rows   每次取回的行数
+		* @param    [in]  Fn fn                         bool(std::tuple<Ts...>& row)回调, 返回false时停止
+		* @param    [out] std::string& error            错误信息
+		* @param    [in]  const Args&... args           参数
+		* @return   返回扫描是否成功
+		* @return   true  成功
+		* @return   false  失败
+		* @note     见connection::scan_prepared
+		* @warning
+		* @bug
+		*/
+        template<typename... Ts, typename Fn, typename... Args>
+        bool scan_prepared(const char* sql, unsigned long prefetch_rows, Fn fn, std::string& error, const Args&... args)
+        {
+            query_timer timer(m_query_stats, m_capture, sql, true);
+            ptr_connection conn = get_connect(error);
+            if(0 == conn){
+                return false;
+            }
+            timer.leased();
+
+            bool ret = conn->scan_prepared<Ts...>(sql, prefetch_rows, fn, error, args...);
+            timer.set_ok(ret);
+            back(conn);
+
+            return ret;
+        }
+        /*
+		* @brief    按类型绑定参数执行预处理查询函数。
+		* @param    [in]  const char *sql                       预处理SQL语句
+		* @param    [out] std::vector<std::tuple<Ts...>>& rows  结果行
+		* @param    [out] std::string& error                    错误信息
+		* @param    [in]  const Args&... args                   参数
+		* @return   返回查询是否成功
+		* @return   true  成功
+		* @return   false  失败
+		* @note
+		* @warning
+		* @bug
+		*/
+        template<typename... Ts, typename... Args>
+        bool query_prepared(const char* sql, std::vector<std::tuple<Ts...>>& rows, std::string& error, const Args&... args)
+        {
+            query_timer timer(m_query_stats, m_capture, sql, true);
+            ptr_connection conn = get_connect(error);
+            if(0 == conn){
+                return false;
+            }
+            timer.leased();
+
+            bool ret = conn->query_prepared(sql, rows, error, args...);
+            timer.set_ok(ret);
+            back(conn);
+
+            return ret;
+        }
     };
 }
 
@@ -0,0 +1,416 @@
+#include "query_cache.h"
+#include "helper.h"
+#include <stdint.h>
+#include <string.h>
+
+namespace zdb{
+    cached_result::cached_result()
+    {
+        m_field_count = 0;
+        m_row_count = 0;
+        m_charged = 0;
+    }
+
+    cached_result::~cached_result()
+    {
+        release_budget();
+    }
+
+    void cached_result::release_budget()
+    {
+        if(m_budget){
+            m_budget->release(m_charged);
+            m_budget->remove_result();
+            m_budget.reset();
+        }
+        m_charged = 0;
+    }
+
+    void cached_result::begin(MYSQL_RES* res, ptr_result_budget budget)
+    {
+        begin(mysql_fetch_fields(res), (int)mysql_num_fields(res), budget);
+    }
+
+    void cached_result::begin(const MYSQL_FIELD* fields, int count, ptr_result_budget budget)
+    {
+        m_field_count = count;
+        m_row_count = 0;
+
+        m_field_index = field_index_cache::instance().acquire(fields, m_field_count);
+        m_field_types.resize(m_field_count);
+        m_field_flags.resize(m_field_count);
+        for(int i = 0; i < m_field_count; ++i){
+            m_field_types[i] = fields[i].type;
+            m_field_flags[i] = fields[i].flags;
+        }
+
+        m_budget = budget;
+        if(m_budget){
+            m_budget->add_result();
+        }
+    }
+
+    bool cached_result::append(MYSQL_ROW row, unsigned long* lengths)
+    {
+        // m_data扩容会移动数据, 先记偏移, finish时再换算成指针
+        size_t bytes = 0;
+        for(int i = 0; i < m_field_count; ++i){
+            if(0 == row[i]){
+                m_offsets.push_back(SIZE_MAX);
+                m_lengths.push_back(0);
+                continue;
+            }
+
+            m_offsets.push_back(m_data.size());
+            m_lengths.push_back(lengths[i]);
+            m_data.insert(m_data.end(), row[i], row[i] + lengths[i]);
+            m_data.push_back(0);
+            bytes += lengths[i] + 1;
+        }
+        ++m_row_count;
+
+        bytes += m_field_count * (sizeof(char*) + sizeof(unsigned long));
+        m_charged += bytes;
+
+        return m_budget?m_budget->charge(bytes):true;
+    }
+
+    void cached_result::finish()
+    {
+        m_cells.resize(m_offsets.size());
+        for(size_t cell = 0; cell < m_offsets.size(); ++cell){
+            m_cells[cell] = (SIZE_MAX == m_offsets[cell])?0:&m_data[m_offsets[cell]];
+        }
+
+        std::vector<size_t>().swap(m_offsets);
+    }
+
+    bool cached_result::build(MYSQL_RES* res, size_t max_bytes)
+    {
+        if(0 == res){
+            return false;
+        }
+
+        m_field_count = mysql_num_fields(res);
+        m_row_count = (size_t)mysql_num_rows(res);
+
+        size_t cell_count = m_row_count * m_field_count;
+        size_t fixed = sizeof(*this) + cell_count * (sizeof(char*) + sizeof(unsigned long));
+        if(max_bytes > 0 && fixed > max_bytes){
+            return false;
+        }
+
+        // 第一遍统计字段值总长度, 第二遍复制, 只分配一次
+        size_t data_size = 0;
+        MYSQL_ROW row = 0;
+        mysql_data_seek(res, 0);
+        while((row = mysql_fetch_row(res)) != NULL){
+            unsigned long* lengths = mysql_fetch_lengths(res);
+            for(int i = 0; i < m_field_count; ++i){
+                if(row[i]){
+                    data_size += lengths[i] + 1;
+                }
+            }
+
+            if(max_bytes > 0 && fixed + data_size > max_bytes){
+                mysql_data_seek(res, 0);
+                return false;
+            }
+        }
+
+        m_data.resize(data_size);
+        m_cells.resize(cell_count);
+        m_lengths.resize(cell_count);
+
+        size_t pos = 0;
+        size_t cell = 0;
+        mysql_data_seek(res, 0);
+        while((row = mysql_fetch_row(res)) != NULL && cell < cell_count){
+            unsigned long* lengths = mysql_fetch_lengths(res);
+            for(int i = 0; i < m_field_count; ++i, ++cell){
+                if(0 == row[i]){
+                    m_cells[cell] = 0;
+                    m_lengths[cell] = 0;
+                    continue;
+                }
+
+                memcpy(&m_data[pos], row[i], lengths[i]);
+                m_data[pos + lengths[i]] = 0;
+                m_cells[cell] = &m_data[pos];
+                m_lengths[cell] = lengths[i];
+                pos += lengths[i] + 1;
+            }
+        }
+        mysql_data_seek(res, 0);
+
+        MYSQL_FIELD* fields = mysql_fetch_fields(res);
+        m_field_index = field_index_cache::instance().acquire(fields, m_field_count);
+        m_field_types.resize(m_field_count);
+        m_field_flags.resize(m_field_count);
+        for(int i = 0; i < m_field_count; ++i){
+            m_field_types[i] = fields[i].type;
+            m_field_flags[i] = fields[i].flags;
+        }
+
+        return true;
+    }
+
+    query_cache::query_cache()
+        : m_capacity(0)
+        , m_max_entry_bytes(0)
+        , m_ttl(0)
+        , m_epoch(0)
+        , m_hits(0)
+        , m_misses(0)
+        , m_evictions(0)
+        , m_expirations(0)
+        , m_invalidations(0)
+    {
+        for(auto& s : m_shards){
+            s.m_bytes = 0;
+        }
+    }
+
+    void query_cache::configure(size_t capacity, size_t max_entry_bytes, unsigned int ttl)
+    {
+        clear();
+
+        size_t shard_capacity = capacity / QUERY_CACHE_SHARD_COUNT;
+        if(0 == max_entry_bytes || max_entry_bytes > shard_capacity){
+            max_entry_bytes = shard_capacity;
+        }
+
+        m_max_entry_bytes = max_entry_bytes;
+        m_ttl = ttl;
+        m_capacity = capacity;
+    }
+
+    ptr_cached_result query_cache::get(const std::string& key)
+    {
+        if(!enabled()){
+            return ptr_cached_result();
+        }
+
+        shard& s = get_shard(key);
+        std::lock_guard<std::mutex> lock(s.m_mutex);
+
+        auto fi = s.m_entry_map.find(key);
+        if(fi == s.m_entry_map.end()){
+            ++m_misses;
+            return ptr_cached_result();
+        }
+
+        if(fi->second->m_expire <= clock::now()){
+            erase(s, fi->second);
+            ++m_expirations;
+            ++m_misses;
+            return ptr_cached_result();
+        }
+
+        s.m_lru_list.splice(s.m_lru_list.begin(), s.m_lru_list, fi->second);
+        ++m_hits;
+
+        return fi->second->m_result;
+    }
+
+    bool query_cache::put(const std::string& key, ptr_cached_result result, const std::vector<std::string>& tables, unsigned int ttl, uint64_t epoch)
+    {
+        if(!enabled() || !result || 0 == ttl){
+            return false;
+        }
+
+        size_t bytes = result->get_bytes() + key.size();
+        size_t shard_capacity = m_capacity / QUERY_CACHE_SHARD_COUNT;
+        if(bytes > m_max_entry_bytes){
+            return false;
+        }
+
+        shard& s = get_shard(key);
+        std::lock_guard<std::mutex> lock(s.m_mutex);
+
+        // 在持有分片锁时检查, 与invalidate的加1及清除互斥
+        if(get_epoch() != epoch){
+            return false;
+        }
+
+        auto fi = s.m_entry_map.find(key);
+        if(fi != s.m_entry_map.end()){
+            erase(s, fi->second);
+        }
+
+        while(!s.m_lru_list.empty() && s.m_bytes + bytes > shard_capacity){
+            erase(s, std::prev(s.m_lru_list.end()));
+            ++m_evictions;
+        }
+
+        s.m_lru_list.push_front(entry());
+        entry& e = s.m_lru_list.front();
+        e.m_key = key;
+        e.m_result = result;
+        e.m_expire = clock::now() + std::chrono::milliseconds(ttl);
+        e.m_tables = tables;
+        e.m_bytes = bytes;
+
+        s.m_entry_map[key] = s.m_lru_list.begin();
+        for(auto& table : tables){
+            s.m_table_keys[table].insert(key);
+        }
+        s.m_bytes += bytes;
+
+        return true;
+    }
+
+    static bool is_write_statement(const char* sql)
+    {
+        // WITH语句按公用表表达式之后的主语句判断; HANDLER只读表, DO只求值表达式
+        std::string verb = db_helper::instance().get_main_verb(sql);
+
+        return !(verb == "select" || verb == "show" || verb == "desc" || verb == "describe" || verb == "explain"
+            || verb == "set" || verb == "use" || verb == "begin" || verb == "start" || verb == "commit"
+            || verb == "rollback" || verb == "savepoint" || verb == "release" || verb == "kill" || verb == "xa"
+            || verb == "do" || verb == "help" || verb == "handler" || verb == "table" || verb == "values");
+    }
+
+    bool query_cache::is_write_sql(const char* sql)
+    {
+        if(0 == sql || 0 == strchr(sql, ';')){
+            return is_write_statement(sql);
+        }
+
+        // 多语句文本中任一条是写语句即为写
+        std::vector<std::string> statements;
+        db_helper::instance().split_statements(sql, statements);
+        for(auto& it : statements){
+            if(is_write_statement(it.c_str())){
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void query_cache::invalidate_sql(const char* sql)
+    {
+        if(!enabled()){
+            return;
+        }
+
+        if(0 == sql || 0 == strchr(sql, ';')){
+            if(!is_write_statement(sql)){
+                return;
+            }
+
+            std::vector<std::string> tables;
+            db_helper::instance().get_sql_tables(sql, tables);
+            if(tables.empty()){
+                clear();
+                return;
+            }
+
+            invalidate(tables);
+            return;
+        }
+
+        // 多语句文本逐条判断, 汇总各写语句引用的表
+        std::vector<std::string> statements;
+        db_helper::instance().split_statements(sql, statements);
+
+        std::vector<std::string> tables;
+        bool has_write = false;
+        for(auto& it : statements){
+            if(!is_write_statement(it.c_str())){
+                continue;
+            }
+            has_write = true;
+
+            std::vector<std::string> stmt_tables;
+            db_helper::instance().get_sql_tables(it.c_str(), stmt_tables);
+            if(stmt_tables.empty()){
+                clear();
+                return;
+            }
+            tables.insert(tables.end(), stmt_tables.begin(), stmt_tables.end());
+        }
+
+        if(has_write){
+            invalidate(tables);
+        }
+    }
+
+    void query_cache::invalidate(const std::vector<std::string>& tables)
+    {
+        // 先加1, 使正在进行的查询不再写入
+        m_epoch.fetch_add(1, std::memory_order_acq_rel);
+
+        for(auto& s : m_shards){
+            std::lock_guard<std::mutex> lock(s.m_mutex);
+            for(auto& table : tables){
+                auto fi = s.m_table_keys.find(table);
+                if(fi == s.m_table_keys.end()){
+                    continue;
+                }
+
+                // erase会修改m_table_keys, 先取出键
+                std::vector<std::string> keys(fi->second.begin(), fi->second.end());
+                for(auto& key : keys){
+                    auto ei = s.m_entry_map.find(key);
+                    if(ei != s.m_entry_map.end()){
+                        erase(s, ei->second);
+                        ++m_invalidations;
+                    }
+                }
+            }
+        }
+    }
+
+    void query_cache::clear()
+    {
+        m_epoch.fetch_add(1, std::memory_order_acq_rel);
+
+        for(auto& s : m_shards){
+            std::lock_guard<std::mutex> lock(s.m_mutex);
+            m_invalidations += s.m_lru_list.size();
+            s.m_lru_list.clear();
+            s.m_entry_map.clear();
+            s.m_table_keys.clear();
+            s.m_bytes = 0;
+        }
+    }
+
+    query_cache_stats query_cache::get_stats()
+    {
+        query_cache_stats stats;
+        stats.m_hits = m_hits;
+        stats.m_misses = m_misses;
+        stats.m_evictions = m_evictions;
+        stats.m_expirations = m_expirations;
+        stats.m_invalidations = m_invalidations;
+        stats.m_entries = 0;
+        stats.m_bytes = 0;
+
+        for(auto& s : m_shards){
+            std::lock_guard<std::mutex> lock(s.m_mutex);
+            stats.m_entries += s.m_lru_list.size();
+            stats.m_bytes += s.m_bytes;
+        }
+
+        return stats;
+    }
+
+    void query_cache::erase(shard& s, entry_iter it)
+    {
+        for(auto& table : it->m_tables){
+            auto fi = s.m_table_keys.find(table);
+            if(fi != s.m_table_keys.end()){
+                fi->second.erase(it->m_key);
+                if(fi->second.empty()){
+                    s.m_table_keys.erase(fi);
+                }
+            }
+        }
+
+        s.m_bytes -= it->m_bytes;
+        s.m_entry_map.erase(it->m_key);
+        s.m_lru_list.erase(it);
+    }
+}
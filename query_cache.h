@@ -0,0 +1,358 @@
+/*
+* @file
+    query_cache.h
+
+* @brief
+    进程内查询结果缓存类
+
+* @version
+    V1.0
+
+* @author
+    agent
+
+* @date
+    2026/10/19
+
+* @note
+    以规范化后的SQL文本为键缓存SELECT结果的紧凑副本(cached_result), 按键分片,
+    每个分片独立加锁并按LRU淘汰。条目有TTL, 总内存和单条内存都有上限。
+    同一连接池执行写语句后按表失效引用该表的条目; 无法识别表名的写语句清空整个缓存
+
+* @warning
+    只能感知经由同一连接池的写操作, 其他进程或连接的修改只能依靠TTL过期
+* @bug
+* @copyright
+*/
+#ifndef zdb_query_cache_h
+#define zdb_query_cache_h
+#include <mysql.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "field_index.h"
+#include "result_budget.h"
+
+namespace zdb{
+    const size_t QUERY_CACHE_SHARD_COUNT = 16;      // 缓存分片数
+
+    // 结果集的只读紧凑副本, 全部字段值存放在一块连续内存中
+    class cached_result{
+        private:
+        friend class result_snapshot;
+
+        std::vector<char> m_data;               // 各字段值, 以'\0'结尾依次存放
+        std::shared_ptr<const void> m_mapping;  // 字段值在快照文件映射中时持有该映射, 此时m_data为空
+        std::vector<char*> m_cells;             // 按行存放的字段指针, NULL字段为0
+        std::vector<unsigned long> m_lengths;   // 按行存放的字段长度
+        ptr_field_index m_field_index;          // 字段名-字段下标
+        std::vector<enum_field_types> m_field_types;    // 字段类型
+        std::vector<unsigned int> m_field_flags;        // 字段标志(UNSIGNED_FLAG等), 来自快照的副本为0
+        int m_field_count;                      // 字段个数
+        size_t m_row_count;                     // 记录数
+        ptr_result_budget m_budget;             // 逐行构建时记入的预算, 析构时归还
+        size_t m_charged;                       // 已记入预算的字节数
+        std::vector<size_t> m_offsets;          // 逐行构建期间各字段值在m_data中的偏移, finish后清空
+
+        cached_result(const cached_result&);
+        cached_result& operator=(const cached_result&);
+
+        public:
+        cached_result();
+        ~cached_result();
+
+        /*
+		* @brief	复制MYSQL_RES中的全部记录函数。
+		* @param 	[in]  MYSQL_RES* res        mysql_store_result得到的结果集\n
+		* @param 	[in]  size_t max_bytes      最大占用内存, 0不限制\n
+		* @return 	返回是否成功, 超出max_bytes时返回false
+		* @note
+		    完成后res的游标回到第一行
+		* @warning
+		* @bug
+		*/
+        bool build(MYSQL_RES* res, size_t max_bytes);
+        /*
+		* @brief	开始逐行构建函数。
+		* @param 	[in]  MYSQL_RES* res                mysql_use_result得到的结果集, 只读取列信息\n
+		* @param 	[in]  MYSQL_FIELD* fields           列信息, 只用到name/name_length/type\n
+		* @param 	[in]  int count                     列数\n
+		* @param 	[in]  ptr_result_budget budget      记入内存的预算, 可为空\n
+		* @return 	无
+		* @note
+		    之后对每行调用append, 最后调用finish
+		* @warning
+		* @bug
+		*/
+        void begin(MYSQL_RES* res, ptr_result_budget budget);
+        void begin(const MYSQL_FIELD* fields, int count, ptr_result_budget budget);
+        /*
+		* @brief	追加一行函数。
+		* @param 	[in]  MYSQL_ROW row             行\n
+		* @param 	[in]  unsigned long* lengths    各字段长度\n
+		* @return 	返回记入后是否仍在全池预算内
+		* @note
+		    该行总是被追加
+		* @warning
+		* @bug
+		*/
+        bool append(MYSQL_ROW row, unsigned long* lengths);
+        /*
+		* @brief	结束逐行构建函数。
+		* @param 	无\n
+		* @return 	无
+		* @note
+		    把偏移换算成字段指针, 之后不可再append
+		* @warning
+		* @bug
+		*/
+        void finish();
+
+        /*
+		* @brief	归还预算函数。
+		* @param 	无\n
+		* @return 	无
+		* @note
+		    副本放入查询缓存后调用, 缓存中的副本只按缓存容量计量, 不再占用连接池的结果集预算
+		* @warning
+		    只能由构建副本的线程调用, 不影响其他线程读取记录
+		* @bug
+		*/
+        void release_budget();
+
+        // 返回逐行构建时记入预算的字节数
+        size_t get_charged() const
+        {
+            return m_charged;
+        }
+
+        // 返回第row行的字段指针数组, 与MYSQL_ROW相同
+        MYSQL_ROW get_row(size_t row) const
+        {
+            return const_cast<MYSQL_ROW>(m_cells.data() + row * m_field_count);
+        }
+
+        unsigned long* get_lengths(size_t row) const
+        {
+            return const_cast<unsigned long*>(m_lengths.data() + row * m_field_count);
+        }
+
+        int get_field_count() const
+        {
+            return m_field_count;
+        }
+
+        size_t get_row_count() const
+        {
+            return m_row_count;
+        }
+
+        const ptr_field_index& get_field_index() const
+        {
+            return m_field_index;
+        }
+
+        // 返回第idx个字段的类型, 来自快照的副本为快照中记录的类型
+        enum_field_types get_field_type(int idx) const
+        {
+            return m_field_types[idx];
+        }
+
+        // 返回第idx个字段的标志
+        unsigned int get_field_flags(int idx) const
+        {
+            return m_field_flags[idx];
+        }
+
+        // 返回占用的内存字节数
+        size_t get_bytes() const
+        {
+            return sizeof(*this) + m_data.capacity() + m_cells.capacity() * sizeof(char*)
+                + m_lengths.capacity() * sizeof(unsigned long);
+        }
+    };
+
+    typedef std::shared_ptr<const cached_result> ptr_cached_result;
+
+    struct query_cache_stats{
+        uint64_t m_hits;            // 命中次数
+        uint64_t m_misses;          // 未命中次数
+        uint64_t m_evictions;       // 因内存上限淘汰的条目数
+        uint64_t m_expirations;     // 因TTL过期删除的条目数
+        uint64_t m_invalidations;   // 因写操作失效的条目数
+        size_t m_entries;           // 当前条目数
+        size_t m_bytes;             // 当前占用内存字节数
+    };
+
+    class query_cache{
+        private:
+        typedef std::chrono::steady_clock clock;
+
+        struct entry{
+            std::string m_key;                  // 规范化后的SQL
+            ptr_cached_result m_result;         // 结果副本
+            clock::time_point m_expire;         // 过期时间
+            std::vector<std::string> m_tables;  // 引用的表
+            size_t m_bytes;                     // 占用内存
+        };
+
+        typedef std::list<entry>::iterator entry_iter;
+
+        struct shard{
+            std::mutex m_mutex;
+            std::list<entry> m_lru_list;                                                // 最近使用的在表头
+            std::unordered_map<std::string, entry_iter> m_entry_map;                   // 键-条目
+            std::unordered_map<std::string, std::unordered_set<std::string>> m_table_keys;  // 表名-键
+            size_t m_bytes;
+        };
+
+        shard m_shards[QUERY_CACHE_SHARD_COUNT];
+        std::atomic<size_t> m_capacity;         // 总内存上限, 0为不启用
+        std::atomic<size_t> m_max_entry_bytes;  // 单条内存上限
+        std::atomic<unsigned int> m_ttl;        // 默认TTL, 毫秒
+        std::atomic<uint64_t> m_epoch;          // 每次失效加1, 用于丢弃失效前开始的查询结果
+
+        std::atomic<uint64_t> m_hits;
+        std::atomic<uint64_t> m_misses;
+        std::atomic<uint64_t> m_evictions;
+        std::atomic<uint64_t> m_expirations;
+        std::atomic<uint64_t> m_invalidations;
+
+        query_cache(const query_cache&);
+        query_cache& operator=(const query_cache&);
+
+        public:
+        query_cache();
+
+        /*
+		* @brief	设置缓存参数函数。
+		* @param 	[in]  size_t capacity           总内存上限(字节), 0为不启用\n
+		* @param 	[in]  size_t max_entry_bytes    单条内存上限(字节), 0为capacity/分片数\n
+		* @param 	[in]  unsigned int ttl          默认TTL(毫秒)\n
+		* @return 	无
+		* @note
+		    会清空已有条目
+		* @warning
+		* @bug
+		*/
+        void configure(size_t capacity, size_t max_entry_bytes, unsigned int ttl);
+
+        bool enabled() const
+        {
+            return m_capacity.load(std::memory_order_relaxed) > 0;
+        }
+
+        unsigned int get_ttl() const
+        {
+            return m_ttl;
+        }
+
+        size_t get_max_entry_bytes() const
+        {
+            return m_max_entry_bytes;
+        }
+
+        uint64_t get_epoch() const
+        {
+            return m_epoch.load(std::memory_order_acquire);
+        }
+
+        /*
+		* @brief	查找缓存条目函数。
+		* @param 	[in]  std::string& key  规范化后的SQL\n
+		* @return 	返回结果副本, 未命中或已过期时为空
+		* @note
+		* @warning
+		* @bug
+		*/
+        ptr_cached_result get(const std::string& key);
+        /*
+		* @brief	添加缓存条目函数。
+		* @param 	[in]  std::string& key                      规范化后的SQL\n
+		* @param 	[in]  ptr_cached_result result              结果副本\n
+		* @param 	[in]  std::vector<std::string>& tables      引用的表\n
+		* @param 	[in]  unsigned int ttl                      TTL(毫秒)\n
+		* @param 	[in]  uint64_t epoch                        开始查询前的get_epoch()\n
+		* @return 	返回是否已缓存
+		* @note
+		    查询期间发生过失效时不缓存, 避免缓存失效前读到的旧数据
+		* @warning
+		* @bug
+		*/
+        bool put(const std::string& key, ptr_cached_result result, const std::vector<std::string>& tables, unsigned int ttl, uint64_t epoch);
+        /*
+		* @brief	按写语句失效缓存函数。
+		* @param 	[in]  const char* sql  已执行的写语句\n
+		* @return 	无
+		* @note
+		    读语句不处理; 无法识别表名时清空整个缓存; 多条语句时按每条写语句引用的表失效
+		* @warning
+		* @bug
+		*/
+        void invalidate_sql(const char* sql);
+        /*
+		* @brief	判断语句是否可能修改数据函数。
+		* @param 	[in]  const char* sql  SQL语句\n
+		* @return 	返回是否可能修改数据
+		* @note
+		    SELECT/SHOW/SET/DO/HANDLER及事务控制语句等返回false, WITH按其主语句判断, 其余(含CALL)返回true;
+		    含多条语句时按顶层分号拆分, 任一条为写语句即返回true
+		* @warning
+		* @bug
+		*/
+        static bool is_write_sql(const char* sql);
+        /*
+		* @brief	失效引用指定表的条目函数。
+		* @param 	[in]  std::vector<std::string>& tables  小写表名\n
+		* @return 	无
+		* @note
+		* @warning
+		* @bug
+		*/
+        void invalidate(const std::vector<std::string>& tables);
+        /*
+		* @brief	清空缓存函数。
+		* @param 	无\n
+		* @return 	无
+		* @note
+		* @warning
+		* @bug
+		*/
+        void clear();
+        /*
+		* @brief	获得统计信息函数。
+		* @param 	无\n
+		* @return 	返回统计信息
+		* @note
+		* @warning
+		* @bug
+		*/
+        query_cache_stats get_stats();
+
+        private:
+        shard& get_shard(const std::string& key)
+        {
+            return m_shards[std::hash<std::string>()(key) % QUERY_CACHE_SHARD_COUNT];
+        }
+
+        /*
+		* @brief	删除条目函数, 调用前需持有分片锁。
+		* @param 	[in]  shard& s          分片\n
+		* @param 	[in]  entry_iter it     条目\n
+		* @return 	无
+		* @note
+		* @warning
+		* @bug
+		*/
+        void erase(shard& s, entry_iter it);
+    };
+}
+
+#endif
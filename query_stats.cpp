@@ -0,0 +1,205 @@
+#include "query_stats.h"
+#include "helper.h"
+#include <string.h>
+#include <algorithm>
+
+namespace zdb{
+    static const uint64_t OTHER_DIGEST_HASH = 0;    // 超出指纹数上限的语句合并到的汇总
+
+    // 返回耗时所在的直方图桶
+    static int get_bucket(uint64_t us)
+    {
+        int bucket = 0;
+        while(us > 0 && bucket < QUERY_STATS_BUCKET_COUNT - 1){
+            us >>= 1;
+            ++bucket;
+        }
+
+        return bucket;
+    }
+
+    uint64_t query_digest::get_percentile(double p) const
+    {
+        if(0 == m_count){
+            return 0;
+        }
+
+        uint64_t rank = (uint64_t)(p * m_count + 0.5);
+        if(rank < 1){
+            rank = 1;
+        }
+
+        uint64_t seen = 0;
+        for(int i = 0; i < QUERY_STATS_BUCKET_COUNT; ++i){
+            seen += m_buckets[i];
+            if(seen >= rank){
+                uint64_t upper = (0 == i)?0:((uint64_t)1 << i) - 1;
+                return std::min(upper, m_max_us);
+            }
+        }
+
+        return m_max_us;
+    }
+
+    query_stats::query_stats()
+        : m_enabled(false)
+        , m_slow_us(0)
+        , m_digest_count(0)
+        , m_slow_log_size(0)
+        , m_slow_count(0)
+    {
+    }
+
+    void query_stats::configure(bool enabled, unsigned int slow_ms, size_t slow_log_size)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_slow_mtx);
+            m_slow_log_size = slow_log_size;
+            while(m_slow_log.size() > m_slow_log_size){
+                m_slow_log.pop_front();
+            }
+        }
+
+        m_slow_us = (uint64_t)slow_ms * 1000;
+        m_enabled = enabled;
+    }
+
+    void query_stats::set_slow_handler(const slow_query_handler& fn)
+    {
+        std::lock_guard<std::mutex> lock(m_slow_mtx);
+        m_slow_handler = fn;
+    }
+
+    void query_stats::record(const char* sql, uint64_t lease_us, uint64_t exec_us, bool ok)
+    {
+        // 复用每个线程的缓冲区, 已有指纹不分配内存
+        thread_local std::string fingerprint;
+        uint64_t hash = db_helper::instance().fingerprint_sql(sql, fingerprint);
+        if(OTHER_DIGEST_HASH == hash){
+            hash = 1;
+        }
+
+        shard& s = m_shards[hash % QUERY_STATS_SHARD_COUNT];
+        {
+            std::lock_guard<std::mutex> lock(s.m_mutex);
+            auto it = s.m_digests.find(hash);
+            if(it == s.m_digests.end()){
+                bool other = (m_digest_count.load(std::memory_order_relaxed) >= QUERY_STATS_MAX_DIGESTS);
+                uint64_t key = other?OTHER_DIGEST_HASH:hash;
+                it = s.m_digests.find(key);
+                if(it == s.m_digests.end()){
+                    query_digest digest;
+                    memset(digest.m_buckets, 0, sizeof(digest.m_buckets));
+                    digest.m_fingerprint = other?"<other>":fingerprint;
+                    digest.m_hash = key;
+                    digest.m_count = 0;
+                    digest.m_errors = 0;
+                    digest.m_total_us = 0;
+                    digest.m_lease_us = 0;
+                    digest.m_max_us = 0;
+                    it = s.m_digests.emplace(key, digest).first;
+                    ++m_digest_count;
+                }
+            }
+
+            query_digest& digest = it->second;
+            ++digest.m_count;
+            if(!ok){
+                ++digest.m_errors;
+            }
+            digest.m_total_us += exec_us;
+            digest.m_lease_us += lease_us;
+            digest.m_max_us = std::max(digest.m_max_us, exec_us);
+            ++digest.m_buckets[get_bucket(exec_us)];
+        }
+
+        uint64_t slow_us = m_slow_us.load(std::memory_order_relaxed);
+        if(0 == slow_us || lease_us + exec_us < slow_us){
+            return;
+        }
+
+        slow_query query;
+        query.m_sql.assign(sql?sql:"", sql?std::min(strlen(sql), SLOW_QUERY_MAX_SQL_LENGTH):0);
+        query.m_fingerprint = fingerprint;
+        query.m_lease_us = lease_us;
+        query.m_exec_us = exec_us;
+        query.m_ok = ok;
+        query.m_time = std::chrono::system_clock::now();
+
+        slow_query_handler handler;
+        {
+            std::lock_guard<std::mutex> lock(m_slow_mtx);
+            ++m_slow_count;
+            if(m_slow_log_size > 0){
+                if(m_slow_log.size() >= m_slow_log_size){
+                    m_slow_log.pop_front();
+                }
+                m_slow_log.push_back(query);
+            }
+            handler = m_slow_handler;
+        }
+
+        // 回调在锁外调用, 回调中可以读取统计
+        if(handler){
+            handler(query);
+        }
+    }
+
+    void query_stats::get_digests(std::vector<query_digest>& digests)
+    {
+        digests.clear();
+
+        // "<other>"在各分片中各有一条, 合并为一条
+        int other = -1;
+        for(auto& s : m_shards){
+            std::lock_guard<std::mutex> lock(s.m_mutex);
+            for(auto& it : s.m_digests){
+                if(it.first != OTHER_DIGEST_HASH){
+                    digests.push_back(it.second);
+                    continue;
+                }
+
+                if(other < 0){
+                    other = (int)digests.size();
+                    digests.push_back(it.second);
+                    continue;
+                }
+
+                query_digest& digest = digests[other];
+                digest.m_count += it.second.m_count;
+                digest.m_errors += it.second.m_errors;
+                digest.m_total_us += it.second.m_total_us;
+                digest.m_lease_us += it.second.m_lease_us;
+                digest.m_max_us = std::max(digest.m_max_us, it.second.m_max_us);
+                for(int i = 0; i < QUERY_STATS_BUCKET_COUNT; ++i){
+                    digest.m_buckets[i] += it.second.m_buckets[i];
+                }
+            }
+        }
+
+        std::sort(digests.begin(), digests.end(), [](const query_digest& a, const query_digest& b){
+            return a.m_total_us > b.m_total_us;
+        });
+    }
+
+    uint64_t query_stats::get_slow_queries(std::vector<slow_query>& queries)
+    {
+        std::lock_guard<std::mutex> lock(m_slow_mtx);
+        queries.assign(m_slow_log.begin(), m_slow_log.end());
+
+        return m_slow_count;
+    }
+
+    void query_stats::reset()
+    {
+        for(auto& s : m_shards){
+            std::lock_guard<std::mutex> lock(s.m_mutex);
+            s.m_digests.clear();
+        }
+        m_digest_count = 0;
+
+        std::lock_guard<std::mutex> lock(m_slow_mtx);
+        m_slow_log.clear();
+        m_slow_count = 0;
+    }
+}
@@ -0,0 +1,260 @@
+/*
+* @file
+    query_stats.h
+
+* @brief
+    按SQL指纹聚合的语句耗时统计和慢查询日志类
+
+* @version
+    V1.0
+
+* @author
+    agent
+
+* @date
+    2026/10/19
+
+* @note
+    连接池启用语句统计(db_pool_setting::set_query_stats)后, 每条经由连接池执行的语句
+    (query、execute系列、预处理和异步语句)都被计时: 等待租用连接(异步语句为排队)的时间与执行时间分开记录。
+    语句按db_helper::fingerprint_sql的指纹聚合次数、失败次数、总耗时和按2的幂分桶的耗时直方图;
+    总耗时超过阈值的语句记入慢查询日志, 保留最近的若干条并可回调。
+
+    按指纹哈希分片, 每个分片独立加锁, 每条语句的额外开销为一次指纹计算、三次取时钟和一次分片查找,
+    不超过1微秒; 未启用时只有一次原子读。
+
+* @warning
+    不同指纹数超过上限后, 新指纹的语句合并到指纹"<other>"中
+* @bug
+* @copyright
+*/
+#ifndef zdb_query_stats_h
+#define zdb_query_stats_h
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "workload_capture.h"
+
+namespace zdb{
+    const size_t QUERY_STATS_SHARD_COUNT   = 16;    // 统计分片数
+    const int QUERY_STATS_BUCKET_COUNT     = 32;    // 耗时直方图桶数, 第0桶小于1微秒, 第i桶为[2^(i-1), 2^i)微秒, 末桶含更长
+    const size_t QUERY_STATS_MAX_DIGESTS   = 4096;  // 最多统计的不同指纹数
+    const size_t SLOW_QUERY_MAX_SQL_LENGTH = 1024;  // 慢查询日志中保留的SQL长度
+
+    // 一个指纹的汇总
+    struct query_digest{
+        std::string m_fingerprint;      // 指纹文本
+        uint64_t m_hash;                // 指纹哈希
+        uint64_t m_count;               // 执行次数
+        uint64_t m_errors;              // 失败次数
+        uint64_t m_total_us;            // 执行时间之和(微秒), 不含等待连接
+        uint64_t m_lease_us;            // 等待租用连接的时间之和(微秒)
+        uint64_t m_max_us;              // 最长执行时间(微秒)
+        uint64_t m_buckets[QUERY_STATS_BUCKET_COUNT];   // 执行时间直方图
+
+        /*
+		* @brief	按直方图估算执行时间百分位函数。
+		* @param 	[in]  double p  百分位, 取值(0, 1]\n
+		* @return 	返回所在桶的上界(微秒), 不超过m_max_us
+		* @note
+		* @warning
+		* @bug
+		*/
+        uint64_t get_percentile(double p) const;
+    };
+
+    // 一条慢查询
+    struct slow_query{
+        std::string m_sql;                              // 原始SQL, 超过SLOW_QUERY_MAX_SQL_LENGTH时截断
+        std::string m_fingerprint;                      // 指纹文本
+        uint64_t m_lease_us;                            // 等待租用连接(异步语句为排队)的时间(微秒)
+        uint64_t m_exec_us;                             // 执行时间(微秒)
+        bool m_ok;                                      // 是否执行成功
+        std::chrono::system_clock::time_point m_time;   // 完成时间
+    };
+
+    typedef std::function<void(const slow_query&)> slow_query_handler;
+
+    class query_stats{
+        private:
+        struct shard{
+            std::mutex m_mutex;
+            std::unordered_map<uint64_t, query_digest> m_digests;     // 指纹哈希-汇总
+        };
+
+        shard m_shards[QUERY_STATS_SHARD_COUNT];
+        std::atomic<bool> m_enabled;            // 是否启用
+        std::atomic<uint64_t> m_slow_us;        // 慢查询阈值(微秒), 0不记录
+        std::atomic<size_t> m_digest_count;     // 不同指纹数
+
+        std::mutex m_slow_mtx;
+        std::deque<slow_query> m_slow_log;      // 最近的慢查询, 新的在尾部
+        size_t m_slow_log_size;                 // 保留的慢查询数
+        slow_query_handler m_slow_handler;      // 慢查询回调
+        uint64_t m_slow_count;                  // 慢查询总数
+
+        query_stats(const query_stats&);
+        query_stats& operator=(const query_stats&);
+
+        public:
+        query_stats();
+
+        /*
+		* @brief	设置统计参数函数。
+		* @param 	[in]  bool enabled              是否启用\n
+		* @param 	[in]  unsigned int slow_ms      慢查询阈值(毫秒), 等待连接与执行时间之和超过时记录, 0不记录\n
+		* @param 	[in]  size_t slow_log_size      保留的慢查询数\n
+		* @return 	无
+		* @note
+		    不清空已有统计
+		* @warning
+		* @bug
+		*/
+        void configure(bool enabled, unsigned int slow_ms, size_t slow_log_size);
+
+        bool enabled() const
+        {
+            return m_enabled.load(std::memory_order_relaxed);
+        }
+
+        /*
+		* @brief	设置慢查询回调函数。
+		* @param 	[in]  slow_query_handler fn  回调, 为空时取消\n
+		* @return 	无
+		* @note
+		    在执行语句的线程中调用, 回调应尽快返回
+		* @warning
+		* @bug
+		*/
+        void set_slow_handler(const slow_query_handler& fn);
+        /*
+		* @brief	记录一条语句函数。
+		* @param 	[in]  const char* sql       SQL语句\n
+		* @param 	[in]  uint64_t lease_us     等待租用连接的时间(微秒)\n
+		* @param 	[in]  uint64_t exec_us      执行时间(微秒)\n
+		* @param 	[in]  bool ok               是否执行成功\n
+		* @return 	无
+		* @note
+		* @warning
+		* @bug
+		*/
+        void record(const char* sql, uint64_t lease_us, uint64_t exec_us, bool ok);
+        /*
+		* @brief	获得各指纹的汇总函数。
+		* @param 	[out] std::vector<query_digest>& digests  汇总, 按执行时间之和降序\n
+		* @return 	无
+		* @note
+		* @warning
+		* @bug
+		*/
+        void get_digests(std::vector<query_digest>& digests);
+        /*
+		* @brief	获得最近的慢查询函数。
+		* @param 	[out] std::vector<slow_query>& queries  慢查询, 按完成时间升序\n
+		* @return 	返回启用以来的慢查询总数
+		* @note
+		* @warning
+		* @bug
+		*/
+        uint64_t get_slow_queries(std::vector<slow_query>& queries);
+        /*
+		* @brief	清空统计和慢查询日志函数。
+		* @param 	无\n
+		* @return 	无
+		* @note
+		* @warning
+		* @bug
+		*/
+        void reset();
+    };
+
+    /*
+    * @brief
+        语句计时器。构造时开始计时, 租到连接后调用leased, 析构时记入query_stats和workload_capture;
+        统计和录制都未启用时不取时钟。
+    */
+    class query_timer{
+        private:
+        typedef std::chrono::steady_clock clock;
+
+        query_stats* m_stats;           // 未启用时为0
+        workload_capture* m_capture;    // 未录制时为0
+        const char* m_sql;
+        clock::time_point m_start;      // 开始等待连接
+        clock::time_point m_leased;     // 租到连接, 未租到时为初值
+        bool m_ok;
+        bool m_prepared;                // 是否预处理语句
+        const std::vector<std::string>* m_batch;    // 批量执行的各语句, 录制时逐条记录
+        size_t m_batch_ok;              // 批量执行中已确认成功的语句数
+
+        query_timer(const query_timer&);
+        query_timer& operator=(const query_timer&);
+
+        public:
+        query_timer(query_stats& stats, workload_capture& capture, const char* sql, bool prepared = false)
+            : m_stats(stats.enabled()?&stats:0), m_capture(capture.active()?&capture:0), m_sql(sql), m_ok(false), m_prepared(prepared)
+            , m_batch(0), m_batch_ok(0)
+        {
+            if(m_stats || m_capture){
+                m_start = clock::now();
+            }
+        }
+
+        ~query_timer()
+        {
+            if(0 == m_stats && 0 == m_capture){
+                return;
+            }
+
+            clock::time_point end = clock::now();
+            if(clock::time_point() == m_leased){
+                m_leased = end;
+            }
+
+            uint64_t lease_us = std::chrono::duration_cast<std::chrono::microseconds>(m_leased - m_start).count();
+            uint64_t exec_us = std::chrono::duration_cast<std::chrono::microseconds>(end - m_leased).count();
+            if(m_stats){
+                m_stats->record(m_sql, lease_us, exec_us, m_ok);
+            }
+            if(m_capture && m_batch){
+                // 整批只有一次往返, 各语句共用开始时刻, 等待连接计入第一条, 执行时间平均分摊
+                size_t count = m_batch->size();
+                uint64_t each_us = count > 0?exec_us / count:0;
+                for(size_t i = 0; i < count; ++i){
+                    bool ok = m_ok || i < m_batch_ok;
+                    m_capture->record(m_start, (*m_batch)[i].c_str(), 0 == i?lease_us:0, each_us, (ok?workload_flag_ok:0) | workload_flag_batch);
+                }
+            }else if(m_capture){
+                m_capture->record(m_start, m_sql, lease_us, exec_us, (m_ok?workload_flag_ok:0) | (m_prepared?workload_flag_prepared:0));
+            }
+        }
+
+        // 租到连接时调用, 未调用时全部时间计为等待连接
+        void leased()
+        {
+            if(m_stats || m_capture){
+                m_leased = clock::now();
+            }
+        }
+
+        void set_ok(bool ok)
+        {
+            m_ok = ok;
+        }
+
+        // 批量执行时调用, 统计仍按构造时的语句记录一条, 录制则每条语句记录一条; sqls须在析构前有效
+        void set_batch(const std::vector<std::string>& sqls, size_t ok_count)
+        {
+            m_batch = &sqls;
+            m_batch_ok = ok_count;
+        }
+    };
+}
+
+#endif
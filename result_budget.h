@@ -0,0 +1,129 @@
+/*
+* @file
+    result_budget.h
+
+* @brief
+    缓冲结果集的内存计量类
+
+* @version
+    V1.0
+
+* @author
+    agent
+
+* @date
+    2026/10/19
+
+* @note
+    连接池启用结果集内存预算(db_pool_setting::set_result_budget)后, db_pool::query
+    改用mysql_use_result逐行读取并复制到cached_result, 每复制一行就把该行占用的内存
+    记入result_budget, 超出单查询或全池预算时按设置中止查询或转为流式读取。
+    cached_result释放时归还记入的内存, 因此get_bytes即当前存活的缓冲结果集占用的内存。
+
+* @warning
+* @bug
+* @copyright
+*/
+#ifndef zdb_result_budget_h
+#define zdb_result_budget_h
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+
+namespace zdb{
+    struct result_memory_stats{
+        size_t m_bytes;         // 存活的缓冲结果集占用的内存
+        size_t m_peak_bytes;    // m_bytes的峰值
+        size_t m_results;       // 存活的缓冲结果集个数
+        size_t m_limit;         // 全池预算, 0不限制
+        uint64_t m_aborted;     // 因超出预算中止的查询数
+        uint64_t m_streamed;    // 因超出预算转为流式读取的查询数
+    };
+
+    class result_budget{
+        private:
+        std::atomic<size_t> m_bytes;
+        std::atomic<size_t> m_peak_bytes;
+        std::atomic<size_t> m_results;
+        std::atomic<size_t> m_limit;
+        std::atomic<uint64_t> m_aborted;
+        std::atomic<uint64_t> m_streamed;
+
+        result_budget(const result_budget&);
+        result_budget& operator=(const result_budget&);
+
+        public:
+        result_budget(size_t limit = 0)
+            : m_bytes(0), m_peak_bytes(0), m_results(0), m_limit(limit), m_aborted(0), m_streamed(0)
+        {
+        }
+
+        void set_limit(size_t limit)
+        {
+            m_limit = limit;
+        }
+
+        /*
+		* @brief	记入内存函数。
+		* @param 	[in]  size_t bytes  字节数\n
+		* @return 	返回记入后是否仍在全池预算内
+		* @note
+		    总是记入, 由调用者决定超出后是否中止
+		* @warning
+		* @bug
+		*/
+        bool charge(size_t bytes)
+        {
+            size_t total = m_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+            size_t peak = m_peak_bytes.load(std::memory_order_relaxed);
+            while(total > peak && !m_peak_bytes.compare_exchange_weak(peak, total, std::memory_order_relaxed)){
+            }
+
+            size_t limit = m_limit.load(std::memory_order_relaxed);
+            return 0 == limit || total <= limit;
+        }
+
+        void release(size_t bytes)
+        {
+            m_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+        }
+
+        void add_result()
+        {
+            ++m_results;
+        }
+
+        void remove_result()
+        {
+            --m_results;
+        }
+
+        void on_aborted()
+        {
+            ++m_aborted;
+        }
+
+        void on_streamed()
+        {
+            ++m_streamed;
+        }
+
+        result_memory_stats get_stats() const
+        {
+            result_memory_stats stats;
+            stats.m_bytes = m_bytes;
+            stats.m_peak_bytes = m_peak_bytes;
+            stats.m_results = m_results;
+            stats.m_limit = m_limit;
+            stats.m_aborted = m_aborted;
+            stats.m_streamed = m_streamed;
+
+            return stats;
+        }
+    };
+
+    typedef std::shared_ptr<result_budget> ptr_result_budget;
+}
+
+#endif
@@ -1,4 +1,7 @@
 #include "result_set.h"
+#include "text_decoder.h"
+#include <stdlib.h>
+#include <string.h>
 #include <string>
 
 namespace zdb{
@@ -6,7 +9,10 @@ namespace zdb{
     {
         m_query_res = 0;
         m_cur_row = 0;
+        m_cur_lengths = 0;
         m_field_count = 0;
+        m_stream_conn = 0;
+        m_cached_pos = 0;
     }
 
     result_set::~result_set()
@@ -20,14 +26,7 @@ namespace zdb{
             return;
         }
 
-        for(int i = 0;i < m_field_count; ++i){
-            MYSQL_FIELD* ptr_field = mysql_fetch_field_direct(m_query_res, i);
-            if(NULL == ptr_field){
-                continue;
-            }
-
-            m_field_idx_list.insert(std::make_pair(ptr_field->name, i));
-        }
+        m_field_index = field_index_cache::instance().acquire(mysql_fetch_fields(m_query_res), m_field_count);
     }
 
     bool result_set::bind(MYSQL_RES* res, std::string& error)
@@ -44,32 +43,104 @@ namespace zdb{
 
         m_field_count = mysql_num_fields(res);
 
-        create_filed_idx_list();
+        return true;
+    }
+
+    bool result_set::bind_cached(ptr_cached_result res, std::string& error)
+    {
+        close();
+
+        if(!res){
+            error = "cached result is null";
+            return false;
+        }
+
+        m_cached = res;
+        m_cached_pos = 0;
+        m_field_count = res->get_field_count();
+        m_field_index = res->get_field_index();
+
+        return true;
+    }
+
+    MYSQL_ROW result_set::fetch_row(unsigned long*& lengths)
+    {
+        lengths = 0;
+
+        if(m_cached){
+            if(m_cached_pos < m_cached->get_row_count()){
+                lengths = m_cached->get_lengths(m_cached_pos);
+                return m_cached->get_row(m_cached_pos++);
+            }
+
+            // 超出内存预算转为流式时, 已缓冲的行读完后继续从连接读取
+            if(0 == m_query_res){
+                return 0;
+            }
+        }
+
+        MYSQL_ROW row = mysql_fetch_row(m_query_res);
+        if(row){
+            lengths = mysql_fetch_lengths(m_query_res);
+        }
+
+        return row;
+    }
+
+    bool result_set::bind_stream(MYSQL_RES* res, MYSQL* conn, std::string& error)
+    {
+        if(!bind(res, error)){
+            return false;
+        }
+
+        m_stream_conn = conn;
 
         return true;
     }
 
     void result_set::close()
     {
-        if(0 == m_query_res){
+        if(0 == m_query_res && !m_cached){
             return;
         }
 
-        mysql_free_result(m_query_res);
+        // 流式结果集释放时会读完并丢弃剩余的行
+        if(m_query_res){
+            mysql_free_result(m_query_res);
+        }
         m_query_res = 0;
+        m_cached.reset();
+        m_cached_pos = 0;
         m_cur_row = 0;
+        m_cur_lengths = 0;
         m_field_count = 0;
-        m_field_idx_list.erase(m_field_idx_list.begin(), m_field_idx_list.end());
-        m_field_idx_list.clear();
+        m_stream_conn = 0;
+        m_field_index.reset();
+
+        if(m_release){
+            std::function<void()> release;
+            release.swap(m_release);
+            release();
+        }
     }
 
     bool result_set::seek(my_ulonglong offset, std::string& error)
     {
-        if(0 == m_query_res){
+        if(0 == m_query_res && !m_cached){
             error = "result_set::m_query_res is not initialized.";
             return false;
         }
 
+        if(m_stream_conn){
+            error = "seek is not supported on a streaming result_set.";
+            return false;
+        }
+
+        if(m_cached){
+            m_cached_pos = (size_t)offset;
+            return true;
+        }
+
         mysql_data_seek(m_query_res, offset);
 
         return true;
@@ -77,13 +148,20 @@ namespace zdb{
 
     bool result_set::get_next_record(std::string& error)
     {
-        if(0 == m_query_res){
+        if(0 == m_query_res && !m_cached){
             error = "m_query_res is not initialized.";
             return false;
         }
 
-        if((m_cur_row = mysql_fetch_row(m_query_res)) != NULL){
+        if((m_cur_row = fetch_row(m_cur_lengths)) != NULL){
             return true;
+        }else if(m_stream_conn){
+            // 流式结果集读完时error为空, 以区分读取失败
+            if(mysql_errno(m_stream_conn) != 0){
+                error = "failed to call mysql_fetch_row, last_error=";
+                error += mysql_error(m_stream_conn);
+            }
+            return false;
         }else{
             error = "failed to call mysql_fetch_row.";
             return false;
@@ -94,17 +172,27 @@ namespace zdb{
 
     my_ulonglong result_set::get_record_count(std::string& error)
     {
+        if(m_cached && 0 == m_query_res){
+            return m_cached->get_row_count();
+        }
+
         if(0 == m_query_res){
             error = "m_query_res is not initialized.";
             return 2;
         }
 
+        // 超出预算转为流式时, 已复制到副本中的行不在m_query_res中
+        if(m_cached){
+            return m_cached->get_row_count() + mysql_num_rows(m_query_res);
+        }
+
         return mysql_num_rows(m_query_res);
     }
 
-    bool result_set::get_field(int idx, char*& val, bool& is_null, std::string& error)
+    bool result_set::get_field(int idx, char*& val, unsigned long& len, bool& is_null, std::string& error)
     {
         is_null = false;
+        len = 0;
 
         if(0 == m_cur_row){
             error = "m_cur_row is not initialized.";
@@ -117,8 +205,10 @@ namespace zdb{
         }
 
         val = m_cur_row[idx];
-        if(val == NULL || val[0] == 0){
+        if(val == NULL){
             is_null = true;
+        }else{
+            len = m_cur_lengths[idx];
         }
 
         return true;
@@ -128,9 +218,10 @@ namespace zdb{
     {
         val = 0;
         char* ptr_field = 0;
+        unsigned long ptr_len = 0;
         bool is_null = false;
 
-        if(!get_field(idx, ptr_field, is_null, error)){
+        if(!get_field(idx, ptr_field, ptr_len, is_null, error)){
             return false;
         }
 
@@ -145,9 +236,10 @@ namespace zdb{
     {
         val = 0;
         char* ptr_field = 0;
+        unsigned long ptr_len = 0;
         bool is_null = false;
 
-        if(!get_field(idx, ptr_field, is_null, error)){
+        if(!get_field(idx, ptr_field, ptr_len, is_null, error)){
             return false;
         }
 
@@ -162,14 +254,15 @@ namespace zdb{
     {
         val = 0;
         char* ptr_field = 0;
+        unsigned long ptr_len = 0;
         bool is_null = false;
 
-        if(!get_field(idx, ptr_field, is_null, error)){
+        if(!get_field(idx, ptr_field, ptr_len, is_null, error)){
             return false;
         }
 
         if(!is_null){
-            val = _atoi64(ptr_field);
+            val = strtoll(ptr_field, 0, 10);
         }
 
         return true;
@@ -179,14 +272,15 @@ namespace zdb{
     {
         val = "";
         char* ptr_field = 0;
+        unsigned long ptr_len = 0;
         bool is_null = false;
 
-        if(!get_field(idx, ptr_field, is_null, error)){
+        if(!get_field(idx, ptr_field, ptr_len, is_null, error)){
             return false;
         }
 
         if(!is_null){
-            val = ptr_field;
+            val.assign(ptr_field, ptr_len);
         }
 
         return true;
@@ -194,17 +288,20 @@ namespace zdb{
 
     bool result_set::get_field(int idx, char* val, int len, std::string& error)
     {
-        memset(val, 0, len);
+        if(len > 0){
+            memset(val, 0, len);
+        }
 
         char* ptr_field = 0;
+        unsigned long ptr_len = 0;
         bool is_null = false;
 
-        if(!get_field(idx, ptr_field, is_null, error)){
+        if(!get_field(idx, ptr_field, ptr_len, is_null, error)){
             return false;
         }
 
-        if(!is_null){
-            strncpy_s(val, sizeof(val), ptr_field, len);
+        if(!is_null && len > 0){
+            memcpy(val, ptr_field, (ptr_len < (unsigned long)len)?ptr_len:len - 1);
         }
 
         return true;
@@ -214,9 +311,10 @@ namespace zdb{
     {
         val = false;
         char* ptr_field = 0;
+        unsigned long ptr_len = 0;
         bool is_null = false;
 
-        if(!get_field(idx, ptr_field, is_null, error)){
+        if(!get_field(idx, ptr_field, ptr_len, is_null, error)){
             return false;
         }
 
@@ -231,9 +329,10 @@ namespace zdb{
     {
         val = 0;
         char* ptr_field = 0;
+        unsigned long ptr_len = 0;
         bool is_null = false;
 
-        if(!get_field(idx, ptr_field, is_null, error)){
+        if(!get_field(idx, ptr_field, ptr_len, is_null, error)){
             return false;
         }
 
@@ -247,31 +346,74 @@ namespace zdb{
     {
         val = 0;
         char* ptr_field = 0;
+        unsigned long ptr_len = 0;
         bool is_null = false;
 
-        if(!get_field(idx, ptr_field, is_null, error)){
+        if(!get_field(idx, ptr_field, ptr_len, is_null, error)){
             return false;
         }
 
         if(!is_null){
-            val = std::stod(ptr_field);
+            val = strtod(ptr_field, 0);
         }
 
         return true;
     }
 
+    bool result_set::get_field(int idx, std::string_view& val, bool& is_null, std::string& error)
+    {
+        val = std::string_view();
+        char* ptr_field = 0;
+        unsigned long ptr_len = 0;
+
+        if(!get_field(idx, ptr_field, ptr_len, is_null, error)){
+            return false;
+        }
+
+        if(!is_null){
+            val = std::string_view(ptr_field, ptr_len);
+        }
+
+        return true;
+    }
+
+    bool result_set::get_field(int idx, std::string_view& val, std::string& error)
+    {
+        bool is_null = false;
+
+        return get_field(idx, val, is_null, error);
+    }
+
+    bool result_set::get_field(int idx, const std::byte*& data, size_t& size, bool& is_null, std::string& error)
+    {
+        data = 0;
+        size = 0;
+        char* ptr_field = 0;
+        unsigned long ptr_len = 0;
+
+        if(!get_field(idx, ptr_field, ptr_len, is_null, error)){
+            return false;
+        }
+
+        data = reinterpret_cast<const std::byte*>(ptr_field);
+        size = ptr_len;
+
+        return true;
+    }
+
     bool result_set::get_field(int idx, MYSQL_TIME& val, std::string& error)
     {
         db_helper::instance().init_mysql_time(val);
         char* ptr_field = 0;
+        unsigned long ptr_len = 0;
         bool is_null = false;
 
-        if(!get_field(idx, ptr_field, is_null, error)){
+        if(!get_field(idx, ptr_field, ptr_len, is_null, error)){
             return false;
         }
 
         if(!is_null){
-            db_helper::instance().to_datetime(ptr_field, val);
+            db_helper::instance().to_datetime(ptr_field, ptr_len, val);
         }
 
         return true;
@@ -279,14 +421,23 @@ namespace zdb{
  
     int result_set::get_field_idx_by_name(const char* name, std::string& error)
     {
-        auto fi = m_field_idx_list.find(name);
-        if(fi == m_field_idx_list.end()){
+        return get_field_idx_by_name(std::string_view(name?name:""), error);
+    }
+
+    int result_set::get_field_idx_by_name(std::string_view name, std::string& error)
+    {
+        if(!m_field_index){
+            create_filed_idx_list();
+        }
+
+        int idx = m_field_index?m_field_index->find(name):-1;
+        if(idx < 0){
             error = "failed to find field: ";
             error += name;
             return -1;
         }
 
-        return fi->second;
+        return idx;
     }
 
     bool result_set::get_field(const char* name, int& val, std::string& error)
@@ -345,6 +496,20 @@ namespace zdb{
         return (idx >= 0)?get_field(idx, val, error):false;
     }
 
+    bool result_set::get_field(const char* name, std::string_view& val, std::string& error)
+    {
+        int idx = get_field_idx_by_name(name, error);
+
+        return (idx >= 0)?get_field(idx, val, error):false;
+    }
+
+    bool result_set::get_field(const char* name, std::string_view& val, bool& is_null, std::string& error)
+    {
+        int idx = get_field_idx_by_name(name, error);
+
+        return (idx >= 0)?get_field(idx, val, is_null, error):false;
+    }
+
     bool result_set::get_field(const char* name, MYSQL_TIME& val, std::string& error)
     {
         int idx = get_field_idx_by_name(name, error);
@@ -352,6 +517,71 @@ namespace zdb{
         return (idx >= 0)?get_field(idx, val, error):false;
     }
 
+    template<typename Fn>
+    bool result_set::for_each_column_chunk(int idx, size_t count, Fn fn, size_t& rows, std::string& error)
+    {
+        const size_t chunk = TEXT_DECODE_CHUNK;
+        const char* vals[chunk];
+        unsigned long lens[chunk];
+
+        rows = 0;
+
+        if(0 == m_query_res && !m_cached){
+            error = "m_query_res is not initialized.";
+            return false;
+        }
+
+        if(m_stream_conn){
+            error = "get_column is not supported on a streaming result_set.";
+            return false;
+        }
+
+        if(idx < 0 || idx >= m_field_count){
+            error = "idx is invalid.";
+            return false;
+        }
+
+        std::string seek_error;
+        seek(0, seek_error);
+        m_cur_row = 0;
+        m_cur_lengths = 0;
+
+        size_t n = 0;
+        MYSQL_ROW row = 0;
+        unsigned long* lengths = 0;
+        while(rows + n < count && (row = fetch_row(lengths)) != NULL){
+            vals[n] = row[idx];
+            lens[n] = lengths[idx];
+
+            if(++n == chunk){
+                fn(vals, lens, rows, n);
+                rows += n;
+                n = 0;
+            }
+        }
+
+        if(n > 0){
+            fn(vals, lens, rows, n);
+            rows += n;
+        }
+
+        return true;
+    }
+
+    bool result_set::get_column(int idx, int64_t* vals, uint8_t* status, size_t count, size_t& rows, std::string& error)
+    {
+        return for_each_column_chunk(idx, count, [vals, status](const char** text, unsigned long* lens, size_t offset, size_t n){
+            decode_int64(text, lens, n, vals + offset, status?status + offset:0);
+        }, rows, error);
+    }
+
+    bool result_set::get_column(int idx, double* vals, uint8_t* status, size_t count, size_t& rows, std::string& error)
+    {
+        return for_each_column_chunk(idx, count, [vals, status](const char** text, unsigned long* lens, size_t offset, size_t n){
+            decode_double(text, lens, n, vals + offset, status?status + offset:0);
+        }, rows, error);
+    }
+
     int result_set::is_null(int idx, std::string& error)
     {
         if(0 == m_cur_row){
@@ -364,8 +594,7 @@ namespace zdb{
             return -1;
         }
 
-        char* ptr_field = m_cur_row[idx];
-        if(ptr_field == NULL || ptr_field[0] == 0){
+        if(m_cur_row[idx] == NULL){
             return 1;
         }
 
@@ -24,26 +24,39 @@
 #ifndef zdb_result_set_h
 #define zdb_result_set_h
 #include <mysql.h>
+#include <stdint.h>
+#include <cstddef>
+#include <functional>
 #include <string>
-#include <map>
+#include <string_view>
 #include "common.h"
 #include "helper.h"
+#include "field_index.h"
+#include "query_cache.h"
 
 namespace zdb{
 	class result_set{
         private:
         friend class connection;
+        friend class row_view;
+        friend class db_pool;
 
         MYSQL_RES* m_query_res;     // 结果集
         MYSQL_ROW m_cur_row;        // 当前记录行
+        unsigned long* m_cur_lengths;   // 当前记录行各字段长度
         int m_field_count;         // 字段个数
-        std::map<std::string, int> m_field_idx_list;    //字段名-字段下标
+        ptr_field_index m_field_index;      // 字段名-字段下标, 首次按名访问时获取
+        MYSQL* m_stream_conn;       // 流式结果集所在连接, 非流式为0
+        ptr_cached_result m_cached; // 查询结果缓存中的副本; 与流式的m_query_res同时存在时先读副本再读流
+        size_t m_cached_pos;        // 副本中下一行的下标
+        std::function<void()> m_release;    // close时调用, 用于归还流式结果集租用的连接
 
         private:
         /*
 		* @brief
 		    构建字段名字段下标对应列表函数。
 		* @note
+		    从field_index_cache获取, 同一列结构的结果集共享同一索引
 		* @warning
 		* @bug
 		*/
@@ -53,17 +66,56 @@ namespace zdb{
 		获得原始字符串值函数。
 		* @param  [in]  int idx             字段下标\n
 		* @param  [out] char* val           获得的原始字符串值\n
-		* @param  [out] bool& is_null       是否为空\n
+		* @param  [out] unsigned long& len  字段的实际长度\n
+		* @param  [out] bool& is_null       是否为NULL\n
 		* @param  [out] std::string& error  错误信息\n
 
 		* @return 返回获得字段值是否成功
 		* @return  true  成功\n
 		* @return  false  失败\n
 		* @note
+		    长度取自mysql_fetch_lengths, 值中可含'\0'; 空字符串不视为NULL
 		* @warning
     	* @bug
 		*/
-        bool get_field(int idx, char*& val, bool& is_null, std::string& error);
+        bool get_field(int idx, char*& val, unsigned long& len, bool& is_null, std::string& error);
+        /*
+		* @brief
+		    绑定到mysql_use_result返回的流式结果集函数。
+		* @param  [in]  MYSQL_RES* res      流式结果集\n
+		* @param  [in]  MYSQL* conn         结果集所在连接\n
+		* @param  [out] std::string& error  错误信息\n
+		* @return 返回绑定是否成功
+		* @note
+		* @warning
+		* @bug
+		*/
+        bool bind_stream(MYSQL_RES* res, MYSQL* conn, std::string& error);
+        /*
+		* @brief
+		    按块收集某列的文本值并交给解码函数。
+		* @param  [in]  int idx             字段下标\n
+		* @param  [in]  size_t count        最多读取的行数\n
+		* @param  [in]  fn                  fn(vals, lens, offset, n)解码一块\n
+		* @param  [out] size_t& rows        实际读取的行数\n
+		* @param  [out] std::string& error  错误信息\n
+		* @return 返回是否成功
+		* @note
+		* @warning
+		* @bug
+		*/
+        /*
+		* @brief
+		    读取下一行函数, 兼容MYSQL_RES和缓存副本。
+		* @param  [out] unsigned long*& lengths  该行各字段长度\n
+		* @return 返回该行, 没有更多行时为0
+		* @note
+		* @warning
+		* @bug
+		*/
+        MYSQL_ROW fetch_row(unsigned long*& lengths);
+        template<typename Fn>
+        bool for_each_column_chunk(int idx, size_t count, Fn fn, size_t& rows, std::string& error);
 
         public:
         result_set();
@@ -82,6 +134,33 @@ namespace zdb{
 	    * @bug
 	    */
         bool bind(MYSQL_RES* res, std::string& error);
+        /*
+		* @brief
+		    绑定到结果副本函数。
+		* @param  [in]  ptr_cached_result res   结果副本, 来自查询结果缓存、快照文件或自行构建\n
+		* @param  [out] std::string& error      错误信息\n
+		* @return 返回绑定是否成功
+		* @note
+		    副本只读且可被多个result_set共享, 使用方式与普通结果集相同
+		* @warning
+		* @bug
+		*/
+        bool bind_cached(ptr_cached_result res, std::string& error);
+        /*
+	    * @brief
+	        是否为流式结果集函数。
+	    * @param  无\n
+	    * @return 返回是否为流式结果集
+	    * @note
+	        流式结果集逐行从服务端读取, 内存占用恒定; 不支持seek,
+	        get_record_count只返回已读取的行数, 读完或close前所在连接不可执行其他语句
+	    * @warning
+	    * @bug
+	    */
+        bool is_streaming()
+        {
+            return m_stream_conn != 0;
+        }
         /*
 	    * @brief
 	        查找数据函数。
@@ -233,6 +312,42 @@ namespace zdb{
 	    * @bug
 	    */
         bool get_field(int idx, double& val, std::string& error);
+        /*
+	    * @brief
+	        获得字段值视图函数。
+	    * @param  [in]  int idx                 字段下标\n
+	    * @param  [out] std::string_view& val   字段值视图, NULL时为空\n
+	    * @param  [out] bool& is_null           是否为NULL\n
+	    * @param  [out] std::string& error      错误信息\n
+	    * @return 返回获得字段值是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	        不复制数据, 按实际长度返回, 可含'\0'
+	    * @warning
+	        视图指向结果集内部缓冲区, 结果集close或bind后失效; 流式结果集读取下一行后失效
+	    * @bug
+	    */
+        bool get_field(int idx, std::string_view& val, bool& is_null, std::string& error);
+        bool get_field(int idx, std::string_view& val, std::string& error);
+        /*
+	    * @brief
+	        获得二进制字段值函数。
+	    * @param  [in]  int idx                 字段下标\n
+	    * @param  [out] const std::byte*& data  字段值首地址, NULL时为0\n
+	    * @param  [out] size_t& size            字段值长度\n
+	    * @param  [out] bool& is_null           是否为NULL\n
+	    * @param  [out] std::string& error      错误信息\n
+	    * @return 返回获得字段值是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	        用于BLOB等二进制字段, 不复制数据
+	    * @warning
+	        生命周期同get_field(int, std::string_view&, ...)
+	    * @bug
+	    */
+        bool get_field(int idx, const std::byte*& data, size_t& size, bool& is_null, std::string& error);
         /*
 	    * @brief
 	        获得lMYSQL_TIME字段值函数。
@@ -261,6 +376,7 @@ namespace zdb{
 	    * @bug
 	    */
         int get_field_idx_by_name(const char* name, std::string& error);
+        int get_field_idx_by_name(std::string_view name, std::string& error);
         /*
 	    * @brief
 	        根据字段名获得int字段值函数。
@@ -374,6 +490,23 @@ namespace zdb{
 	    * @bug
 	    */
         bool get_field(const char* name, double& val, std::string& error);
+        /*
+	    * @brief
+	        根据字段名获得字段值视图函数。
+	    * @param  [in]  const char* name        字段名\n
+	    * @param  [out] std::string_view& val   字段值视图\n
+	    * @param  [out] bool& is_null           是否为NULL\n
+	    * @param  [out] std::string& error      错误信息\n
+	    * @return 返回获得字段值是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	        生命周期同get_field(int, std::string_view&, ...)
+	    * @bug
+	    */
+        bool get_field(const char* name, std::string_view& val, std::string& error);
+        bool get_field(const char* name, std::string_view& val, bool& is_null, std::string& error);
         /*
 	    * @brief
 	        根据字段名获得MYSQL_TIME字段值函数。
@@ -388,14 +521,50 @@ namespace zdb{
 	    * @bug
 	    */
         bool get_field(const char* name, MYSQL_TIME& val, std::string& error);
+        /*
+	    * @brief
+	        按列批量解码整数字段函数。
+	    * @param  [in]  int idx                字段下标\n
+	    * @param  [out] int64_t* vals          解码结果, 至少count个\n
+	    * @param  [out] uint8_t* status        每行状态(decode_status), 可为空\n
+	    * @param  [in]  size_t count           最多解码的行数\n
+	    * @param  [out] size_t& rows           实际解码的行数\n
+	    * @param  [out] std::string& error     错误信息\n
+	    * @return 返回解码是否成功
+	    * @return  true  成功, 个别行的NULL/溢出见status\n
+	    * @return  false  失败\n
+	    * @note
+	        从第一行开始解码, 使用text_decoder按列批量解析; 完成后当前行失效, 需重新seek
+	    * @warning
+	        不支持流式结果集
+	    * @bug
+	    */
+        bool get_column(int idx, int64_t* vals, uint8_t* status, size_t count, size_t& rows, std::string& error);
+        /*
+	    * @brief
+	        按列批量解码浮点字段函数。
+	    * @param  [in]  int idx                字段下标\n
+	    * @param  [out] double* vals           解码结果, 至少count个\n
+	    * @param  [out] uint8_t* status        每行状态(decode_status), 可为空\n
+	    * @param  [in]  size_t count           最多解码的行数\n
+	    * @param  [out] size_t& rows           实际解码的行数\n
+	    * @param  [out] std::string& error     错误信息\n
+	    * @return 返回解码是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool get_column(int idx, double* vals, uint8_t* status, size_t count, size_t& rows, std::string& error);
         /*
 		* @brief
 		    判断字段是否为空函数。
 		* @param  [in]  int idx             字段下标\n
 		* @param  [out] std::string& error  错误信息\n
 		* @return 返回字段是否为空
-		* @return  1  为空\n
-		* @return  0  不为空\n
+		* @return  1  为NULL\n
+		* @return  0  不为NULL, 含空字符串\n
 		* @return  -1  有错误\n
 		* @note
 		* @warning
@@ -0,0 +1,341 @@
+#include "result_snapshot.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <functional>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <io.h>
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace zdb{
+    static const char SNAPSHOT_MAGIC[8] = {'Z', 'D', 'B', 'S', 'N', 'A', 'P', 0};
+    static const uint64_t SNAPSHOT_NULL_LENGTH = ~(uint64_t)0;     // NULL字段的长度标记
+
+    static inline uint64_t align8(uint64_t size)
+    {
+        return (size + 7) & ~(uint64_t)7;
+    }
+
+    static inline uint64_t fnv1a(uint64_t h, const void* buf, size_t len)
+    {
+        const unsigned char* p = (const unsigned char*)buf;
+        for(size_t i = 0; i < len; ++i){
+            h ^= p[i];
+            h *= 1099511628211ULL;
+        }
+
+        return h;
+    }
+
+    static bool write_all(FILE* fp, const void* buf, size_t len)
+    {
+        return 0 == len || fwrite(buf, 1, len, fp) == len;
+    }
+
+    static bool write_padding(FILE* fp, uint64_t size)
+    {
+        static const char zeros[8] = {0};
+        return write_all(fp, zeros, (size_t)(align8(size) - size));
+    }
+
+    uint64_t result_snapshot::checksum(const uint64_t* lengths, size_t cells, const char* data, size_t data_size)
+    {
+        uint64_t h = 14695981039346656037ULL;
+        h = fnv1a(h, lengths, cells * sizeof(uint64_t));
+        h = fnv1a(h, data, data_size);
+
+        return h;
+    }
+
+    bool result_snapshot::save(const char* path, const cached_result& result, const std::string& validator, std::string& error)
+    {
+        int field_count = result.get_field_count();
+        size_t row_count = result.get_row_count();
+        size_t cells = row_count * field_count;
+        const ptr_field_index& index = result.get_field_index();
+        if(!index || (int)index->size() != field_count){
+            error = "result has no field names.";
+            return false;
+        }
+
+        // 列信息: 每列uint32_t类型, uint32_t名字长度, 名字
+        std::string meta = "";
+        for(int i = 0; i < field_count; ++i){
+            std::string_view name = index->name_at(i);
+            uint32_t field[2] = {(uint32_t)result.get_field_type(i), (uint32_t)name.size()};
+            meta.append((const char*)field, sizeof(field));
+            meta.append(name.data(), name.size());
+        }
+
+        std::vector<uint64_t> lengths(cells);
+        uint64_t data_size = 0;
+        for(size_t row = 0; row < row_count; ++row){
+            MYSQL_ROW cells_row = result.get_row(row);
+            unsigned long* lengths_row = result.get_lengths(row);
+            for(int i = 0; i < field_count; ++i){
+                size_t cell = row * field_count + i;
+                if(0 == cells_row[i]){
+                    lengths[cell] = SNAPSHOT_NULL_LENGTH;
+                    continue;
+                }
+
+                lengths[cell] = lengths_row[i];
+                data_size += lengths_row[i] + 1;
+            }
+        }
+
+        snapshot_header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.m_magic, SNAPSHOT_MAGIC, sizeof(header.m_magic));
+        header.m_version = RESULT_SNAPSHOT_VERSION;
+        header.m_field_count = (uint32_t)field_count;
+        header.m_row_count = row_count;
+        header.m_meta_size = meta.size();
+        header.m_validator_size = validator.size();
+        header.m_data_size = data_size;
+        header.m_created = (int64_t)time(0);
+
+        // 字段值逐个写入, 哈希同时计算
+        uint64_t h = fnv1a(14695981039346656037ULL, lengths.data(), cells * sizeof(uint64_t));
+        for(size_t row = 0; row < row_count; ++row){
+            MYSQL_ROW cells_row = result.get_row(row);
+            unsigned long* lengths_row = result.get_lengths(row);
+            for(int i = 0; i < field_count; ++i){
+                if(cells_row[i]){
+                    h = fnv1a(h, cells_row[i], lengths_row[i]);
+                    h = fnv1a(h, "", 1);
+                }
+            }
+        }
+        header.m_checksum = h;
+
+        // 临时文件名带进程号和线程号, 同时保存同一路径时互不覆盖, 最后一个rename的生效
+#ifdef _WIN32
+        unsigned long long pid = (unsigned long long)_getpid();
+#else
+        unsigned long long pid = (unsigned long long)getpid();
+#endif
+        std::string tmp_path = std::string(path) + "." + std::to_string(pid) + "."
+            + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+        FILE* fp = fopen(tmp_path.c_str(), "wb");
+        if(0 == fp){
+            error = "failed to create snapshot file: " + tmp_path;
+            return false;
+        }
+
+        bool ret = write_all(fp, &header, sizeof(header))
+            && write_all(fp, meta.data(), meta.size()) && write_padding(fp, meta.size())
+            && write_all(fp, validator.data(), validator.size()) && write_padding(fp, validator.size())
+            && write_all(fp, lengths.data(), cells * sizeof(uint64_t));
+
+        for(size_t row = 0; ret && row < row_count; ++row){
+            MYSQL_ROW cells_row = result.get_row(row);
+            unsigned long* lengths_row = result.get_lengths(row);
+            for(int i = 0; ret && i < field_count; ++i){
+                if(cells_row[i]){
+                    ret = write_all(fp, cells_row[i], lengths_row[i] + 1);
+                }
+            }
+        }
+
+        if(fclose(fp) != 0){
+            ret = false;
+        }
+
+        if(!ret){
+            remove(tmp_path.c_str());
+            error = "failed to write snapshot file: " + tmp_path;
+            return false;
+        }
+
+#ifdef _WIN32
+        remove(path);
+#endif
+        if(rename(tmp_path.c_str(), path) != 0){
+            remove(tmp_path.c_str());
+            error = "failed to rename snapshot file: " + tmp_path;
+            return false;
+        }
+
+        return true;
+    }
+
+    /*
+	* @brief	把整个文件映射到内存函数。
+	* @param 	[in]  const char* path          文件路径\n
+	* @param 	[out] const char*& base         映射起始地址\n
+	* @param 	[out] size_t& size              文件长度\n
+	* @param 	[out] std::string& error        错误信息\n
+	* @return 	返回持有映射的指针, 失败时为空
+	* @note
+	    不支持mmap的平台读入内存
+	* @warning
+	* @bug
+	*/
+    static std::shared_ptr<const void> map_file(const char* path, const char*& base, size_t& size, std::string& error)
+    {
+#ifdef _WIN32
+        FILE* fp = fopen(path, "rb");
+        if(0 == fp){
+            error = "failed to open snapshot file: ";
+            error += path;
+            return std::shared_ptr<const void>();
+        }
+
+        auto buf = std::make_shared<std::vector<char>>();
+        char block[65536];
+        size_t n = 0;
+        while((n = fread(block, 1, sizeof(block), fp)) > 0){
+            buf->insert(buf->end(), block, block + n);
+        }
+        fclose(fp);
+
+        base = buf->data();
+        size = buf->size();
+
+        return buf;
+#else
+        int fd = open(path, O_RDONLY);
+        if(fd < 0){
+            error = "failed to open snapshot file: ";
+            error += path;
+            return std::shared_ptr<const void>();
+        }
+
+        struct stat st;
+        if(fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(snapshot_header)){
+            ::close(fd);
+            error = "invalid snapshot file: ";
+            error += path;
+            return std::shared_ptr<const void>();
+        }
+
+        size = (size_t)st.st_size;
+        void* addr = mmap(0, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if(MAP_FAILED == addr){
+            error = "failed to map snapshot file: ";
+            error += path;
+            return std::shared_ptr<const void>();
+        }
+
+        base = (const char*)addr;
+
+        return std::shared_ptr<const void>(addr, [size](const void* p){ munmap(const_cast<void*>(p), size); });
+#endif
+    }
+
+    bool result_snapshot::load(const char* path, ptr_cached_result& result, std::string& validator, bool verify, std::string& error)
+    {
+        const char* base = 0;
+        size_t size = 0;
+        std::shared_ptr<const void> mapping = map_file(path, base, size, error);
+        if(!mapping){
+            return false;
+        }
+
+        snapshot_header header;
+        if(size < sizeof(header)){
+            error = "snapshot file is truncated.";
+            return false;
+        }
+        memcpy(&header, base, sizeof(header));
+
+        if(memcmp(header.m_magic, SNAPSHOT_MAGIC, sizeof(header.m_magic)) != 0 || header.m_version != RESULT_SNAPSHOT_VERSION){
+            error = "not a snapshot file or version mismatch: ";
+            error += path;
+            return false;
+        }
+
+        uint64_t cells = header.m_row_count * header.m_field_count;
+        if(header.m_field_count > 0 && cells / header.m_field_count != header.m_row_count){
+            error = "snapshot file is corrupted.";
+            return false;
+        }
+
+        uint64_t meta_pos = sizeof(header);
+        uint64_t validator_pos = meta_pos + align8(header.m_meta_size);
+        uint64_t lengths_pos = validator_pos + align8(header.m_validator_size);
+        uint64_t data_pos = lengths_pos + cells * sizeof(uint64_t);
+        if(header.m_meta_size > size || header.m_validator_size > size || cells > size / sizeof(uint64_t)
+            || data_pos > size || header.m_data_size != size - data_pos){
+            error = "snapshot file is truncated.";
+            return false;
+        }
+
+        const uint64_t* lengths = (const uint64_t*)(base + lengths_pos);
+        const char* data = base + data_pos;
+        if(verify && checksum(lengths, (size_t)cells, data, (size_t)header.m_data_size) != header.m_checksum){
+            error = "snapshot checksum mismatch: ";
+            error += path;
+            return false;
+        }
+
+        std::shared_ptr<cached_result> copy = std::make_shared<cached_result>();
+        copy->m_field_count = (int)header.m_field_count;
+        copy->m_row_count = (size_t)header.m_row_count;
+
+        // 列信息, 名字指向映射, 只在构建索引时使用
+        std::vector<MYSQL_FIELD> fields(header.m_field_count);
+        copy->m_field_types.resize(header.m_field_count);
+        copy->m_field_flags.assign(header.m_field_count, 0);
+        const char* p = base + meta_pos;
+        const char* meta_end = p + header.m_meta_size;
+        for(uint32_t i = 0; i < header.m_field_count; ++i){
+            uint32_t field[2];
+            if(p + sizeof(field) > meta_end){
+                error = "snapshot file is corrupted.";
+                return false;
+            }
+            memcpy(field, p, sizeof(field));
+            p += sizeof(field);
+            if(field[1] > (size_t)(meta_end - p)){
+                error = "snapshot file is corrupted.";
+                return false;
+            }
+
+            memset(&fields[i], 0, sizeof(MYSQL_FIELD));
+            fields[i].name = const_cast<char*>(p);
+            fields[i].name_length = field[1];
+            fields[i].type = (enum_field_types)field[0];
+            copy->m_field_types[i] = fields[i].type;
+            p += field[1];
+        }
+        copy->m_field_index = field_index_cache::instance().acquire(fields.data(), header.m_field_count);
+
+        // 按长度数组计算字段指针
+        copy->m_cells.resize((size_t)cells);
+        copy->m_lengths.resize((size_t)cells);
+        uint64_t pos = 0;
+        for(size_t cell = 0; cell < cells; ++cell){
+            if(SNAPSHOT_NULL_LENGTH == lengths[cell]){
+                copy->m_cells[cell] = 0;
+                copy->m_lengths[cell] = 0;
+                continue;
+            }
+
+            if(lengths[cell] >= header.m_data_size - pos){
+                error = "snapshot file is corrupted.";
+                return false;
+            }
+
+            copy->m_cells[cell] = const_cast<char*>(data + pos);
+            copy->m_lengths[cell] = (unsigned long)lengths[cell];
+            pos += lengths[cell] + 1;
+        }
+
+        validator.assign(base + validator_pos, (size_t)header.m_validator_size);
+        copy->m_mapping = mapping;
+        result = copy;
+
+        return true;
+    }
+}
@@ -0,0 +1,97 @@
+/*
+* @file
+    result_snapshot.h
+
+* @brief
+    查询结果的二进制快照文件类
+
+* @version
+    V1.0
+
+* @author
+    agent
+
+* @date
+    2026/10/19
+
+* @note
+    把cached_result写成紧凑的二进制文件: 文件头、列信息(字段名和类型)、校验串、
+    各字段长度数组和以'\0'结尾依次存放的字段值。
+    打开时用mmap映射整个文件, 字段值不复制也不解析, 只按长度数组计算一遍字段指针,
+    得到的cached_result可直接绑定到result_set, 用于服务重启时快速加载参照表。
+
+    文件布局(本机字节序, 各段8字节对齐):
+    snapshot_header | 列信息 | 校验串 | uint64_t长度[行数*列数] | 字段值
+
+* @warning
+    快照文件不跨字节序不同的机器使用; 写入时先写临时文件再rename, 读到的文件总是完整的
+* @bug
+* @copyright
+*/
+#ifndef zdb_result_snapshot_h
+#define zdb_result_snapshot_h
+#include <mysql.h>
+#include <stdint.h>
+#include <string>
+#include "query_cache.h"
+
+namespace zdb{
+    const uint32_t RESULT_SNAPSHOT_VERSION = 1;         // 快照格式版本
+
+    struct snapshot_header{
+        char m_magic[8];            // "ZDBSNAP\0"
+        uint32_t m_version;         // 格式版本
+        uint32_t m_field_count;     // 字段个数
+        uint64_t m_row_count;       // 记录数
+        uint64_t m_meta_size;       // 列信息长度
+        uint64_t m_validator_size;  // 校验串长度
+        uint64_t m_data_size;       // 字段值总长度
+        uint64_t m_checksum;        // 长度数组和字段值的FNV-1a哈希
+        int64_t m_created;          // 生成时间(unix秒)
+    };
+
+    class result_snapshot{
+        public:
+        /*
+		* @brief	把查询结果副本写入快照文件函数。
+		* @param 	[in]  const char* path                  快照文件路径\n
+		* @param 	[in]  const cached_result& result       查询结果副本\n
+		* @param 	[in]  const std::string& validator      校验串, 如max(updated_at)或CHECKSUM TABLE的结果\n
+		* @param 	[out] std::string& error                错误信息\n
+		* @return 	返回是否成功
+		* @note
+		    先写path.tmp, 完成后rename为path
+		* @warning
+		* @bug
+		*/
+        static bool save(const char* path, const cached_result& result, const std::string& validator, std::string& error);
+        /*
+		* @brief	打开快照文件函数。
+		* @param 	[in]  const char* path              快照文件路径\n
+		* @param 	[out] ptr_cached_result& result     查询结果副本, 字段值直接指向文件映射\n
+		* @param 	[out] std::string& validator        生成快照时的校验串\n
+		* @param 	[in]  bool verify                   是否校验哈希, 会读遍整个文件\n
+		* @param 	[out] std::string& error            错误信息\n
+		* @return 	返回是否成功
+		* @note
+		    映射在result及所有引用它的result_set/row_view释放后才解除
+		* @warning
+		* @bug
+		*/
+        static bool load(const char* path, ptr_cached_result& result, std::string& validator, bool verify, std::string& error);
+        /*
+		* @brief	计算长度数组和字段值的哈希函数。
+		* @param 	[in]  const uint64_t* lengths   长度数组\n
+		* @param 	[in]  size_t cells              字段总数\n
+		* @param 	[in]  const char* data          字段值\n
+		* @param 	[in]  size_t data_size          字段值总长度\n
+		* @return 	返回哈希值
+		* @note
+		* @warning
+		* @bug
+		*/
+        static uint64_t checksum(const uint64_t* lengths, size_t cells, const char* data, size_t data_size);
+    };
+}
+
+#endif
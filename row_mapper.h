@@ -0,0 +1,228 @@
+/*
+* @file
+    row_mapper.h
+
+* @brief
+    结果集行到结构体的编译期映射模板
+
+* @version
+    V1.0
+
+* @author
+    agent
+
+* @date
+    2026/10/19
+
+* @note
+    用ZDB_ROW_MAPPING声明结构体成员与字段名的对应关系, row_mapper在每个结果集上
+    只按字段名查找一次下标, 之后逐行按下标直接解码到成员, 不再构造临时字符串和查表。
+    支持的成员类型: 整数、bool、float、double、std::string、MYSQL_TIME、std::optional<T>
+
+    struct user{ long long id; std::string name; std::optional<int> age; };
+    ZDB_ROW_MAPPING(user, ZDB_FIELD(user, id), ZDB_FIELD(user, name), zdb::field("user_age", &user::age))
+
+* @warning
+    ZDB_ROW_MAPPING必须在全局命名空间中使用
+* @bug
+* @copyright
+*/
+#ifndef zdb_row_mapper_h
+#define zdb_row_mapper_h
+#include <stddef.h>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "result_set.h"
+
+namespace zdb{
+    // 一个成员的映射描述: 字段名 + 成员指针
+    template<typename T, typename M>
+    struct field_desc{
+        const char* m_name;
+        M T::* m_member;
+    };
+
+    template<typename T, typename M>
+    constexpr field_desc<T, M> field(const char* name, M T::* member)
+    {
+        return field_desc<T, M>{name, member};
+    }
+
+    // 由ZDB_ROW_MAPPING特化, fields()返回field_desc组成的tuple
+    template<typename T>
+    struct row_mapping;
+
+    // 按成员类型选择result_set::get_field的重载
+    template<typename M, typename Enable = void>
+    struct field_reader{
+        static bool read(result_set& rs, int idx, M& val, std::string& error)
+        {
+            return rs.get_field(idx, val, error);
+        }
+    };
+
+    // int/unsigned int/long long以外的整数经由long long转换
+    template<typename M>
+    struct field_reader<M, typename std::enable_if<std::is_integral<M>::value && !std::is_same<M, bool>::value
+        && !std::is_same<M, int>::value && !std::is_same<M, unsigned int>::value && !std::is_same<M, long long>::value>::type>{
+        static bool read(result_set& rs, int idx, M& val, std::string& error)
+        {
+            long long tmp = 0;
+            bool ret = rs.get_field(idx, tmp, error);
+            val = static_cast<M>(tmp);
+            return ret;
+        }
+    };
+
+    template<typename M>
+    struct field_reader<std::optional<M>>{
+        static bool read(result_set& rs, int idx, std::optional<M>& val, std::string& error)
+        {
+            int null = rs.is_null(idx, error);
+            if(null < 0){
+                return false;
+            }
+
+            if(null > 0){
+                val.reset();
+                return true;
+            }
+
+            if(!val){
+                val.emplace();
+            }
+
+            return field_reader<M>::read(rs, idx, *val, error);
+        }
+    };
+
+    template<typename T>
+    class row_mapper{
+        private:
+        typedef decltype(row_mapping<T>::fields()) fields_type;
+        static const size_t field_count = std::tuple_size<fields_type>::value;
+
+        fields_type m_fields;
+        int m_idx[field_count > 0?field_count:1];   // 成员对应的字段下标
+        bool m_resolved;
+
+        template<size_t... I>
+        bool resolve_impl(result_set& rs, std::string& error, std::index_sequence<I...>)
+        {
+            bool ok = true;
+            ((ok = ok && (m_idx[I] = rs.get_field_idx_by_name(std::get<I>(m_fields).m_name, error)) >= 0), ...);
+            return ok;
+        }
+
+        template<size_t... I>
+        bool map_impl(result_set& rs, T& obj, std::string& error, std::index_sequence<I...>)
+        {
+            bool ok = true;
+            ((ok = ok && field_reader<typename std::remove_reference<decltype(obj.*(std::get<I>(m_fields).m_member))>::type>
+                ::read(rs, m_idx[I], obj.*(std::get<I>(m_fields).m_member), error)), ...);
+            return ok;
+        }
+
+        public:
+        row_mapper()
+            : m_fields(row_mapping<T>::fields()), m_resolved(false)
+        {
+        }
+
+        /*
+		* @brief	按字段名解析各成员对应的字段下标函数。
+		* @param 	[in]  result_set& rs        结果集\n
+		* @param 	[out] std::string& error    错误信息\n
+		* @return 	返回是否全部字段都存在
+		* @note
+		    每个结果集调用一次, map前未调用时自动调用
+		* @warning
+		* @bug
+		*/
+        bool resolve(result_set& rs, std::string& error)
+        {
+            m_resolved = resolve_impl(rs, error, std::make_index_sequence<field_count>());
+            return m_resolved;
+        }
+
+        /*
+		* @brief	把结果集的当前行解码到结构体函数。
+		* @param 	[in]  result_set& rs        已调用get_next_record的结果集\n
+		* @param 	[out] T& obj                结构体\n
+		* @param 	[out] std::string& error    错误信息\n
+		* @return 	返回是否成功
+		* @note
+		* @warning
+		    换用其他结果集前需重新resolve
+		* @bug
+		*/
+        bool map(result_set& rs, T& obj, std::string& error)
+        {
+            if(!m_resolved && !resolve(rs, error)){
+                return false;
+            }
+
+            return map_impl(rs, obj, error, std::make_index_sequence<field_count>());
+        }
+    };
+
+    /*
+	* @brief	把结果集剩余的行全部解码为结构体数组函数。
+	* @param 	[in]  result_set& rs            结果集\n
+	* @param 	[out] std::vector<T>& rows      结构体数组, 结果追加在末尾\n
+	* @param 	[out] std::string& error        错误信息\n
+	* @return 	返回是否成功
+	* @note
+	    非流式结果集按mysql_num_rows预先reserve
+	* @warning
+	* @bug
+	*/
+    template<typename T>
+    bool map_rows(result_set& rs, std::vector<T>& rows, std::string& error)
+    {
+        row_mapper<T> mapper;
+        if(!mapper.resolve(rs, error)){
+            return false;
+        }
+
+        if(!rs.is_streaming()){
+            rows.reserve(rows.size() + (size_t)rs.get_record_count(error));
+        }
+
+        std::string fetch_error;
+        while(rs.get_next_record(fetch_error)){
+            rows.emplace_back();
+            if(!mapper.map(rs, rows.back(), error)){
+                rows.pop_back();
+                return false;
+            }
+        }
+
+        // 流式结果集读取失败时fetch_error不为空
+        if(rs.is_streaming() && !fetch_error.empty()){
+            error = fetch_error;
+            return false;
+        }
+
+        return true;
+    }
+}
+
+#define ZDB_FIELD(type, member) zdb::field(#member, &type::member)
+
+#define ZDB_ROW_MAPPING(type, ...)                          \
+    namespace zdb{                                          \
+        template<>                                          \
+        struct row_mapping<type>{                           \
+            static auto fields()                            \
+            {                                               \
+                return std::make_tuple(__VA_ARGS__);        \
+            }                                               \
+        };                                                  \
+    }
+
+#endif
@@ -0,0 +1,243 @@
+#include "row_view.h"
+#include <stdlib.h>
+
+namespace zdb{
+    bool row_ref::get_raw(int idx, const char*& val, unsigned long& len, std::string& error) const
+    {
+        val = 0;
+        len = 0;
+
+        if(m_row >= m_view->m_rows.size()){
+            error = "row is out of range.";
+            return false;
+        }
+
+        if(idx < 0 || idx >= m_view->m_field_count){
+            error = "idx is invalid.";
+            return false;
+        }
+
+        val = m_view->m_rows[m_row][idx];
+        if(val != NULL){
+            len = m_view->m_lengths[m_row * m_view->m_field_count + idx];
+        }
+
+        return true;
+    }
+
+    bool row_ref::is_null(int idx) const
+    {
+        if(m_row >= m_view->m_rows.size() || idx < 0 || idx >= m_view->m_field_count){
+            return true;
+        }
+
+        return m_view->m_rows[m_row][idx] == NULL;
+    }
+
+    std::string_view row_ref::get(int idx) const
+    {
+        if(is_null(idx)){
+            return std::string_view();
+        }
+
+        return std::string_view(m_view->m_rows[m_row][idx], m_view->m_lengths[m_row * m_view->m_field_count + idx]);
+    }
+
+    bool row_ref::get_field(int idx, int& val, std::string& error) const
+    {
+        val = 0;
+        const char* ptr_field = 0;
+        unsigned long len = 0;
+
+        if(!get_raw(idx, ptr_field, len, error)){
+            return false;
+        }
+
+        if(ptr_field){
+            val = atoi(ptr_field);
+        }
+
+        return true;
+    }
+
+    bool row_ref::get_field(int idx, unsigned int& val, std::string& error) const
+    {
+        val = 0;
+        const char* ptr_field = 0;
+        unsigned long len = 0;
+
+        if(!get_raw(idx, ptr_field, len, error)){
+            return false;
+        }
+
+        if(ptr_field){
+            val = (unsigned int)strtoul(ptr_field, 0, 10);
+        }
+
+        return true;
+    }
+
+    bool row_ref::get_field(int idx, long long& val, std::string& error) const
+    {
+        val = 0;
+        const char* ptr_field = 0;
+        unsigned long len = 0;
+
+        if(!get_raw(idx, ptr_field, len, error)){
+            return false;
+        }
+
+        if(ptr_field){
+            val = strtoll(ptr_field, 0, 10);
+        }
+
+        return true;
+    }
+
+    bool row_ref::get_field(int idx, bool& val, std::string& error) const
+    {
+        int tmp = 0;
+        bool ret = get_field(idx, tmp, error);
+        val = (tmp == 1);
+
+        return ret;
+    }
+
+    bool row_ref::get_field(int idx, float& val, std::string& error) const
+    {
+        double tmp = 0;
+        bool ret = get_field(idx, tmp, error);
+        val = (float)tmp;
+
+        return ret;
+    }
+
+    bool row_ref::get_field(int idx, double& val, std::string& error) const
+    {
+        val = 0;
+        const char* ptr_field = 0;
+        unsigned long len = 0;
+
+        if(!get_raw(idx, ptr_field, len, error)){
+            return false;
+        }
+
+        if(ptr_field){
+            val = strtod(ptr_field, 0);
+        }
+
+        return true;
+    }
+
+    bool row_ref::get_field(int idx, std::string& val, std::string& error) const
+    {
+        val.clear();
+        const char* ptr_field = 0;
+        unsigned long len = 0;
+
+        if(!get_raw(idx, ptr_field, len, error)){
+            return false;
+        }
+
+        if(ptr_field){
+            val.assign(ptr_field, len);
+        }
+
+        return true;
+    }
+
+    bool row_ref::get_field(int idx, std::string_view& val, std::string& error) const
+    {
+        val = std::string_view();
+        const char* ptr_field = 0;
+        unsigned long len = 0;
+
+        if(!get_raw(idx, ptr_field, len, error)){
+            return false;
+        }
+
+        if(ptr_field){
+            val = std::string_view(ptr_field, len);
+        }
+
+        return true;
+    }
+
+    bool row_ref::get_field(int idx, MYSQL_TIME& val, std::string& error) const
+    {
+        db_helper::instance().init_mysql_time(val);
+        const char* ptr_field = 0;
+        unsigned long len = 0;
+
+        if(!get_raw(idx, ptr_field, len, error)){
+            return false;
+        }
+
+        if(ptr_field){
+            db_helper::instance().to_datetime(ptr_field, len, val);
+        }
+
+        return true;
+    }
+
+    row_view::row_view()
+    {
+        m_field_count = 0;
+    }
+
+    bool row_view::build(result_set& rs, std::string& error)
+    {
+        clear();
+
+        if(0 == rs.m_query_res && !rs.m_cached){
+            error = "m_query_res is not initialized.";
+            return false;
+        }
+
+        if(rs.is_streaming()){
+            error = "row_view is not supported on a streaming result_set.";
+            return false;
+        }
+
+        size_t count = (size_t)rs.get_record_count(error);
+        m_field_count = rs.m_field_count;
+        m_rows.reserve(count);
+        m_lengths.reserve(count * m_field_count);
+        m_cached = rs.m_cached;
+
+        // mysql_fetch_lengths写入结果集内部的共享数组, 因此在这里一次性复制出来
+        rs.seek(0, error);
+        rs.m_cur_row = 0;
+        rs.m_cur_lengths = 0;
+
+        MYSQL_ROW row = 0;
+        unsigned long* lengths = 0;
+        while((row = rs.fetch_row(lengths)) != NULL){
+            m_rows.push_back(row);
+            m_lengths.insert(m_lengths.end(), lengths, lengths + m_field_count);
+        }
+
+        rs.seek(0, error);
+
+        if(!rs.m_field_index){
+            rs.create_filed_idx_list();
+        }
+        m_field_index = rs.m_field_index;
+
+        return true;
+    }
+
+    int row_view::get_field_idx_by_name(std::string_view name) const
+    {
+        return m_field_index?m_field_index->find(name):-1;
+    }
+
+    void row_view::clear()
+    {
+        m_rows.clear();
+        m_lengths.clear();
+        m_field_count = 0;
+        m_field_index.reset();
+        m_cached.reset();
+    }
+}
@@ -0,0 +1,281 @@
+/*
+* @file
+    row_view.h
+
+* @brief
+    已缓存结果集的只读随机访问行视图
+
+* @version
+    V1.0
+
+* @author
+    agent
+
+* @date
+    2026/10/19
+
+* @note
+    build时把mysql_store_result得到的全部行指针和字段长度一次性收集到连续数组中,
+    之后按下标访问任意行都不再修改结果集状态, 可被多个线程同时读取。
+    支持范围for遍历、按下标访问以及多线程分段处理:
+
+    zdb::row_view rows;
+    rows.build(res, error);
+    for(const zdb::row_ref& row : rows){ ... }
+    rows.parallel_for([](const zdb::row_ref& row){ ... });
+
+* @warning
+    视图中的数据属于result_set, result_set close或重新bind后视图失效; 不支持流式结果集
+* @bug
+* @copyright
+*/
+#ifndef zdb_row_view_h
+#define zdb_row_view_h
+#include <mysql.h>
+#include <stddef.h>
+#include <algorithm>
+#include <exception>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "result_set.h"
+#include "field_index.h"
+
+namespace zdb{
+    class row_view;
+
+    // 一行记录的只读引用, 可按值复制
+    class row_ref{
+        private:
+        const row_view* m_view;
+        size_t m_row;
+
+        public:
+        row_ref(const row_view* view, size_t row)
+            : m_view(view), m_row(row)
+        {
+        }
+
+        size_t get_index() const
+        {
+            return m_row;
+        }
+
+        /*
+		* @brief	判断字段是否为NULL函数。
+		* @param 	[in]  int idx  字段下标, 越界时视为NULL\n
+		* @return 	返回是否为NULL
+		* @note
+		* @warning
+		* @bug
+		*/
+        bool is_null(int idx) const;
+        /*
+		* @brief	获得字段值视图函数。
+		* @param 	[in]  int idx  字段下标\n
+		* @return 	返回字段值视图, NULL或越界时为空
+		* @note
+		* @warning
+		* @bug
+		*/
+        std::string_view get(int idx) const;
+
+        /*
+		* @brief	获得字段值函数, 类型与result_set::get_field相同。
+		* @param 	[in]  int idx               字段下标\n
+		* @param 	[out] val                   字段值, NULL时为0或空\n
+		* @param 	[out] std::string& error    错误信息\n
+		* @return 	返回是否成功
+		* @note
+		    const且不修改共享状态, 可在多个线程中同时调用
+		* @warning
+		* @bug
+		*/
+        bool get_field(int idx, int& val, std::string& error) const;
+        bool get_field(int idx, unsigned int& val, std::string& error) const;
+        bool get_field(int idx, long long& val, std::string& error) const;
+        bool get_field(int idx, bool& val, std::string& error) const;
+        bool get_field(int idx, float& val, std::string& error) const;
+        bool get_field(int idx, double& val, std::string& error) const;
+        bool get_field(int idx, std::string& val, std::string& error) const;
+        bool get_field(int idx, std::string_view& val, std::string& error) const;
+        bool get_field(int idx, MYSQL_TIME& val, std::string& error) const;
+
+        private:
+        bool get_raw(int idx, const char*& val, unsigned long& len, std::string& error) const;
+    };
+
+    class row_view{
+        private:
+        friend class row_ref;
+
+        std::vector<MYSQL_ROW> m_rows;          // 各行的字段指针数组
+        std::vector<unsigned long> m_lengths;   // 各行字段长度, 按行连续存放
+        int m_field_count;                      // 字段个数
+        ptr_field_index m_field_index;          // 字段名-字段下标
+        ptr_cached_result m_cached;             // 结果集为缓存副本时持有该副本
+
+        public:
+        class iterator{
+            private:
+            const row_view* m_view;
+            size_t m_row;
+
+            public:
+            typedef std::random_access_iterator_tag iterator_category;
+            typedef row_ref value_type;
+            typedef ptrdiff_t difference_type;
+            typedef const row_ref* pointer;
+            typedef row_ref reference;
+
+            iterator(const row_view* view, size_t row) : m_view(view), m_row(row) {}
+
+            row_ref operator*() const { return row_ref(m_view, m_row); }
+            row_ref operator[](difference_type n) const { return row_ref(m_view, m_row + n); }
+            iterator& operator++() { ++m_row; return *this; }
+            iterator operator++(int) { iterator it = *this; ++m_row; return it; }
+            iterator& operator--() { --m_row; return *this; }
+            iterator operator--(int) { iterator it = *this; --m_row; return it; }
+            iterator& operator+=(difference_type n) { m_row += n; return *this; }
+            iterator& operator-=(difference_type n) { m_row -= n; return *this; }
+            iterator operator+(difference_type n) const { return iterator(m_view, m_row + n); }
+            iterator operator-(difference_type n) const { return iterator(m_view, m_row - n); }
+            difference_type operator-(const iterator& other) const { return (difference_type)m_row - (difference_type)other.m_row; }
+            bool operator==(const iterator& other) const { return m_row == other.m_row; }
+            bool operator!=(const iterator& other) const { return m_row != other.m_row; }
+            bool operator<(const iterator& other) const { return m_row < other.m_row; }
+        };
+
+        row_view();
+
+        /*
+		* @brief	从已缓存的结果集构建行视图函数。
+		* @param 	[in]  result_set& rs        mysql_store_result得到的结果集\n
+		* @param 	[out] std::string& error    错误信息\n
+		* @return 	返回是否成功
+		* @note
+		    构建时会遍历结果集, 完成后结果集的当前行失效, 需重新seek
+		* @warning
+		* @bug
+		*/
+        bool build(result_set& rs, std::string& error);
+        /*
+		* @brief	根据字段名获得字段下标函数。
+		* @param 	[in]  std::string_view name  字段名\n
+		* @return 	返回字段下标, 不存在时为-1
+		* @note
+		* @warning
+		* @bug
+		*/
+        int get_field_idx_by_name(std::string_view name) const;
+        /*
+		* @brief	清空视图函数。
+		* @param 	无\n
+		* @return 	无
+		* @note
+		* @warning
+		* @bug
+		*/
+        void clear();
+
+        size_t size() const
+        {
+            return m_rows.size();
+        }
+
+        int get_field_count() const
+        {
+            return m_field_count;
+        }
+
+        row_ref operator[](size_t row) const
+        {
+            return row_ref(this, row);
+        }
+
+        iterator begin() const
+        {
+            return iterator(this, 0);
+        }
+
+        iterator end() const
+        {
+            return iterator(this, m_rows.size());
+        }
+
+        /*
+		* @brief	把全部行分成连续的若干段, 在多个线程中分别处理函数。
+		* @param 	[in]  fn                fn(size_t begin, size_t end)处理[begin, end)行\n
+		* @param 	[in]  size_t threads    线程数, 0为硬件线程数\n
+		* @return 	无
+		* @note
+		    当前线程处理第一段; fn抛出的第一个异常在全部线程结束后重新抛出
+		* @warning
+		* @bug
+		*/
+        template<typename Fn>
+        void for_each_partition(Fn fn, size_t threads = 0) const
+        {
+            size_t count = m_rows.size();
+            if(0 == threads){
+                threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+            }
+            threads = std::min(threads, std::max<size_t>(1, count));
+
+            size_t step = (count + threads - 1) / threads;
+            std::vector<std::exception_ptr> errors(threads);
+            std::vector<std::thread> workers;
+            workers.reserve(threads - 1);
+
+            auto run = [&](size_t part){
+                size_t begin = std::min(count, part * step);
+                size_t end = std::min(count, begin + step);
+                try{
+                    if(begin < end){
+                        fn(begin, end);
+                    }
+                }catch(...){
+                    errors[part] = std::current_exception();
+                }
+            };
+
+            for(size_t part = 1; part < threads; ++part){
+                workers.emplace_back(run, part);
+            }
+            run(0);
+
+            for(auto& worker : workers){
+                worker.join();
+            }
+
+            for(auto& e : errors){
+                if(e){
+                    std::rethrow_exception(e);
+                }
+            }
+        }
+        /*
+		* @brief	在多个线程中逐行处理函数。
+		* @param 	[in]  fn                fn(const row_ref&)处理一行\n
+		* @param 	[in]  size_t threads    线程数, 0为硬件线程数\n
+		* @return 	无
+		* @note
+		    见for_each_partition
+		* @warning
+		* @bug
+		*/
+        template<typename Fn>
+        void parallel_for(Fn fn, size_t threads = 0) const
+        {
+            for_each_partition([this, &fn](size_t begin, size_t end){
+                for(size_t i = begin; i < end; ++i){
+                    fn(row_ref(this, i));
+                }
+            }, threads);
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,677 @@
+/*
+* @file
+    stmt_binder.h
+
+* @brief
+    预处理语句参数/结果类型绑定模板
+
+* @version
+    V1.0
+
+* @author
+    agent
+
+* @date
+    2026/10/19
+
+* @note
+    根据C++类型在编译期生成MYSQL_BIND数组, 绑定缓冲区由绑定器自身持有,
+    重复执行时只覆盖取值, 不做任何堆分配。
+    支持的参数类型: 整数、bool、float、double、MYSQL_TIME、
+    std::string / std::string_view / const char*、std::nullptr_t、std::optional<T>
+
+* @warning
+    字符串参数不复制, 执行完成前调用者必须保证其有效
+* @bug
+* @copyright
+*/
+#ifndef zdb_stmt_binder_h
+#define zdb_stmt_binder_h
+#include <mysql.h>
+#include <string.h>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// MariaDB Connector/C 3.0起支持STMT_ATTR_ARRAY_SIZE批量绑定
+#if defined(MARIADB_PACKAGE_VERSION_ID) && MARIADB_PACKAGE_VERSION_ID >= 30000
+#define ZDB_HAVE_BULK 1
+#endif
+
+namespace zdb{
+    // MariaDB/MySQL 5.x为my_bool, MySQL 8为bool
+    typedef std::remove_pointer<decltype(MYSQL_BIND::is_null)>::type bind_flag;
+
+    template<size_t size> struct int_field_type;
+    template<> struct int_field_type<1>{ static const enum_field_types value = MYSQL_TYPE_TINY; };
+    template<> struct int_field_type<2>{ static const enum_field_types value = MYSQL_TYPE_SHORT; };
+    template<> struct int_field_type<4>{ static const enum_field_types value = MYSQL_TYPE_LONG; };
+    template<> struct int_field_type<8>{ static const enum_field_types value = MYSQL_TYPE_LONGLONG; };
+
+    inline enum_field_types time_field_type(const MYSQL_TIME& val)
+    {
+        switch(val.time_type){
+            case MYSQL_TIMESTAMP_DATE: return MYSQL_TYPE_DATE;
+            case MYSQL_TIMESTAMP_TIME: return MYSQL_TYPE_TIME;
+            default:                   return MYSQL_TYPE_DATETIME;
+        }
+    }
+
+    /*
+    * 参数绑定特性, 未特化的类型在编译期报错。
+    * storage为绑定器内保存取值的类型, set把取值写入storage并填好MYSQL_BIND。
+    */
+    template<typename T, typename Enable = void>
+    struct param_traits;
+
+    template<typename T>
+    struct param_traits<T, typename std::enable_if<std::is_integral<T>::value>::type>{
+        typedef T storage;
+        static void set(MYSQL_BIND& b, storage& s, unsigned long&, const T& val)
+        {
+            s = val;
+            b.buffer_type = int_field_type<sizeof(T)>::value;
+            b.buffer = &s;
+            b.is_unsigned = std::is_unsigned<T>::value;
+        }
+    };
+
+    template<>
+    struct param_traits<float>{
+        typedef float storage;
+        static void set(MYSQL_BIND& b, storage& s, unsigned long&, const float& val)
+        {
+            s = val;
+            b.buffer_type = MYSQL_TYPE_FLOAT;
+            b.buffer = &s;
+        }
+    };
+
+    template<>
+    struct param_traits<double>{
+        typedef double storage;
+        static void set(MYSQL_BIND& b, storage& s, unsigned long&, const double& val)
+        {
+            s = val;
+            b.buffer_type = MYSQL_TYPE_DOUBLE;
+            b.buffer = &s;
+        }
+    };
+
+    template<>
+    struct param_traits<MYSQL_TIME>{
+        typedef MYSQL_TIME storage;
+        static void set(MYSQL_BIND& b, storage& s, unsigned long&, const MYSQL_TIME& val)
+        {
+            s = val;
+            b.buffer_type = time_field_type(val);
+            b.buffer = &s;
+        }
+    };
+
+    template<>
+    struct param_traits<std::string_view>{
+        struct storage{};
+        static void set(MYSQL_BIND& b, storage&, unsigned long& len, const std::string_view& val)
+        {
+            len = (unsigned long)val.size();
+            b.buffer_type = MYSQL_TYPE_STRING;
+            b.buffer = const_cast<char*>(val.data());
+            b.buffer_length = len;
+            b.length = &len;
+        }
+    };
+
+    template<>
+    struct param_traits<std::string>{
+        typedef param_traits<std::string_view>::storage storage;
+        static void set(MYSQL_BIND& b, storage& s, unsigned long& len, const std::string& val)
+        {
+            param_traits<std::string_view>::set(b, s, len, std::string_view(val));
+        }
+    };
+
+    template<>
+    struct param_traits<const char*>{
+        typedef param_traits<std::string_view>::storage storage;
+        static void set(MYSQL_BIND& b, storage& s, unsigned long& len, const char* val)
+        {
+            param_traits<std::string_view>::set(b, s, len, val?std::string_view(val):std::string_view());
+        }
+    };
+
+    template<>
+    struct param_traits<std::nullptr_t>{
+        struct storage{};
+        static void set(MYSQL_BIND& b, storage&, unsigned long&, const std::nullptr_t&)
+        {
+            b.buffer_type = MYSQL_TYPE_NULL;
+            b.buffer = 0;
+        }
+    };
+
+    template<typename T>
+    struct param_traits<std::optional<T>>{
+        typedef typename param_traits<T>::storage storage;
+        static void set(MYSQL_BIND& b, storage& s, unsigned long& len, const std::optional<T>& val)
+        {
+            if(val){
+                param_traits<T>::set(b, s, len, *val);
+            }else{
+                param_traits<std::nullptr_t>::storage null_storage;
+                param_traits<std::nullptr_t>::set(b, null_storage, len, nullptr);
+            }
+        }
+    };
+
+    // 字符串字面量及char数组按const char*绑定
+    template<typename T>
+    struct param_decay{
+        typedef typename std::decay<T>::type type;
+    };
+
+    template<>
+    struct param_decay<char*>{
+        typedef const char* type;
+    };
+
+    template<typename T>
+    using param_decay_t = typename param_decay<typename std::decay<T>::type>::type;
+
+    /*
+    * @brief
+        参数绑定器。持有MYSQL_BIND数组及取值缓冲区, 可在循环中反复set后执行。
+    * @note
+        param_binder<int64_t, std::string_view> binder;
+        for(...){
+            binder.set(id, name);
+            conn->execute_prepared(sql, binder.binds(), 0, error);
+        }
+    */
+    template<typename... Args>
+    class param_binder{
+        private:
+        static const size_t m_count = sizeof...(Args);
+
+        MYSQL_BIND m_binds[m_count?m_count:1];
+        unsigned long m_lengths[m_count?m_count:1];
+        std::tuple<typename param_traits<Args>::storage...> m_values;
+
+        template<size_t... I>
+        void set_impl(std::index_sequence<I...>, const Args&... args)
+        {
+            int expand[] = {0, (param_traits<Args>::set(m_binds[I], std::get<I>(m_values), m_lengths[I], args), 0)...};
+            (void)expand;
+        }
+
+        public:
+        param_binder()
+        {
+            memset(m_binds, 0, sizeof(m_binds));
+            memset(m_lengths, 0, sizeof(m_lengths));
+        }
+
+        // 绑定器内部互相指向, 不可复制
+        param_binder(const param_binder&) = delete;
+        param_binder& operator=(const param_binder&) = delete;
+
+        void set(const Args&... args)
+        {
+            set_impl(std::index_sequence_for<Args...>(), args...);
+        }
+
+        MYSQL_BIND* binds()
+        {
+            return m_count?m_binds:0;
+        }
+
+        static size_t count()
+        {
+            return m_count;
+        }
+    };
+
+    /*
+    * 结果绑定特性。bind在mysql_stmt_bind_result前指向接收变量,
+    * reset在每次fetch前调用, finish在fetch后补取变长数据; NULL字段得到0或空值。
+    * refetch为true的类型在finish中按实际长度重取, 允许fetch报告截断, 其余类型截断时fetch失败。
+    */
+    template<typename T, typename Enable = void>
+    struct result_traits;
+
+    template<typename T>
+    struct result_traits<T, typename std::enable_if<std::is_arithmetic<T>::value>::type>{
+        static void bind(MYSQL_BIND& b, T& val)
+        {
+            if(std::is_integral<T>::value){
+                b.buffer_type = int_field_type<sizeof(T)>::value;
+            }else{
+                b.buffer_type = (sizeof(T) == sizeof(float))?MYSQL_TYPE_FLOAT:MYSQL_TYPE_DOUBLE;
+            }
+            b.buffer = &val;
+            b.is_unsigned = std::is_unsigned<T>::value;
+        }
+        static void reset(T&){}
+        static bool finish(MYSQL_STMT*, MYSQL_BIND& b, unsigned int, T& val)
+        {
+            if(*b.is_null){
+                val = 0;
+            }
+
+            return true;
+        }
+        static const bool refetch = false;
+    };
+
+    template<>
+    struct result_traits<MYSQL_TIME>{
+        static void bind(MYSQL_BIND& b, MYSQL_TIME& val)
+        {
+            b.buffer_type = MYSQL_TYPE_DATETIME;
+            b.buffer = &val;
+        }
+        static void reset(MYSQL_TIME&){}
+        static bool finish(MYSQL_STMT*, MYSQL_BIND& b, unsigned int, MYSQL_TIME& val)
+        {
+            if(*b.is_null){
+                memset(&val, 0, sizeof(val));
+            }
+
+            return true;
+        }
+        static const bool refetch = false;
+    };
+
+    template<>
+    struct result_traits<std::string>{
+        static void bind(MYSQL_BIND& b, std::string&)
+        {
+            b.buffer_type = MYSQL_TYPE_STRING;
+            b.buffer = 0;
+            b.buffer_length = 0;
+        }
+        static void reset(std::string&){}
+        static bool finish(MYSQL_STMT* stmt, MYSQL_BIND& b, unsigned int idx, std::string& val)
+        {
+            if(*b.is_null){
+                val.clear();
+                return true;
+            }
+
+            val.resize(*b.length);
+            if(val.empty()){
+                return true;
+            }
+
+            b.buffer = &val[0];
+            b.buffer_length = (unsigned long)val.size();
+            int ret = mysql_stmt_fetch_column(stmt, &b, idx, 0);
+            b.buffer = 0;
+            b.buffer_length = 0;
+
+            return ret == 0;
+        }
+        static const bool refetch = true;
+    };
+
+    template<typename T>
+    struct result_traits<std::optional<T>>{
+        static void bind(MYSQL_BIND& b, std::optional<T>& val)
+        {
+            val.emplace();
+            result_traits<T>::bind(b, *val);
+        }
+        static void reset(std::optional<T>& val)
+        {
+            // 存储就地复用, 地址与bind时一致
+            if(!val){
+                val.emplace();
+            }
+        }
+        static bool finish(MYSQL_STMT* stmt, MYSQL_BIND& b, unsigned int idx, std::optional<T>& val)
+        {
+            if(*b.is_null){
+                val.reset();
+                return true;
+            }
+
+            return result_traits<T>::finish(stmt, b, idx, *val);
+        }
+        static const bool refetch = result_traits<T>::refetch;
+    };
+
+    /*
+    * @brief
+        结果绑定器。把预处理查询的每一行直接写入std::tuple<Ts...>。
+    * @note
+        result_binder<int64_t, std::string> rows;
+        if(rows.bind(stmt, error)){
+            while(rows.fetch(error) > 0){
+                auto& row = rows.row();
+            }
+        }
+    */
+    template<typename... Ts>
+    class result_binder{
+        private:
+        static const size_t m_count = sizeof...(Ts);
+
+        MYSQL_STMT* m_stmt;
+        MYSQL_BIND m_binds[m_count?m_count:1];
+        unsigned long m_lengths[m_count?m_count:1];
+        bind_flag m_is_null[m_count?m_count:1];
+        bind_flag m_errors[m_count?m_count:1];
+        std::tuple<Ts...> m_row;
+
+        template<size_t... I>
+        void bind_impl(std::index_sequence<I...>)
+        {
+            int expand[] = {0, (result_traits<Ts>::bind(m_binds[I], std::get<I>(m_row)), 0)...};
+            (void)expand;
+        }
+
+        template<size_t... I>
+        void reset_impl(std::index_sequence<I...>)
+        {
+            int expand[] = {0, (result_traits<Ts>::reset(std::get<I>(m_row)), 0)...};
+            (void)expand;
+        }
+
+        // 返回第一个截断且不会重取的列, 没有时返回-1
+        template<size_t... I>
+        int truncated_impl(std::index_sequence<I...>)
+        {
+            int idx = -1;
+            int expand[] = {0, ((idx < 0 && m_errors[I] && !result_traits<Ts>::refetch)?(idx = (int)I):0)...};
+            (void)expand;
+            return idx;
+        }
+
+        template<size_t... I>
+        bool finish_impl(std::index_sequence<I...>)
+        {
+            bool ok = true;
+            int expand[] = {0, (ok = result_traits<Ts>::finish(m_stmt, m_binds[I], (unsigned int)I, std::get<I>(m_row)) && ok, 0)...};
+            (void)expand;
+            return ok;
+        }
+
+        public:
+        result_binder(): m_stmt(0)
+        {
+            memset(m_binds, 0, sizeof(m_binds));
+        }
+
+        result_binder(const result_binder&) = delete;
+        result_binder& operator=(const result_binder&) = delete;
+
+        /*
+	    * @brief
+	        绑定到已执行的stmt函数。
+	    * @param  [in]  MYSQL_STMT* stmt    已执行的stmt\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回绑定是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	        列数与模板参数个数不一致时失败
+	    * @bug
+	    */
+        bool bind(MYSQL_STMT* stmt, std::string& error)
+        {
+            m_stmt = stmt;
+            if(0 == m_stmt){
+                error = "bind error, stmt = null";
+                return false;
+            }
+
+            if(mysql_stmt_field_count(m_stmt) != m_count){
+                error = "column count does not match the bound tuple";
+                return false;
+            }
+
+            memset(m_binds, 0, sizeof(m_binds));
+            for(size_t i = 0; i < m_count; ++i){
+                m_binds[i].length = &m_lengths[i];
+                m_binds[i].is_null = &m_is_null[i];
+                m_binds[i].error = &m_errors[i];
+            }
+            bind_impl(std::index_sequence_for<Ts...>());
+
+            if(m_count && mysql_stmt_bind_result(m_stmt, m_binds) != 0){
+                error = "failed to call mysql_stmt_bind_result, last_error=";
+                error += mysql_stmt_error(m_stmt);
+                return false;
+            }
+
+            return true;
+        }
+        /*
+	    * @brief
+	        获取下一行函数。
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回获取结果
+	    * @return  1   获得一行, 可通过row()读取\n
+	    * @return  0   没有更多数据\n
+	    * @return  -1  失败\n
+	    * @note
+	        NULL字段得到0或空值, 需要区分时使用std::optional<T>
+	    * @warning
+	        数值或时间列的值超出绑定类型(如int32_t接收BIGINT)时失败
+	    * @bug
+	    */
+        int fetch(std::string& error)
+        {
+            if(0 == m_stmt){
+                error = "bind error, m_stmt = null";
+                return -1;
+            }
+
+            reset_impl(std::index_sequence_for<Ts...>());
+
+            int ret = mysql_stmt_fetch(m_stmt);
+            if(MYSQL_NO_DATA == ret){
+                return 0;
+            }
+
+            if(ret != 0 && MYSQL_DATA_TRUNCATED != ret){
+                error = "failed to call mysql_stmt_fetch, last_error=";
+                error += mysql_stmt_error(m_stmt);
+                return -1;
+            }
+
+            // 字符串先以0长度取得长度再重取, 截断是预期的; 数值和时间截断说明类型不匹配
+            if(MYSQL_DATA_TRUNCATED == ret){
+                int idx = truncated_impl(std::index_sequence_for<Ts...>());
+                if(idx >= 0){
+                    error = "column " + std::to_string(idx) + " is truncated, the bound type is too narrow";
+                    return -1;
+                }
+            }
+
+            if(!finish_impl(std::index_sequence_for<Ts...>())){
+                error = "failed to call mysql_stmt_fetch_column, last_error=";
+                error += mysql_stmt_error(m_stmt);
+                return -1;
+            }
+
+            return 1;
+        }
+
+        std::tuple<Ts...>& row()
+        {
+            return m_row;
+        }
+    };
+
+    /*
+    * 估算参数在二进制协议包中占用的字节数, 用于按max_allowed_packet切分批量执行。
+    */
+    template<typename T>
+    inline size_t bind_size(const T&)
+    {
+        return sizeof(T);
+    }
+
+    inline size_t bind_size(const MYSQL_TIME&)
+    {
+        return 12;
+    }
+
+    inline size_t bind_size(const std::string_view& val)
+    {
+        return val.size() + 9;
+    }
+
+    inline size_t bind_size(const std::string& val)
+    {
+        return val.size() + 9;
+    }
+
+    inline size_t bind_size(const char* val)
+    {
+        return (val?strlen(val):0) + 9;
+    }
+
+    inline size_t bind_size(const std::nullptr_t&)
+    {
+        return 0;
+    }
+
+    template<typename T>
+    inline size_t bind_size(const std::optional<T>& val)
+    {
+        return val?bind_size(*val):0;
+    }
+
+    template<typename... Args>
+    inline size_t row_bind_size(const std::tuple<Args...>& row)
+    {
+        // 每个参数2字节类型信息, 加NULL位图
+        size_t size = 2 * sizeof...(Args) + (sizeof...(Args) + 7) / 8;
+        std::apply([&size](const Args&... args){
+            int expand[] = {0, (size += bind_size(args), 0)...};
+            (void)expand;
+        }, row);
+
+        return size;
+    }
+
+#ifdef ZDB_HAVE_BULK
+    /*
+    * 批量绑定的列缓冲区: 定长类型为值数组, 字符串为指针数组加长度数组,
+    * std::optional<T>额外带一个指示符数组。
+    */
+    template<typename T>
+    struct bulk_column{
+        // std::vector<bool>没有连续存储, 按1字节整数保存
+        typedef typename std::conditional<std::is_same<T, bool>::value, unsigned char, typename param_traits<T>::storage>::type value_type;
+        std::vector<value_type> m_values;
+
+        void reserve(size_t n)
+        {
+            m_values.reserve(n);
+        }
+
+        void push(const T& val)
+        {
+            m_values.push_back(val);
+        }
+
+        // NULL行占位, 值不会被读取
+        void push_null()
+        {
+            m_values.push_back(value_type());
+        }
+
+        void bind(MYSQL_BIND& b)
+        {
+            typename param_traits<T>::storage first;
+            unsigned long len = 0;
+            param_traits<T>::set(b, first, len, (T)m_values.front());
+            b.buffer = m_values.data();
+        }
+    };
+
+    struct bulk_string_column{
+        std::vector<const char*> m_values;
+        std::vector<unsigned long> m_lengths;
+
+        void reserve(size_t n)
+        {
+            m_values.reserve(n);
+            m_lengths.reserve(n);
+        }
+
+        void push(const std::string_view& val)
+        {
+            m_values.push_back(val.data());
+            m_lengths.push_back((unsigned long)val.size());
+        }
+
+        void push_null()
+        {
+            push(std::string_view());
+        }
+
+        void bind(MYSQL_BIND& b)
+        {
+            b.buffer_type = MYSQL_TYPE_STRING;
+            b.buffer = m_values.data();
+            b.length = m_lengths.data();
+        }
+    };
+
+    template<>
+    struct bulk_column<std::string_view>: public bulk_string_column{};
+
+    template<>
+    struct bulk_column<std::string>: public bulk_string_column{};
+
+    template<>
+    struct bulk_column<const char*>: public bulk_string_column{
+        void push(const char* val)
+        {
+            bulk_string_column::push(val?std::string_view(val):std::string_view());
+        }
+    };
+
+    template<typename T>
+    struct bulk_column<std::optional<T>>{
+        bulk_column<T> m_column;
+        std::vector<char> m_indicators;
+
+        void reserve(size_t n)
+        {
+            m_column.reserve(n);
+            m_indicators.reserve(n);
+        }
+
+        // 字符串列只保存指针, 须直接传入*val而不是临时副本
+        void push(const std::optional<T>& val)
+        {
+            if(val){
+                m_column.push(*val);
+                m_indicators.push_back(STMT_INDICATOR_NONE);
+            }else{
+                m_column.push_null();
+                m_indicators.push_back(STMT_INDICATOR_NULL);
+            }
+        }
+
+        void bind(MYSQL_BIND& b)
+        {
+            m_column.bind(b);
+            b.u.indicator = m_indicators.data();
+        }
+    };
+#endif
+}
+
+#endif
\ No newline at end of file
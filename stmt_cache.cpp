@@ -0,0 +1,106 @@
+#include "stmt_cache.h"
+#include <string.h>
+
+namespace zdb{
+    stmt_cache::stmt_cache(size_t capacity)
+    {
+        m_capacity = (capacity > 0)?capacity:1;
+    }
+
+    stmt_cache::~stmt_cache()
+    {
+        clear();
+    }
+
+    MYSQL_STMT* stmt_cache::get(MYSQL* conn, const char* sql, std::string& error)
+    {
+        if(NULL == conn){
+            error = "not connected to database.";
+            return 0;
+        }
+
+        auto fi = m_stmt_map.find(sql);
+        if(fi != m_stmt_map.end()){
+            m_lru_list.splice(m_lru_list.begin(), m_lru_list, fi->second);
+            return fi->second->second;
+        }
+
+        if(m_lru_list.size() >= m_capacity){
+            evict(m_lru_list.size() - m_capacity + 1);
+        }
+
+        MYSQL_STMT* stmt = mysql_stmt_init(conn);
+        if(NULL == stmt){
+            error = "failed to call mysql_stmt_init, last_error=";
+            error += mysql_error(conn);
+            return 0;
+        }
+
+        unsigned long len = strlen(sql);
+        int ret = mysql_stmt_prepare(stmt, sql, len);
+        if(ret != 0 && mysql_stmt_errno(stmt) == ZDB_ER_MAX_PREPARED_STMT_COUNT_REACHED && !m_lru_list.empty()){
+            // 服务端句柄数已达上限, 归还一半缓存后再试一次
+            evict((m_lru_list.size() + 1) / 2);
+            ret = mysql_stmt_prepare(stmt, sql, len);
+        }
+
+        if(ret != 0){
+            error = "failed to call mysql_stmt_prepare, last_error=";
+            error += mysql_stmt_error(stmt);
+            mysql_stmt_close(stmt);
+            return 0;
+        }
+
+        m_lru_list.push_front(std::make_pair(std::string(sql), stmt));
+        m_stmt_map[m_lru_list.front().first] = m_lru_list.begin();
+
+        return stmt;
+    }
+
+    void stmt_cache::remove(const char* sql)
+    {
+        auto fi = m_stmt_map.find(sql);
+        if(fi == m_stmt_map.end()){
+            return;
+        }
+
+        mysql_stmt_close(fi->second->second);
+        m_lru_list.erase(fi->second);
+        m_stmt_map.erase(fi);
+    }
+
+    bool stmt_cache::is_invalid_error(unsigned int code)
+    {
+        return ZDB_ER_UNKNOWN_STMT_HANDLER == code || ZDB_ER_NEED_REPREPARE == code
+            || ZDB_CR_SERVER_GONE_ERROR == code || ZDB_CR_SERVER_LOST == code;
+    }
+
+    void stmt_cache::clear()
+    {
+        for(auto& it : m_lru_list){
+            mysql_stmt_close(it.second);
+        }
+
+        m_stmt_map.clear();
+        m_lru_list.clear();
+    }
+
+    void stmt_cache::set_capacity(size_t capacity)
+    {
+        m_capacity = (capacity > 0)?capacity:1;
+
+        if(m_lru_list.size() > m_capacity){
+            evict(m_lru_list.size() - m_capacity);
+        }
+    }
+
+    void stmt_cache::evict(size_t count)
+    {
+        while(count-- > 0 && !m_lru_list.empty()){
+            stmt_item& item = m_lru_list.back();
+            mysql_stmt_close(item.second);
+            m_stmt_map.erase(item.first);
+            m_lru_list.pop_back();
+        }
+    }
+}
@@ -0,0 +1,128 @@
+/*
+* @file
+    stmt_cache.h
+
+* @brief
+    预处理语句LRU缓存类
+
+* @version
+    V1.0
+
+* @author
+    agent
+
+* @date
+    2026/10/19
+
+* @note
+    以SQL文本为键缓存MYSQL_STMT句柄，超出容量时关闭最久未使用的句柄
+
+* @warning
+    缓存属于单个连接，不可跨连接共享；连接关闭或重连前必须先清空
+* @bug
+* @copyright
+*/
+#ifndef zdb_stmt_cache_h
+#define zdb_stmt_cache_h
+#include <mysql.h>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+namespace zdb{
+    const unsigned int ZDB_ER_MAX_PREPARED_STMT_COUNT_REACHED = 1461;   // 同mysqld_error.h的ER_MAX_PREPARED_STMT_COUNT_REACHED, 服务端预处理语句数超过max_prepared_stmt_count
+    const unsigned int ZDB_ER_UNKNOWN_STMT_HANDLER            = 1243;   // 同ER_UNKNOWN_STMT_HANDLER, 服务端已没有该句柄
+    const unsigned int ZDB_ER_NEED_REPREPARE                  = 1615;   // 同ER_NEED_REPREPARE, 表结构变化后须重新预处理
+    const unsigned int ZDB_CR_SERVER_GONE_ERROR               = 2006;   // 同errmsg.h的CR_SERVER_GONE_ERROR
+    const unsigned int ZDB_CR_SERVER_LOST                     = 2013;   // 同errmsg.h的CR_SERVER_LOST
+
+    class stmt_cache{
+        private:
+        typedef std::pair<std::string, MYSQL_STMT*> stmt_item;
+        typedef std::list<stmt_item>::iterator stmt_iter;
+
+        std::list<stmt_item> m_lru_list;                        // 最近使用的在表头
+        std::unordered_map<std::string, stmt_iter> m_stmt_map;  // SQL文本-缓存节点
+        size_t m_capacity;                                      // 最大缓存句柄数
+
+        public:
+        stmt_cache(size_t capacity = 64);
+        ~stmt_cache();
+
+        /*
+		* @brief	获取(必要时预处理)SQL对应的stmt函数。
+		* @param 	[in]  MYSQL* conn          数据库连接\n
+		* @param 	[in]  const char* sql      预处理SQL语句\n
+		* @param 	[out] std::string& error   错误信息\n
+		* @return 	返回stmt句柄
+		* @return  	0    失败\n
+		* @return  	!=0  成功\n
+		* @note
+		    服务端返回ZDB_ER_MAX_PREPARED_STMT_COUNT_REACHED时释放一半缓存后重试一次
+		* @warning
+		* @bug
+		*/
+        MYSQL_STMT* get(MYSQL* conn, const char* sql, std::string& error);
+        /*
+		* @brief	从缓存中移除并关闭SQL对应的stmt函数。
+		* @param 	[in]  const char* sql      预处理SQL语句\n
+		* @return 	无\n
+		* @note
+		    句柄失效(is_invalid_error)后调用，避免继续复用状态异常的句柄
+		* @warning
+		* @bug
+		*/
+        void remove(const char* sql);
+        /*
+		* @brief	判断执行错误是否使句柄失效函数。
+		* @param 	[in]  unsigned int code    mysql_stmt_errno的错误码\n
+		* @return 	返回句柄或连接是否已失效
+		* @note
+		    重复键、死锁、锁等待超时等错误不影响句柄, 不应移除, 以免在冲突频繁的路径上反复预处理
+		* @warning
+		* @bug
+		*/
+        static bool is_invalid_error(unsigned int code);
+        /*
+		* @brief	关闭并清空全部缓存句柄函数。
+		* @param 	无\n
+		* @return 	无\n
+		* @note
+		* @warning
+		* @bug
+		*/
+        void clear();
+        /*
+		* @brief	设置缓存容量函数。
+		* @param 	[in]  size_t capacity  最大缓存句柄数，最小为1\n
+		* @return 	无\n
+		* @note
+		* @warning
+		* @bug
+		*/
+        void set_capacity(size_t capacity);
+
+        size_t size() const
+        {
+            return m_lru_list.size();
+        }
+
+        size_t capacity() const
+        {
+            return m_capacity;
+        }
+
+        private:
+        /*
+		* @brief	关闭最久未使用的若干个stmt函数。
+		* @param 	[in]  size_t count  要关闭的个数\n
+		* @return 	无\n
+		* @note
+		* @warning
+		* @bug
+		*/
+        void evict(size_t count);
+    };
+}
+
+#endif
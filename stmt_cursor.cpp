@@ -0,0 +1,85 @@
+#include "stmt_cursor.h"
+#include <string.h>
+
+namespace zdb{
+    stmt_cursor::stmt_cursor()
+    {
+        m_stmt = 0;
+    }
+
+    stmt_cursor::~stmt_cursor()
+    {
+        close();
+    }
+
+    bool stmt_cursor::execute(MYSQL_STMT* stmt, MYSQL_BIND* binds, unsigned long prefetch_rows, std::string& error)
+    {
+        if(NULL == stmt){
+            error = "bind error, stmt = null";
+            return false;
+        }
+
+        unsigned long cursor_type = CURSOR_TYPE_READ_ONLY;
+        unsigned long prefetch = (prefetch_rows > 0)?prefetch_rows:DEFAULT_CURSOR_PREFETCH_ROWS;
+
+        if(mysql_stmt_attr_set(stmt, STMT_ATTR_CURSOR_TYPE, &cursor_type) != 0
+            || mysql_stmt_attr_set(stmt, STMT_ATTR_PREFETCH_ROWS, &prefetch) != 0){
+            error = "failed to call mysql_stmt_attr_set, last_error=";
+            error += mysql_stmt_error(stmt);
+            return false;
+        }
+
+        if(binds && mysql_stmt_bind_param(stmt, binds) != 0){
+            error = "failed to call mysql_stmt_bind_param, last_error=";
+            error += mysql_stmt_error(stmt);
+            return false;
+        }
+
+        if(mysql_stmt_execute(stmt) != 0){
+            error = "failed to call mysql_stmt_execute, last_error=";
+            error += mysql_stmt_error(stmt);
+            return false;
+        }
+
+        return true;
+    }
+
+    bool stmt_cursor::open(MYSQL* conn, const char* sql, MYSQL_BIND* binds, unsigned long prefetch_rows, std::string& error)
+    {
+        close();
+
+        if(NULL == conn){
+            error = "not connected to database.";
+            return false;
+        }
+
+        m_stmt = mysql_stmt_init(conn);
+        if(NULL == m_stmt){
+            error = "failed to call mysql_stmt_init, last_error=";
+            error += mysql_error(conn);
+            return false;
+        }
+
+        if(mysql_stmt_prepare(m_stmt, sql, strlen(sql)) != 0){
+            error = "failed to call mysql_stmt_prepare, last_error=";
+            error += mysql_stmt_error(m_stmt);
+            close();
+            return false;
+        }
+
+        if(!execute(m_stmt, binds, prefetch_rows, error)){
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void stmt_cursor::close()
+    {
+        if(m_stmt){
+            mysql_stmt_close(m_stmt);
+            m_stmt = 0;
+        }
+    }
+}
@@ -0,0 +1,97 @@
+/*
+* @file
+    stmt_cursor.h
+
+* @brief
+    预处理语句服务端游标类
+
+* @version
+    V1.0
+
+* @author
+    agent
+
+* @date
+    2026/10/19
+
+* @note
+    以CURSOR_TYPE_READ_ONLY执行预处理查询, 结果留在服务端,
+    每次按STMT_ATTR_PREFETCH_ROWS行分块取回。游标打开期间同一连接可执行其他语句。
+
+* @warning
+* @bug
+* @copyright
+*/
+#ifndef zdb_stmt_cursor_h
+#define zdb_stmt_cursor_h
+#include <mysql.h>
+#include <string>
+
+namespace zdb{
+    const unsigned long DEFAULT_CURSOR_PREFETCH_ROWS = 1000;    // 默认每次从服务端取回的行数
+
+    class stmt_cursor{
+        private:
+        MYSQL_STMT* m_stmt;     // 游标专用stmt, 不进入预处理语句缓存
+
+        public:
+        stmt_cursor();
+        ~stmt_cursor();
+
+        stmt_cursor(const stmt_cursor&) = delete;
+        stmt_cursor& operator=(const stmt_cursor&) = delete;
+
+        /*
+		* @brief	在已预处理的stmt上打开只读游标函数。
+		* @param 	[in]  MYSQL_STMT* stmt             已预处理的stmt\n
+		* @param 	[in]  MYSQL_BIND* binds            参数BIND, 无参数时为0\n
+		* @param 	[in]  unsigned long prefetch_rows  每次取回的行数\n
+		* @param 	[out] std::string& error           错误信息\n
+		* @return 	返回打开游标是否成功
+		* @return  	false  失败\n
+		* @return  	true  成功\n
+		* @note
+		* @warning
+		* @bug
+		*/
+        static bool execute(MYSQL_STMT* stmt, MYSQL_BIND* binds, unsigned long prefetch_rows, std::string& error);
+        /*
+		* @brief	预处理SQL并打开只读游标函数。
+		* @param 	[in]  MYSQL* conn                  数据库连接\n
+		* @param 	[in]  const char* sql              预处理查询语句\n
+		* @param 	[in]  MYSQL_BIND* binds            参数BIND, 无参数时为0\n
+		* @param 	[in]  unsigned long prefetch_rows  每次取回的行数\n
+		* @param 	[out] std::string& error           错误信息\n
+		* @return 	返回打开游标是否成功
+		* @return  	false  失败\n
+		* @return  	true  成功\n
+		* @note
+		* @warning
+		* @bug
+		*/
+        bool open(MYSQL* conn, const char* sql, MYSQL_BIND* binds, unsigned long prefetch_rows, std::string& error);
+        /*
+		* @brief	获得游标stmt函数。
+		* @param 	无\n
+		* @return 	返回stmt, 用于mysql_stmt_bind_result/result_binder
+		* @note
+		* @warning
+		* @bug
+		*/
+        MYSQL_STMT* get_stmt()
+        {
+            return m_stmt;
+        }
+        /*
+		* @brief	关闭游标函数。
+		* @param 	无\n
+		* @return 	无\n
+		* @note
+		* @warning
+		* @bug
+		*/
+        void close();
+    };
+}
+
+#endif
@@ -0,0 +1,600 @@
+#include "stmt_result_set.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace zdb{
+    const unsigned long MAX_INIT_STRING_BUF = 1024;     // 字符串列初始缓冲区上限, 更长的值按行扩大
+
+    stmt_result_set::stmt_result_set()
+    {
+        m_stmt = 0;
+        m_field_count = 0;
+        m_has_row = false;
+    }
+
+    stmt_result_set::~stmt_result_set()
+    {
+        close();
+    }
+
+    bool stmt_result_set::bind(MYSQL_STMT* stmt, std::string& error)
+    {
+        close();
+
+        if(0 == stmt){
+            error = "bind error, stmt = null";
+            return false;
+        }
+
+        MYSQL_RES* meta = mysql_stmt_result_metadata(stmt);
+        if(0 == meta){
+            error = "failed to call mysql_stmt_result_metadata, last_error=";
+            error += mysql_stmt_error(stmt);
+            return false;
+        }
+
+        m_stmt = stmt;
+        m_field_count = mysql_num_fields(meta);
+        m_columns.resize(m_field_count);
+        m_binds.resize(m_field_count);
+        memset(m_binds.data(), 0, m_binds.size() * sizeof(MYSQL_BIND));
+
+        for(int i = 0; i < m_field_count; ++i){
+            MYSQL_FIELD* ptr_field = mysql_fetch_field_direct(meta, i);
+            column& col = m_columns[i];
+            MYSQL_BIND& b = m_binds[i];
+
+            col.m_unsigned = (ptr_field->flags & UNSIGNED_FLAG) != 0;
+            col.m_int = 0;
+            col.m_double = 0;
+            db_helper::instance().init_mysql_time(col.m_time);
+            col.m_length = 0;
+            col.m_is_null = 0;
+            col.m_error = 0;
+
+            switch(ptr_field->type){
+                case MYSQL_TYPE_TINY:
+                case MYSQL_TYPE_SHORT:
+                case MYSQL_TYPE_INT24:
+                case MYSQL_TYPE_LONG:
+                case MYSQL_TYPE_LONGLONG:
+                case MYSQL_TYPE_YEAR:
+                    col.m_type = MYSQL_TYPE_LONGLONG;
+                    b.buffer = &col.m_int;
+                    b.is_unsigned = col.m_unsigned;
+                    break;
+                case MYSQL_TYPE_FLOAT:
+                case MYSQL_TYPE_DOUBLE:
+                    col.m_type = MYSQL_TYPE_DOUBLE;
+                    b.buffer = &col.m_double;
+                    break;
+                case MYSQL_TYPE_DATE:
+                case MYSQL_TYPE_TIME:
+                case MYSQL_TYPE_DATETIME:
+                case MYSQL_TYPE_TIMESTAMP:
+                    col.m_type = ptr_field->type;
+                    b.buffer = &col.m_time;
+                    break;
+                default:
+                    col.m_type = MYSQL_TYPE_STRING;
+                    col.m_buf.resize(((ptr_field->length < MAX_INIT_STRING_BUF)?ptr_field->length:MAX_INIT_STRING_BUF) + 1);
+                    b.buffer = col.m_buf.data();
+                    b.buffer_length = (unsigned long)col.m_buf.size();
+                    break;
+            }
+
+            b.buffer_type = col.m_type;
+            b.length = &col.m_length;
+            b.is_null = &col.m_is_null;
+            b.error = &col.m_error;
+        }
+
+        // 元数据在此之后释放, 因此在绑定时获取索引; 缓存命中时不需要构建
+        m_field_index = field_index_cache::instance().acquire(mysql_fetch_fields(meta), m_field_count);
+        mysql_free_result(meta);
+
+        if(m_field_count > 0 && mysql_stmt_bind_result(m_stmt, m_binds.data()) != 0){
+            error = "failed to call mysql_stmt_bind_result, last_error=";
+            error += mysql_stmt_error(m_stmt);
+            close();
+            return false;
+        }
+
+        return true;
+    }
+
+    void stmt_result_set::close()
+    {
+        if(0 == m_stmt){
+            return;
+        }
+
+        mysql_stmt_free_result(m_stmt);
+        m_stmt = 0;
+        m_has_row = false;
+        m_field_count = 0;
+        m_columns.clear();
+        m_binds.clear();
+        m_field_index.reset();
+    }
+
+    bool stmt_result_set::seek(my_ulonglong offset, std::string& error)
+    {
+        if(0 == m_stmt){
+            error = "stmt_result_set::m_stmt is not initialized.";
+            return false;
+        }
+
+        mysql_stmt_data_seek(m_stmt, offset);
+
+        return true;
+    }
+
+    bool stmt_result_set::fetch_truncated(int idx, std::string& error)
+    {
+        column& col = m_columns[idx];
+        MYSQL_BIND& b = m_binds[idx];
+
+        col.m_buf.resize(col.m_length + 1);
+        b.buffer = col.m_buf.data();
+        b.buffer_length = (unsigned long)col.m_buf.size();
+
+        if(mysql_stmt_fetch_column(m_stmt, &b, idx, 0) != 0){
+            error = "failed to call mysql_stmt_fetch_column, last_error=";
+            error += mysql_stmt_error(m_stmt);
+            return false;
+        }
+
+        return true;
+    }
+
+    bool stmt_result_set::get_next_record(std::string& error)
+    {
+        m_has_row = false;
+
+        if(0 == m_stmt){
+            error = "m_stmt is not initialized.";
+            return false;
+        }
+
+        int ret = mysql_stmt_fetch(m_stmt);
+        if(MYSQL_NO_DATA == ret){
+            error = "failed to call mysql_stmt_fetch, no more rows.";
+            return false;
+        }
+
+        if(ret != 0 && MYSQL_DATA_TRUNCATED != ret){
+            error = "failed to call mysql_stmt_fetch, last_error=";
+            error += mysql_stmt_error(m_stmt);
+            return false;
+        }
+
+        if(MYSQL_DATA_TRUNCATED == ret){
+            // 缓冲区扩大后重新绑定, 之后的行直接复用
+            bool rebind = false;
+            for(int i = 0; i < m_field_count; ++i){
+                column& col = m_columns[i];
+                if(col.m_type == MYSQL_TYPE_STRING && !col.m_is_null && col.m_length >= col.m_buf.size()){
+                    if(!fetch_truncated(i, error)){
+                        return false;
+                    }
+                    rebind = true;
+                }
+            }
+
+            if(rebind && mysql_stmt_bind_result(m_stmt, m_binds.data()) != 0){
+                error = "failed to call mysql_stmt_bind_result, last_error=";
+                error += mysql_stmt_error(m_stmt);
+                return false;
+            }
+        }
+
+        m_has_row = true;
+
+        return true;
+    }
+
+    my_ulonglong stmt_result_set::get_record_count(std::string& error)
+    {
+        if(0 == m_stmt){
+            error = "m_stmt is not initialized.";
+            return 0;
+        }
+
+        return mysql_stmt_num_rows(m_stmt);
+    }
+
+    bool stmt_result_set::get_column(int idx, column*& col, bool& is_null, std::string& error)
+    {
+        is_null = false;
+
+        if(!m_has_row){
+            error = "current row is not fetched.";
+            return false;
+        }
+
+        if(idx < 0 || idx >= m_field_count){
+            error = "idx is invalid.";
+            return false;
+        }
+
+        col = &m_columns[idx];
+        is_null = col->m_is_null?true:false;
+
+        return true;
+    }
+
+    bool stmt_result_set::get_integer(int idx, long long& sval, unsigned long long& uval, bool& is_unsigned, std::string& error)
+    {
+        sval = 0;
+        uval = 0;
+        is_unsigned = false;
+        column* col = 0;
+        bool is_null = false;
+
+        if(!get_column(idx, col, is_null, error)){
+            return false;
+        }
+
+        if(is_null){
+            return true;
+        }
+
+        switch(col->m_type){
+            case MYSQL_TYPE_LONGLONG:
+                is_unsigned = col->m_unsigned;
+                if(is_unsigned){
+                    uval = (unsigned long long)col->m_int;
+                }else{
+                    sval = col->m_int;
+                }
+                break;
+            case MYSQL_TYPE_DOUBLE:
+                // 2^64和2^63在double中精确表示, 取整前比较
+                if(col->m_double >= 0 && col->m_double < 18446744073709551616.0){
+                    is_unsigned = true;
+                    uval = (unsigned long long)col->m_double;
+                }else if(col->m_double < 0 && col->m_double >= -9223372036854775808.0){
+                    sval = (long long)col->m_double;
+                }else{
+                    error = "field value is out of the integer range.";
+                    return false;
+                }
+                break;
+            case MYSQL_TYPE_STRING:
+                col->m_buf[col->m_length] = 0;
+                errno = 0;
+                is_unsigned = col->m_unsigned;
+                if(is_unsigned){
+                    uval = strtoull(col->m_buf.data(), 0, 10);
+                }else{
+                    sval = strtoll(col->m_buf.data(), 0, 10);
+                }
+                if(ERANGE == errno){
+                    error = "field value is out of the integer range.";
+                    return false;
+                }
+                break;
+            default:
+                error = "field type can not be converted to integer.";
+                return false;
+        }
+
+        return true;
+    }
+
+    bool stmt_result_set::get_int64(int idx, long long min, long long max, long long& val, std::string& error)
+    {
+        val = 0;
+        long long sval = 0;
+        unsigned long long uval = 0;
+        bool is_unsigned = false;
+        if(!get_integer(idx, sval, uval, is_unsigned, error)){
+            return false;
+        }
+
+        if((is_unsigned && uval > (unsigned long long)max) || (!is_unsigned && (sval < min || sval > max))){
+            error = "field value does not fit the requested integer type.";
+            return false;
+        }
+
+        val = is_unsigned?(long long)uval:sval;
+
+        return true;
+    }
+
+    bool stmt_result_set::get_double(int idx, double& val, std::string& error)
+    {
+        val = 0;
+        column* col = 0;
+        bool is_null = false;
+
+        if(!get_column(idx, col, is_null, error)){
+            return false;
+        }
+
+        if(is_null){
+            return true;
+        }
+
+        switch(col->m_type){
+            case MYSQL_TYPE_LONGLONG:
+                val = col->m_unsigned?(double)(unsigned long long)col->m_int:(double)col->m_int;
+                break;
+            case MYSQL_TYPE_DOUBLE:
+                val = col->m_double;
+                break;
+            case MYSQL_TYPE_STRING:
+                col->m_buf[col->m_length] = 0;
+                val = strtod(col->m_buf.data(), 0);
+                break;
+            default:
+                error = "field type can not be converted to double.";
+                return false;
+        }
+
+        return true;
+    }
+
+    bool stmt_result_set::get_field(int idx, int& val, std::string& error)
+    {
+        long long tmp = 0;
+        bool ret = get_int64(idx, INT_MIN, INT_MAX, tmp, error);
+        val = (int)tmp;
+
+        return ret;
+    }
+
+    bool stmt_result_set::get_field(int idx, unsigned int& val, std::string& error)
+    {
+        long long tmp = 0;
+        bool ret = get_int64(idx, 0, UINT_MAX, tmp, error);
+        val = (unsigned int)tmp;
+
+        return ret;
+    }
+
+    bool stmt_result_set::get_field(int idx, long long& val, std::string& error)
+    {
+        return get_int64(idx, LLONG_MIN, LLONG_MAX, val, error);
+    }
+
+    bool stmt_result_set::get_field(int idx, unsigned long long& val, std::string& error)
+    {
+        val = 0;
+        long long sval = 0;
+        bool is_unsigned = false;
+        if(!get_integer(idx, sval, val, is_unsigned, error)){
+            return false;
+        }
+
+        if(!is_unsigned){
+            if(sval < 0){
+                error = "field value does not fit the requested integer type.";
+                return false;
+            }
+            val = (unsigned long long)sval;
+        }
+
+        return true;
+    }
+
+    bool stmt_result_set::get_field(int idx, std::string& val, std::string& error)
+    {
+        val = "";
+        column* col = 0;
+        bool is_null = false;
+
+        if(!get_column(idx, col, is_null, error)){
+            return false;
+        }
+
+        if(is_null){
+            return true;
+        }
+
+        char buf[64] = {0};
+        switch(col->m_type){
+            case MYSQL_TYPE_LONGLONG:
+                if(col->m_unsigned){
+                    snprintf(buf, sizeof(buf), "%llu", (unsigned long long)col->m_int);
+                }else{
+                    snprintf(buf, sizeof(buf), "%lld", col->m_int);
+                }
+                val = buf;
+                break;
+            case MYSQL_TYPE_DOUBLE:
+                snprintf(buf, sizeof(buf), "%.17g", col->m_double);
+                val = buf;
+                break;
+            case MYSQL_TYPE_STRING:
+                val.assign(col->m_buf.data(), col->m_length);
+                break;
+            default:
+                db_helper::instance().to_string(col->m_time, buf, sizeof(buf));
+                val = buf;
+                break;
+        }
+
+        return true;
+    }
+
+    bool stmt_result_set::get_field(int idx, char* val, int len, std::string& error)
+    {
+        if(len <= 0){
+            error = "len is invalid.";
+            return false;
+        }
+
+        memset(val, 0, len);
+
+        std::string tmp;
+        if(!get_field(idx, tmp, error)){
+            return false;
+        }
+
+        size_t n = (tmp.size() < (size_t)len - 1)?tmp.size():(size_t)len - 1;
+        memcpy(val, tmp.data(), n);
+
+        return true;
+    }
+
+    bool stmt_result_set::get_field(int idx, bool& val, std::string& error)
+    {
+        long long sval = 0;
+        unsigned long long uval = 0;
+        bool is_unsigned = false;
+        bool ret = get_integer(idx, sval, uval, is_unsigned, error);
+        val = is_unsigned?(uval == 1):(sval == 1);
+
+        return ret;
+    }
+
+    bool stmt_result_set::get_field(int idx, float& val, std::string& error)
+    {
+        double tmp = 0;
+        bool ret = get_double(idx, tmp, error);
+        val = (float)tmp;
+
+        return ret;
+    }
+
+    bool stmt_result_set::get_field(int idx, double& val, std::string& error)
+    {
+        return get_double(idx, val, error);
+    }
+
+    bool stmt_result_set::get_field(int idx, MYSQL_TIME& val, std::string& error)
+    {
+        db_helper::instance().init_mysql_time(val);
+        column* col = 0;
+        bool is_null = false;
+
+        if(!get_column(idx, col, is_null, error)){
+            return false;
+        }
+
+        if(is_null){
+            return true;
+        }
+
+        switch(col->m_type){
+            case MYSQL_TYPE_DATE:
+            case MYSQL_TYPE_TIME:
+            case MYSQL_TYPE_DATETIME:
+            case MYSQL_TYPE_TIMESTAMP:
+                val = col->m_time;
+                break;
+            case MYSQL_TYPE_STRING:
+                db_helper::instance().to_datetime(col->m_buf.data(), col->m_length, val);
+                break;
+            default:
+                error = "field type can not be converted to MYSQL_TIME.";
+                return false;
+        }
+
+        return true;
+    }
+
+    int stmt_result_set::get_field_idx_by_name(const char* name, std::string& error)
+    {
+        return get_field_idx_by_name(std::string_view(name?name:""), error);
+    }
+
+    int stmt_result_set::get_field_idx_by_name(std::string_view name, std::string& error)
+    {
+        int idx = m_field_index?m_field_index->find(name):-1;
+        if(idx < 0){
+            error = "failed to find field: ";
+            error += name;
+            return -1;
+        }
+
+        return idx;
+    }
+
+    bool stmt_result_set::get_field(const char* name, int& val, std::string& error)
+    {
+        int idx = get_field_idx_by_name(name, error);
+
+        return (idx >= 0)?get_field(idx, val, error):false;
+    }
+
+    bool stmt_result_set::get_field(const char* name, unsigned int& val, std::string& error)
+    {
+        int idx = get_field_idx_by_name(name, error);
+
+        return (idx >= 0)?get_field(idx, val, error):false;
+    }
+
+    bool stmt_result_set::get_field(const char* name, long long& val, std::string& error)
+    {
+        int idx = get_field_idx_by_name(name, error);
+
+        return (idx >= 0)?get_field(idx, val, error):false;
+    }
+
+    bool stmt_result_set::get_field(const char* name, unsigned long long& val, std::string& error)
+    {
+        int idx = get_field_idx_by_name(name, error);
+
+        return (idx >= 0)?get_field(idx, val, error):false;
+    }
+
+    bool stmt_result_set::get_field(const char* name, std::string& val, std::string& error)
+    {
+        int idx = get_field_idx_by_name(name, error);
+
+        return (idx >= 0)?get_field(idx, val, error):false;
+    }
+
+    bool stmt_result_set::get_field(const char* name, char* val, int len, std::string& error)
+    {
+        int idx = get_field_idx_by_name(name, error);
+
+        return (idx >= 0)?get_field(idx, val, len, error):false;
+    }
+
+    bool stmt_result_set::get_field(const char* name, bool& val, std::string& error)
+    {
+        int idx = get_field_idx_by_name(name, error);
+
+        return (idx >= 0)?get_field(idx, val, error):false;
+    }
+
+    bool stmt_result_set::get_field(const char* name, float& val, std::string& error)
+    {
+        int idx = get_field_idx_by_name(name, error);
+
+        return (idx >= 0)?get_field(idx, val, error):false;
+    }
+
+    bool stmt_result_set::get_field(const char* name, double& val, std::string& error)
+    {
+        int idx = get_field_idx_by_name(name, error);
+
+        return (idx >= 0)?get_field(idx, val, error):false;
+    }
+
+    bool stmt_result_set::get_field(const char* name, MYSQL_TIME& val, std::string& error)
+    {
+        int idx = get_field_idx_by_name(name, error);
+
+        return (idx >= 0)?get_field(idx, val, error):false;
+    }
+
+    int stmt_result_set::is_null(int idx, std::string& error)
+    {
+        column* col = 0;
+        bool is_null = false;
+
+        if(!get_column(idx, col, is_null, error)){
+            return -1;
+        }
+
+        return is_null?1:0;
+    }
+}
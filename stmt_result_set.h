@@ -0,0 +1,488 @@
+/*
+* @file
+    stmt_result_set.h
+
+* @brief
+    二进制协议结果集类
+
+* @version
+    V1.0
+
+* @author
+    agent
+
+* @date
+    2026/10/19
+
+* @note
+    基于mysql_stmt_bind_result/mysql_stmt_fetch, 整数、浮点和时间字段以原生类型
+    直接写入可复用的绑定缓冲区, 不经过文本解析; 提供与result_set相同的get_field接口。
+    整数列统一按64位(按字段的UNSIGNED_FLAG决定有无符号)读取, 不丢失精度。
+
+* @warning
+    结果集属于stmt, 同一stmt再次执行或关闭后失效
+* @bug
+* @copyright
+*/
+#ifndef zdb_stmt_result_set_h
+#define zdb_stmt_result_set_h
+#include <mysql.h>
+#include <string>
+#include <vector>
+#include <string_view>
+#include "common.h"
+#include "helper.h"
+#include "field_index.h"
+#include "stmt_binder.h"
+
+namespace zdb{
+    class stmt_result_set{
+        private:
+        struct column{
+            enum_field_types m_type;    // 绑定的缓冲区类型
+            bool m_unsigned;            // 是否无符号整数
+            long long m_int;            // 整数缓冲区
+            double m_double;            // 浮点缓冲区
+            MYSQL_TIME m_time;          // 时间缓冲区
+            std::vector<char> m_buf;    // 字符串缓冲区
+            unsigned long m_length;     // 实际长度
+            bind_flag m_is_null;        // 是否为NULL
+            bind_flag m_error;          // 是否截断
+        };
+
+        MYSQL_STMT* m_stmt;                 // 已执行的stmt
+        std::vector<column> m_columns;      // 列缓冲区, 绑定后不可再改变大小
+        std::vector<MYSQL_BIND> m_binds;    // 结果绑定
+        int m_field_count;                  // 字段个数
+        bool m_has_row;                     // 是否已读取到当前行
+        ptr_field_index m_field_index;      // 字段名-字段下标
+
+        private:
+        /*
+		* @brief
+		    把字符串列的缓冲区扩大到当前行的实际长度并补取数据函数。
+		* @param  [in]  int idx             字段下标\n
+		* @param  [out] std::string& error  错误信息\n
+		* @return 返回是否成功
+		* @note
+		* @warning
+		* @bug
+		*/
+        bool fetch_truncated(int idx, std::string& error);
+        /*
+		* @brief
+		    获得当前行字段缓冲区函数。
+		* @param  [in]  int idx             字段下标\n
+		* @param  [out] column*& col        字段缓冲区\n
+		* @param  [out] bool& is_null       是否为空\n
+		* @param  [out] std::string& error  错误信息\n
+		* @return 返回获得字段是否成功
+		* @note
+		* @warning
+		* @bug
+		*/
+        bool get_column(int idx, column*& col, bool& is_null, std::string& error);
+        /*
+		* @brief
+		    以整数读取字段函数, 字符串列(如DECIMAL)按文本解析。
+		* @param    [out] long long& sval               有符号值\n
+		* @param    [out] unsigned long long& uval      无符号值\n
+		* @param    [out] bool& is_unsigned             为true时值在uval中, 否则在sval中\n
+		* @note     NULL读为0; 超出64位整数范围时失败
+		* @warning
+		* @bug
+		*/
+        bool get_integer(int idx, long long& sval, unsigned long long& uval, bool& is_unsigned, std::string& error);
+        /*
+		* @brief
+		    以64位有符号整数/浮点读取字段函数。
+		* @param    [in]  long long min     请求类型的最小值\n
+		* @param    [in]  long long max     请求类型的最大值\n
+		* @note     NULL读为0; 整数值不在[min, max]内时失败
+		* @warning
+		* @bug
+		*/
+        bool get_int64(int idx, long long min, long long max, long long& val, std::string& error);
+        bool get_double(int idx, double& val, std::string& error);
+
+        public:
+        stmt_result_set();
+        ~stmt_result_set();
+
+        stmt_result_set(const stmt_result_set&) = delete;
+        stmt_result_set& operator=(const stmt_result_set&) = delete;
+
+        /*
+        * @brief
+	        绑定到已执行并mysql_stmt_store_result的stmt函数。
+	    * @param  [in]  MYSQL_STMT* stmt    stmt\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回绑定是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool bind(MYSQL_STMT* stmt, std::string& error);
+        /*
+	    * @brief
+	        查找数据函数。
+	    * @param  [in] my_ulonglong offset  偏移量\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回查找数据是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool seek(my_ulonglong offset, std::string& error);
+        /*
+	    * @brief
+	        获得下一条记录函数。
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回获得下一条记录是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool get_next_record(std::string& error);
+        /*
+	    * @brief
+	        获得记录数函数。
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回获得的记录数
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        my_ulonglong get_record_count(std::string& error);
+
+        /*
+	    * @brief
+	        获得int字段值函数。
+	    * @param  [in]  int idx             字段下标\n
+	    * @param  [out] int& val            获得的字段值\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回获得字段值是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool get_field(int idx, int& val, std::string& error);
+        /*
+	    * @brief
+	        获得unsigned int字段值函数。
+	    * @param  [in]  int idx             字段下标\n
+	    * @param  [out] unsigned int& val   获得的字段值\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回获得字段值是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool get_field(int idx, unsigned int& val, std::string& error);
+        /*
+	    * @brief
+	        获得long long字段值函数。
+	    * @param  [in]  int idx             字段下标\n
+	    * @param  [out] long long& val      获得的字段值\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回获得字段值是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool get_field(int idx, long long& val, std::string& error);
+        /*
+	    * @brief
+	        获得unsigned long long字段值函数。
+	    * @param  [in]  int idx             字段下标\n
+	    * @param  [out] unsigned long long& val 获得的字段值\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回获得字段值是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool get_field(int idx, unsigned long long& val, std::string& error);
+        /*
+	    * @brief
+	        获得string字段值函数。
+	    * @param  [in]  int idx             字段下标\n
+	    * @param  [out] std::string& val    获得的字段值\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回获得字段值是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool get_field(int idx, std::string& val, std::string& error);
+        /*
+	    * @brief
+	        获得char*字段值函数。
+	    * @param  [in]  int idx             字段下标\n
+	    * @param  [out] char* val           获得的字段值\n
+	    * @param  [in]  int len             value的最大长度\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回获得字段值是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool get_field(int idx, char* val, int len, std::string& error);
+        /*
+	    * @brief
+	        获得bool字段值函数。
+	    * @param  [in]  int idx             字段下标\n
+	    * @param  [out] bool& val           获得的字段值\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回获得字段值是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool get_field(int idx, bool& val, std::string& error);
+        /*
+	    * @brief
+	        获得float字段值函数。
+	    * @param  [in]  int idx             字段下标\n
+	    * @param  [out] float& val          获得的字段值\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回获得字段值是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool get_field(int idx, float& val, std::string& error);
+        /*
+	    * @brief
+	        获得double字段值函数。
+	    * @param  [in]  int idx             字段下标\n
+	    * @param  [out] double& val         获得的字段值\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回获得字段值是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool get_field(int idx, double& val, std::string& error);
+        /*
+	    * @brief
+	        获得MYSQL_TIME字段值函数。
+	    * @param  [in]  int idx             字段下标\n
+	    * @param  [out] MYSQL_TIME& val     获得的字段值\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回获得字段值是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool get_field(int idx, MYSQL_TIME& val, std::string& error);
+
+        /*
+	    * @brief
+	        根据字段名获得字段下标函数。
+	    * @param  [in] const char* name  字段名\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回获得的字段下标
+	    * @return  >=0  成功\n
+	    * @return  -1  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        int get_field_idx_by_name(const char* name, std::string& error);
+        int get_field_idx_by_name(std::string_view name, std::string& error);
+        /*
+	    * @brief
+	        根据字段名获得int字段值函数。
+	    * @param  [in]  const char* name    字段名\n
+	    * @param  [out] int& val            获得的字段值\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回获得字段值是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool get_field(const char* name, int& val, std::string& error);
+        /*
+	    * @brief
+	        根据字段名获得unsigned int字段值函数。
+	    * @param  [in]  const char* name    字段名\n
+	    * @param  [out] unsigned int& val   获得的字段值\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回获得字段值是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool get_field(const char* name, unsigned int& val, std::string& error);
+        /*
+	    * @brief
+	        根据字段名获得long long字段值函数。
+	    * @param  [in]  const char* name    字段名\n
+	    * @param  [out] long long& val      获得的字段值\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回获得字段值是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool get_field(const char* name, long long& val, std::string& error);
+        /*
+	    * @brief
+	        根据字段名获得unsigned long long字段值函数。
+	    * @param  [in]  const char* name    字段名\n
+	    * @param  [out] unsigned long long& val 获得的字段值\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回获得字段值是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool get_field(const char* name, unsigned long long& val, std::string& error);
+        /*
+	    * @brief
+	        根据字段名获得string字段值函数。
+	    * @param  [in]  const char* name    字段名\n
+	    * @param  [out] std::string& val    获得的字段值\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回获得字段值是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool get_field(const char* name, std::string& val, std::string& error);
+        /*
+	    * @brief
+	        根据字段名获得char*字段值函数。
+	    * @param  [in]  const char* name    字段名\n
+	    * @param  [out] char* val           获得的字段值\n
+	    * @param  [in]  int len             value的最大长度\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回获得字段值是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool get_field(const char* name, char* val, int len, std::string& error);
+        /*
+	    * @brief
+	        根据字段名获得bool字段值函数。
+	    * @param  [in]  const char* name    字段名\n
+	    * @param  [out] bool& val           获得的字段值\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回获得字段值是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool get_field(const char* name, bool& val, std::string& error);
+        /*
+	    * @brief
+	        根据字段名获得float字段值函数。
+	    * @param  [in]  const char* name    字段名\n
+	    * @param  [out] float& val          获得的字段值\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回获得字段值是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool get_field(const char* name, float& val, std::string& error);
+        /*
+	    * @brief
+	        根据字段名获得double字段值函数。
+	    * @param  [in]  const char* name    字段名\n
+	    * @param  [out] double& val         获得的字段值\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回获得字段值是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool get_field(const char* name, double& val, std::string& error);
+        /*
+	    * @brief
+	        根据字段名获得MYSQL_TIME字段值函数。
+	    * @param  [in]  const char* name    字段名\n
+	    * @param  [out] MYSQL_TIME& val     获得的字段值\n
+	    * @param  [out] std::string& error  错误信息\n
+	    * @return 返回获得字段值是否成功
+	    * @return  true  成功\n
+	    * @return  false  失败\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        bool get_field(const char* name, MYSQL_TIME& val, std::string& error);
+        /*
+		* @brief
+		    判断字段是否为空函数。
+		* @param  [in]  int idx             字段下标\n
+		* @param  [out] std::string& error  错误信息\n
+		* @return 返回字段是否为空
+		* @return  1  为空\n
+		* @return  0  不为空\n
+		* @return  -1  有错误\n
+		* @note
+		* @warning
+		* @bug
+		*/
+        int is_null(int idx, std::string& error);
+        /*
+	    * @brief
+	        关闭函数。
+	    * @param  无\n
+	    * @return 无\n
+	    * @note
+	    * @warning
+	    * @bug
+	    */
+        void close();
+    };
+}
+
+#endif
@@ -0,0 +1,292 @@
+#include "text_decoder.h"
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#if defined(__SSE4_1__) || defined(__AVX2__)
+#include <smmintrin.h>
+#define ZDB_SIMD_DECODE 1
+#define ZDB_SIMD_TARGET
+#define ZDB_SIMD_ENTRY
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+// 编译选项未开启SSE4.1时只对SIMD实现开启, 运行时按CPU选择; flatten使整个解码循环在SSE4.1下内联
+#include <smmintrin.h>
+#define ZDB_SIMD_DECODE 1
+#define ZDB_SIMD_DISPATCH 1
+#define ZDB_SIMD_TARGET __attribute__((target("sse4.1")))
+#define ZDB_SIMD_ENTRY __attribute__((target("sse4.1"), flatten))
+#endif
+
+namespace zdb{
+    static const uint64_t pow10_u64[] = {
+        1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+        1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+        100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+        1000000000000000000ULL, 10000000000000000000ULL
+    };
+
+    static const double pow10_f64[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    static inline bool is_digit(char c)
+    {
+        return (unsigned char)(c - '0') <= 9;
+    }
+
+    static inline bool parse_digits_scalar(const char* p, size_t len, uint64_t& val)
+    {
+        uint64_t v = 0;
+        for(size_t i = 0; i < len; ++i){
+            if(!is_digit(p[i])){
+                return false;
+            }
+            v = v * 10 + (uint64_t)(p[i] - '0');
+        }
+
+        val = v;
+        return true;
+    }
+
+#ifdef ZDB_SIMD_DECODE
+    // 解析1~16位纯数字
+    ZDB_SIMD_TARGET static inline bool parse_digits16_simd(const char* p, size_t len, uint64_t& val)
+    {
+        __m128i v;
+        // 只读字段内的字节: 不足16位时右对齐拷贝, 前面补'0'
+        if(16 == len){
+            v = _mm_loadu_si128((const __m128i*)p);
+        }else{
+            char buf[16];
+            memset(buf, '0', sizeof(buf));
+            memcpy(buf + 16 - len, p, len);
+            v = _mm_loadu_si128((const __m128i*)buf);
+        }
+
+        v = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+
+        __m128i bad = _mm_or_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(9)), _mm_cmplt_epi8(v, _mm_setzero_si128()));
+        if(_mm_movemask_epi8(bad)){
+            return false;
+        }
+
+        v = _mm_maddubs_epi16(v, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1));
+        v = _mm_madd_epi16(v, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+        v = _mm_packus_epi32(v, v);
+        v = _mm_madd_epi16(v, _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+
+        uint64_t hi = (uint32_t)_mm_cvtsi128_si32(v);
+        uint64_t lo = (uint32_t)_mm_extract_epi32(v, 1);
+        val = hi * 100000000ULL + lo;
+
+        return true;
+    }
+#endif
+
+    // 解析不超过19位的纯数字
+    template<bool Simd>
+    static inline bool parse_digits(const char* p, size_t len, uint64_t& val)
+    {
+#ifdef ZDB_SIMD_DECODE
+        if constexpr(Simd){
+            if(len <= 16){
+                return parse_digits16_simd(p, len, val);
+            }
+
+            uint64_t head = 0;
+            uint64_t tail = 0;
+            if(!parse_digits_scalar(p, len - 16, head) || !parse_digits16_simd(p + len - 16, 16, tail)){
+                return false;
+            }
+
+            val = head * pow10_u64[16] + tail;
+            return true;
+        }
+#endif
+        return parse_digits_scalar(p, len, val);
+    }
+
+    template<bool Simd>
+    static inline uint8_t decode_one_int64(const char* p, size_t len, int64_t& out)
+    {
+        out = 0;
+
+        bool neg = false;
+        if(len > 0 && (*p == '-' || *p == '+')){
+            neg = (*p == '-');
+            ++p;
+            --len;
+        }
+
+        if(0 == len){
+            return decode_invalid;
+        }
+
+        while(len > 1 && *p == '0'){
+            ++p;
+            --len;
+        }
+
+        if(len > 19){
+            for(size_t i = 0; i < len; ++i){
+                if(!is_digit(p[i])){
+                    return decode_invalid;
+                }
+            }
+            out = neg?INT64_MIN:INT64_MAX;
+            return decode_overflow;
+        }
+
+        uint64_t val = 0;
+        if(!parse_digits<Simd>(p, len, val)){
+            return decode_invalid;
+        }
+
+        uint64_t limit = neg?(uint64_t)INT64_MAX + 1:(uint64_t)INT64_MAX;
+        if(val > limit){
+            out = neg?INT64_MIN:INT64_MAX;
+            return decode_overflow;
+        }
+
+        out = neg?(int64_t)(0 - val):(int64_t)val;
+
+        return decode_ok;
+    }
+
+    template<bool Simd>
+    static inline uint8_t decode_one_double(const char* p, size_t len, double& out)
+    {
+        // 快速路径: [-]digits[.digits], 有效数字可精确表示且10的幂不超过22
+        const char* s = p;
+        size_t n = len;
+        bool neg = false;
+        if(n > 0 && (*s == '-' || *s == '+')){
+            neg = (*s == '-');
+            ++s;
+            --n;
+        }
+
+        while(n > 1 && *s == '0' && s[1] != '.'){
+            ++s;
+            --n;
+        }
+
+        const char* dot = (const char*)memchr(s, '.', n);
+        size_t int_len = dot?(size_t)(dot - s):n;
+        size_t frac_len = dot?n - int_len - 1:0;
+
+        if(int_len + frac_len > 0 && int_len + frac_len <= 19 && frac_len <= 22){
+            uint64_t int_part = 0;
+            uint64_t frac_part = 0;
+            if((0 == int_len || parse_digits<Simd>(s, int_len, int_part)) && (0 == frac_len || parse_digits<Simd>(dot + 1, frac_len, frac_part))){
+                uint64_t mantissa = int_part * pow10_u64[frac_len] + frac_part;
+                if(mantissa <= (1ULL << 53)){
+                    double v = (double)mantissa / pow10_f64[frac_len];
+                    out = neg?-v:v;
+                    return decode_ok;
+                }
+            }
+        }
+
+        char* end = 0;
+        errno = 0;
+        out = strtod(p, &end);
+        if(end == p || (size_t)(end - p) != len){
+            out = 0;
+            return decode_invalid;
+        }
+
+        if(ERANGE == errno){
+            return decode_overflow;
+        }
+
+        return decode_ok;
+    }
+
+    template<bool Simd>
+    static inline size_t decode_int64_loop(const char* const* vals, const unsigned long* lens, size_t count, int64_t* out, uint8_t* status)
+    {
+        size_t failed = 0;
+
+        for(size_t i = 0; i < count; ++i){
+            uint8_t st = decode_null;
+            if(vals[i]){
+                st = decode_one_int64<Simd>(vals[i], lens[i], out[i]);
+            }else{
+                out[i] = 0;
+            }
+
+            failed += (st != decode_ok);
+            if(status){
+                status[i] = st;
+            }
+        }
+
+        return failed;
+    }
+
+    template<bool Simd>
+    static inline size_t decode_double_loop(const char* const* vals, const unsigned long* lens, size_t count, double* out, uint8_t* status)
+    {
+        size_t failed = 0;
+
+        for(size_t i = 0; i < count; ++i){
+            uint8_t st = decode_null;
+            if(vals[i]){
+                st = decode_one_double<Simd>(vals[i], lens[i], out[i]);
+            }else{
+                out[i] = 0;
+            }
+
+            failed += (st != decode_ok);
+            if(status){
+                status[i] = st;
+            }
+        }
+
+        return failed;
+    }
+
+#ifdef ZDB_SIMD_DECODE
+    ZDB_SIMD_ENTRY static size_t decode_int64_simd(const char* const* vals, const unsigned long* lens, size_t count, int64_t* out, uint8_t* status)
+    {
+        return decode_int64_loop<true>(vals, lens, count, out, status);
+    }
+
+    ZDB_SIMD_ENTRY static size_t decode_double_simd(const char* const* vals, const unsigned long* lens, size_t count, double* out, uint8_t* status)
+    {
+        return decode_double_loop<true>(vals, lens, count, out, status);
+    }
+
+    static bool has_simd()
+    {
+#ifdef ZDB_SIMD_DISPATCH
+        static const bool supported = __builtin_cpu_supports("sse4.1");
+        return supported;
+#else
+        return true;
+#endif
+    }
+#endif
+
+    size_t decode_int64(const char* const* vals, const unsigned long* lens, size_t count, int64_t* out, uint8_t* status)
+    {
+#ifdef ZDB_SIMD_DECODE
+        if(has_simd()){
+            return decode_int64_simd(vals, lens, count, out, status);
+        }
+#endif
+        return decode_int64_loop<false>(vals, lens, count, out, status);
+    }
+
+    size_t decode_double(const char* const* vals, const unsigned long* lens, size_t count, double* out, uint8_t* status)
+    {
+#ifdef ZDB_SIMD_DECODE
+        if(has_simd()){
+            return decode_double_simd(vals, lens, count, out, status);
+        }
+#endif
+        return decode_double_loop<false>(vals, lens, count, out, status);
+    }
+}
@@ -0,0 +1,70 @@
+/*
+* @file
+    text_decoder.h
+
+* @brief
+    文本协议数值列批量解码
+
+* @version
+    V1.0
+
+* @author
+    agent
+
+* @date
+    2026/10/19
+
+* @note
+    按列一次解码多行文本数值, 写入调用者提供的数组并逐行给出状态。
+    x86上用SSE4.1一次解析16位数字: 编译选项已开启时直接使用, GCC/Clang未开启时运行时检测CPU后选择,
+    其他平台使用标量实现;
+    浮点数在尾数和指数都可精确表示时走快速路径, 其余交给strtod。
+
+* @warning
+* @bug
+* @copyright
+*/
+#ifndef zdb_text_decoder_h
+#define zdb_text_decoder_h
+#include <stddef.h>
+#include <stdint.h>
+
+namespace zdb{
+    const size_t TEXT_DECODE_CHUNK = 256;   // 逐行读取结果集时每批解码的行数
+
+    enum decode_status{
+        decode_ok       = 0,    // 成功
+        decode_null     = 1,    // 字段为NULL, 值为0
+        decode_overflow = 2,    // 超出范围, 值被截断到最大/最小值
+        decode_invalid  = 3,    // 不是合法数值, 值为0
+    };
+
+    /*
+	* @brief    批量解码64位整数函数。
+	* @param    [in]  const char* const* vals     文本值指针, NULL表示字段为NULL\n
+	* @param    [in]  const unsigned long* lens   文本长度(mysql_fetch_lengths)\n
+	* @param    [in]  size_t count                行数\n
+	* @param    [out] int64_t* out                解码结果\n
+	* @param    [out] uint8_t* status             每行状态, 见decode_status, 可为空\n
+	* @return   返回状态不为decode_ok的行数
+	* @note
+	* @warning
+	* @bug
+	*/
+    size_t decode_int64(const char* const* vals, const unsigned long* lens, size_t count, int64_t* out, uint8_t* status);
+    /*
+	* @brief    批量解码双精度浮点数函数。
+	* @param    [in]  const char* const* vals     文本值指针, 必须以0结尾, NULL表示字段为NULL\n
+	* @param    [in]  const unsigned long* lens   文本长度(mysql_fetch_lengths)\n
+	* @param    [in]  size_t count                行数\n
+	* @param    [out] double* out                 解码结果\n
+	* @param    [out] uint8_t* status             每行状态, 见decode_status, 可为空\n
+	* @return   返回状态不为decode_ok的行数
+	* @note
+	* @warning
+	* @bug
+	*/
+    size_t decode_double(const char* const* vals, const unsigned long* lens, size_t count, double* out, uint8_t* status);
+}
+
+#endif
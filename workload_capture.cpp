@@ -0,0 +1,313 @@
+#include "workload_capture.h"
+#include <errno.h>
+#include <string.h>
+
+namespace zdb{
+    static const char WORKLOAD_TRACE_MAGIC[8] = {'Z', 'D', 'B', 'T', 'R', 'A', 'C', 'E'};
+
+    static void put_fixed(std::string& out, uint64_t val, int bytes)
+    {
+        for(int i = 0; i < bytes; ++i){
+            out += (char)((val >> (i * 8)) & 0xff);
+        }
+    }
+
+    static void put_varint(std::string& out, uint64_t val)
+    {
+        while(val >= 0x80){
+            out += (char)((val & 0x7f) | 0x80);
+            val >>= 7;
+        }
+        out += (char)val;
+    }
+
+    static bool get_fixed(FILE* file, uint64_t& val, int bytes)
+    {
+        val = 0;
+        for(int i = 0; i < bytes; ++i){
+            int c = fgetc(file);
+            if(EOF == c){
+                return false;
+            }
+            val |= (uint64_t)c << (i * 8);
+        }
+
+        return true;
+    }
+
+    static bool get_varint(FILE* file, uint64_t& val)
+    {
+        val = 0;
+        for(int shift = 0; shift < 64; shift += 7){
+            int c = fgetc(file);
+            if(EOF == c){
+                return false;
+            }
+            val |= (uint64_t)(c & 0x7f) << shift;
+            if(0 == (c & 0x80)){
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    workload_capture::workload_capture()
+        : m_active(false)
+        , m_file(0)
+        , m_last_offset(0)
+        , m_max_bytes(0)
+        , m_bytes(0)
+        , m_count(0)
+    {
+    }
+
+    workload_capture::~workload_capture()
+    {
+        stop();
+    }
+
+    bool workload_capture::start(const char* path, uint64_t max_bytes, std::string& error)
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        if(m_file){
+            error = "workload capture is already running";
+            return false;
+        }
+
+        m_file = fopen(path, "wb");
+        if(0 == m_file){
+            error = "failed to open ";
+            error += path;
+            error += ", errno=";
+            error += std::to_string(errno);
+            return false;
+        }
+
+        m_start = clock::now();
+        m_last_offset = 0;
+        m_sessions.clear();
+        m_sql_ids.clear();
+        m_buffer.clear();
+        m_buffer.reserve(WORKLOAD_CAPTURE_BUFFER_SIZE * 2);
+        m_max_bytes = max_bytes;
+        m_count = 0;
+
+        uint64_t now_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        m_buffer.append(WORKLOAD_TRACE_MAGIC, sizeof(WORKLOAD_TRACE_MAGIC));
+        put_fixed(m_buffer, WORKLOAD_TRACE_VERSION, 4);
+        put_fixed(m_buffer, WORKLOAD_CAPTURE_MAX_SQL_IDS, 4);
+        put_fixed(m_buffer, now_us, 8);
+        m_bytes = m_buffer.size();
+
+        m_active = true;
+
+        return true;
+    }
+
+    uint64_t workload_capture::stop()
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_active = false;
+        if(0 == m_file){
+            return 0;
+        }
+
+        flush(true);
+        fclose(m_file);
+        m_file = 0;
+        m_sessions.clear();
+        m_sql_ids.clear();
+
+        return m_count;
+    }
+
+    void workload_capture::flush(bool force)
+    {
+        if(m_buffer.empty() || (!force && m_buffer.size() < WORKLOAD_CAPTURE_BUFFER_SIZE)){
+            return;
+        }
+
+        fwrite(m_buffer.data(), 1, m_buffer.size(), m_file);
+        m_buffer.clear();
+        if(force){
+            fflush(m_file);
+        }
+    }
+
+    void workload_capture::record(std::chrono::steady_clock::time_point start, const char* sql, uint64_t lease_us, uint64_t exec_us, uint8_t flags)
+    {
+        if(0 == sql){
+            sql = "";
+        }
+
+        std::lock_guard<std::mutex> lock(m_mtx);
+        if(!m_active || 0 == m_file){
+            return;
+        }
+
+        size_t begin = m_buffer.size();
+        int64_t offset = std::chrono::duration_cast<std::chrono::microseconds>(start - m_start).count();
+        if(offset < 0){
+            offset = 0;
+        }
+        int64_t delta = offset - m_last_offset;
+        put_varint(m_buffer, ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63));
+
+        auto session = m_sessions.emplace(std::this_thread::get_id(), (uint32_t)m_sessions.size() + 1).first;
+        put_varint(m_buffer, session->second);
+        put_varint(m_buffer, lease_us);
+        put_varint(m_buffer, exec_us);
+        m_buffer += (char)flags;
+
+        auto it = m_sql_ids.find(sql);
+        if(it != m_sql_ids.end()){
+            put_varint(m_buffer, (uint64_t)it->second + 1);
+        }else{
+            size_t len = strlen(sql);
+            put_varint(m_buffer, 0);
+            put_varint(m_buffer, len);
+            m_buffer.append(sql, len);
+            if(m_sql_ids.size() < WORKLOAD_CAPTURE_MAX_SQL_IDS){
+                m_sql_ids.emplace(sql, (uint32_t)m_sql_ids.size());
+            }
+        }
+
+        // 超过上限时撤销这一条, 之后的语句不再录制
+        if(m_max_bytes > 0 && m_bytes + m_buffer.size() - begin > m_max_bytes){
+            m_buffer.resize(begin);
+            m_active = false;
+            return;
+        }
+
+        m_bytes += m_buffer.size() - begin;
+        m_last_offset = offset;
+        ++m_count;
+        flush(false);
+    }
+
+    uint64_t workload_capture::get_count()
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        return m_count;
+    }
+
+    workload_reader::workload_reader()
+        : m_file(0)
+        , m_max_sql_ids(0)
+        , m_start_time_us(0)
+        , m_last_offset(0)
+    {
+    }
+
+    workload_reader::~workload_reader()
+    {
+        close();
+    }
+
+    bool workload_reader::open(const char* path, std::string& error)
+    {
+        close();
+
+        m_file = fopen(path, "rb");
+        if(0 == m_file){
+            error = "failed to open ";
+            error += path;
+            error += ", errno=";
+            error += std::to_string(errno);
+            return false;
+        }
+
+        char magic[sizeof(WORKLOAD_TRACE_MAGIC)];
+        uint64_t version = 0;
+        uint64_t max_sql_ids = 0;
+        if(fread(magic, 1, sizeof(magic), m_file) != sizeof(magic) || memcmp(magic, WORKLOAD_TRACE_MAGIC, sizeof(magic)) != 0
+            || !get_fixed(m_file, version, 4) || !get_fixed(m_file, max_sql_ids, 4) || !get_fixed(m_file, m_start_time_us, 8)){
+            error = "not a workload trace file";
+            close();
+            return false;
+        }
+
+        if(version != WORKLOAD_TRACE_VERSION){
+            error = "unsupported workload trace version " + std::to_string(version);
+            close();
+            return false;
+        }
+
+        m_max_sql_ids = (uint32_t)max_sql_ids;
+
+        return true;
+    }
+
+    void workload_reader::close()
+    {
+        if(m_file){
+            fclose(m_file);
+            m_file = 0;
+        }
+
+        m_last_offset = 0;
+        m_sqls.clear();
+    }
+
+    bool workload_reader::next(workload_event& event, std::string& error)
+    {
+        if(0 == m_file){
+            error = "workload trace is not open";
+            return false;
+        }
+
+        uint64_t delta = 0;
+        if(!get_varint(m_file, delta)){
+            // 在一条的开头读完是正常结束
+            if(!feof(m_file)){
+                error = "failed to read workload trace";
+            }
+            return false;
+        }
+
+        uint64_t session = 0;
+        uint64_t lease_us = 0;
+        uint64_t exec_us = 0;
+        uint64_t sql_id = 0;
+        int flags = 0;
+        if(!get_varint(m_file, session) || !get_varint(m_file, lease_us) || !get_varint(m_file, exec_us)
+            || EOF == (flags = fgetc(m_file)) || !get_varint(m_file, sql_id)){
+            error = "truncated workload trace";
+            return false;
+        }
+
+        if(0 == sql_id){
+            uint64_t len = 0;
+            if(!get_varint(m_file, len)){
+                error = "truncated workload trace";
+                return false;
+            }
+
+            event.m_sql.resize(len);
+            if(len > 0 && fread(&event.m_sql[0], 1, len, m_file) != len){
+                error = "truncated workload trace";
+                return false;
+            }
+
+            if(m_sqls.size() < m_max_sql_ids){
+                m_sqls.push_back(event.m_sql);
+            }
+        }else{
+            if(sql_id > m_sqls.size()){
+                error = "corrupted workload trace, unknown sql id " + std::to_string(sql_id);
+                return false;
+            }
+            event.m_sql = m_sqls[sql_id - 1];
+        }
+
+        m_last_offset += (int64_t)((delta >> 1) ^ (~(delta & 1) + 1));
+        event.m_offset_us = m_last_offset < 0?0:(uint64_t)m_last_offset;
+        event.m_session = (uint32_t)session;
+        event.m_lease_us = (uint32_t)lease_us;
+        event.m_exec_us = (uint32_t)exec_us;
+        event.m_flags = (uint8_t)flags;
+
+        return true;
+    }
+}
@@ -0,0 +1,194 @@
+/*
+* @file
+    workload_capture.h
+
+* @brief
+    语句负载录制和读取类
+
+* @version
+    V1.0
+
+* @author
+    agent
+
+* @date
+    2026/10/19
+
+* @note
+    连接池开始录制(db_pool::start_capture)后, 每条经由连接池执行的语句都以开始时刻、执行线程、
+    等待连接时间、执行时间和结果写入二进制文件, 供zdb_replay按原速、倍速或最快速度重放。
+
+    文件格式(整数均为小端):
+        头部    "ZDBTRACE" | u32 版本 | u32 SQL编号上限 | u64 开始录制的系统时间(微秒)
+        每条    varint 与上一条开始时刻之差(zigzag, 微秒) | varint 会话 | varint 等待连接(微秒)
+                | varint 执行(微秒) | u8 标志 | varint SQL编号
+    SQL编号为0时其后为varint长度和SQL文本, 并按出现顺序分配下一个编号(不超过上限);
+    非0时为之前出现过的第(编号-1)条SQL。重复的语句每条只占十几个字节。
+    execute_batch的每条语句单独记录, 重放时在同一会话中依次执行。
+
+* @warning
+    预处理语句只录制SQL模板, 不含参数
+* @bug
+* @copyright
+*/
+#ifndef zdb_workload_capture_h
+#define zdb_workload_capture_h
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace zdb{
+    const uint32_t WORKLOAD_TRACE_VERSION          = 1;
+    const uint32_t WORKLOAD_CAPTURE_MAX_SQL_IDS    = 65536;         // 分配编号的不同SQL数, 之后出现的新SQL每次内联写入
+    const size_t WORKLOAD_CAPTURE_BUFFER_SIZE      = 64 * 1024;     // 写文件前的缓冲大小
+
+    enum workload_flag{
+        workload_flag_ok       = 1,    // 执行成功
+        workload_flag_async    = 2,    // 异步语句(push_async), 等待连接时间为排队时间
+        workload_flag_prepared = 4,    // 预处理语句, SQL为模板
+        workload_flag_batch    = 8,    // execute_batch中的一条, 同批各条开始时刻相同, 执行时间为整批平均
+    };
+
+    // 一条录制的语句
+    struct workload_event{
+        uint64_t m_offset_us;   // 距开始录制的时间(微秒), 语句开始等待连接的时刻
+        uint32_t m_session;     // 会话编号, 同一线程执行的语句编号相同, 从1开始
+        uint32_t m_lease_us;    // 等待租用连接的时间(微秒)
+        uint32_t m_exec_us;     // 执行时间(微秒)
+        uint8_t m_flags;        // workload_flag的组合
+        std::string m_sql;      // SQL语句
+    };
+
+    class workload_capture{
+        private:
+        typedef std::chrono::steady_clock clock;
+
+        std::atomic<bool> m_active;     // 是否录制
+        std::mutex m_mtx;
+        FILE* m_file;
+        clock::time_point m_start;      // 开始录制的时刻
+        int64_t m_last_offset;          // 上一条的开始时刻(微秒)
+        std::unordered_map<std::thread::id, uint32_t> m_sessions;   // 线程-会话编号
+        std::unordered_map<std::string, uint32_t> m_sql_ids;        // SQL-编号
+        std::string m_buffer;           // 待写入文件的数据
+        uint64_t m_max_bytes;           // 文件大小上限, 0不限制
+        uint64_t m_bytes;               // 已写入和缓冲的字节数
+        uint64_t m_count;               // 已录制的语句数
+
+        workload_capture(const workload_capture&);
+        workload_capture& operator=(const workload_capture&);
+
+        // 缓冲满时写入文件, 调用前加锁
+        void flush(bool force);
+
+        public:
+        workload_capture();
+        ~workload_capture();
+
+        /*
+		* @brief	开始录制函数。
+		* @param 	[in]  const char* path      文件路径, 已存在时覆盖\n
+		* @param 	[in]  uint64_t max_bytes    文件大小上限(字节), 达到后不再录制, 0不限制\n
+		* @param 	[out] std::string& error    错误信息\n
+		* @return 	返回是否成功, 已在录制时失败
+		* @note
+		    达到文件大小上限后active()返回false, 仍需调用stop关闭文件
+		* @warning
+		* @bug
+		*/
+        bool start(const char* path, uint64_t max_bytes, std::string& error);
+        /*
+		* @brief	停止录制函数。
+		* @param 	无\n
+		* @return 	返回录制的语句数
+		* @note
+		    写入缓冲的数据并关闭文件, 未在录制时返回0
+		* @warning
+		* @bug
+		*/
+        uint64_t stop();
+
+        bool active() const
+        {
+            return m_active.load(std::memory_order_relaxed);
+        }
+
+        /*
+		* @brief	录制一条语句函数。
+		* @param 	[in]  std::chrono::steady_clock::time_point start   开始等待连接的时刻\n
+		* @param 	[in]  const char* sql                               SQL语句\n
+		* @param 	[in]  uint64_t lease_us                             等待租用连接的时间(微秒)\n
+		* @param 	[in]  uint64_t exec_us                              执行时间(微秒)\n
+		* @param 	[in]  uint8_t flags                                 workload_flag的组合\n
+		* @return 	无
+		* @note
+		    在执行语句的线程中调用, 编码和写缓冲在一把锁内完成
+		* @warning
+		* @bug
+		*/
+        void record(std::chrono::steady_clock::time_point start, const char* sql, uint64_t lease_us, uint64_t exec_us, uint8_t flags);
+        /*
+		* @brief	获得录制计数函数。
+		* @param 	无\n
+		* @return 	返回本次录制的语句数
+		* @note
+		* @warning
+		* @bug
+		*/
+        uint64_t get_count();
+    };
+
+    class workload_reader{
+        private:
+        FILE* m_file;
+        uint32_t m_max_sql_ids;             // 录制时的SQL编号上限
+        uint64_t m_start_time_us;           // 开始录制的系统时间(微秒)
+        int64_t m_last_offset;              // 上一条的开始时刻(微秒)
+        std::vector<std::string> m_sqls;    // 已分配编号的SQL
+
+        workload_reader(const workload_reader&);
+        workload_reader& operator=(const workload_reader&);
+
+        public:
+        workload_reader();
+        ~workload_reader();
+
+        /*
+		* @brief	打开录制文件函数。
+		* @param 	[in]  const char* path      文件路径\n
+		* @param 	[out] std::string& error    错误信息\n
+		* @return 	返回是否成功
+		* @note
+		* @warning
+		* @bug
+		*/
+        bool open(const char* path, std::string& error);
+        void close();
+        /*
+		* @brief	读取下一条语句函数。
+		* @param 	[out] workload_event& event  语句\n
+		* @param 	[out] std::string& error     错误信息\n
+		* @return 	返回是否读到一条
+		* @return   true   成功\n
+		* @return   false  读完(error为空)或文件损坏\n
+		* @note
+		* @warning
+		* @bug
+		*/
+        bool next(workload_event& event, std::string& error);
+
+        // 返回开始录制的系统时间(微秒)
+        uint64_t get_start_time() const
+        {
+            return m_start_time_us;
+        }
+    };
+}
+
+#endif
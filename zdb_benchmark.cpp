@@ -0,0 +1,689 @@
+/*
+* @file
+    zdb_benchmark.cpp
+
+* @brief
+    连接池、异步队列和结果集解码的性能测试
+
+* @version
+    V1.0
+
+* @author
+    agent
+
+* @date
+    2026/10/19
+
+* @note
+    基于Google Benchmark。解码和日期时间转换的用例不需要数据库;
+    连接池、异步队列和预处理语句的用例通过环境变量连接数据库:
+    ZDB_BENCH_HOST ZDB_BENCH_PORT ZDB_BENCH_USER ZDB_BENCH_PWD ZDB_BENCH_DB
+    未设置ZDB_BENCH_HOST时在进程内启动mock_server并连接它(Windows下跳过这些用例),
+    此时测得的是客户端和协议处理的开销; 连接失败时这些用例被跳过。
+
+    zdb_benchmark --benchmark_filter=decode
+
+* @warning
+    预处理语句的用例会创建并清空表zdb_bench
+* @bug
+* @copyright
+*/
+#include <benchmark/benchmark.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+#include "pool.h"
+#include "helper.h"
+#include "interceptor.h"
+#include "query_cache.h"
+#include "query_stats.h"
+#include "result_set.h"
+#include "text_decoder.h"
+#include "workload_capture.h"
+#ifndef _WIN32
+#include "mock_server.h"
+#endif
+
+namespace{
+    const int BENCH_ROWS = 1024;        // 解码用例的记录数
+    const int BENCH_POOL_SIZE = 32;     // 连接池用例的连接数
+
+    const char* get_env(const char* name, const char* def)
+    {
+        const char* val = getenv(name);
+        return (val && *val)?val:def;
+    }
+
+#ifndef _WIN32
+    /*
+	* @brief	获得未配置数据库时使用的模拟服务端函数。
+	* @param 	[out] std::string& error  错误信息\n
+	* @return 	返回已启动的模拟服务端, 失败时为0
+	* @note
+	    预置性能测试用例用到的语句的应答, zdb_bench的查询返回BENCH_ROWS行
+	* @warning
+	* @bug
+	*/
+    zdb::mock_server* get_bench_server(std::string& error)
+    {
+        static zdb::mock_server server;
+
+        zdb::mock_rule rows("select id,price,name from zdb_bench");
+        rows.column("id", MYSQL_TYPE_LONGLONG).column("price", MYSQL_TYPE_DOUBLE).column("name", MYSQL_TYPE_VAR_STRING);
+        for(int i = 0; i < BENCH_ROWS; ++i){
+            rows.row({std::to_string(i), std::to_string(i * 0.5), std::string("bulk-row")});
+        }
+
+        server.add_rule(zdb::mock_rule("select 1").column("1", MYSQL_TYPE_LONGLONG).row({std::string("1")}));
+        server.add_rule(rows);
+        server.add_rule(zdb::mock_rule("insert into zdb_bench").ok(1));
+        if(!server.start("127.0.0.1", 0, error)){
+            return 0;
+        }
+
+        return &server;
+    }
+#endif
+
+    /*
+	* @brief	获得性能测试共用的连接池函数。
+	* @param 	[out] std::string& error  错误信息\n
+	* @return 	返回连接池, 未配置或连接失败时为0
+	* @note
+	    只创建一次, 多个线程同时调用时只有一个线程创建
+	* @warning
+	* @bug
+	*/
+    zdb::db_pool* get_bench_pool(std::string& error)
+    {
+        static std::once_flag flag;
+        static std::unique_ptr<zdb::db_pool> pool;
+        static std::string create_error;
+
+        std::call_once(flag, [](){
+            const char* host = get_env("ZDB_BENCH_HOST", "");
+            size_t port = (size_t)atoi(get_env("ZDB_BENCH_PORT", "3306"));
+            if(0 == *host){
+#ifdef _WIN32
+                create_error = "ZDB_BENCH_HOST is not set";
+                return;
+#else
+                zdb::mock_server* server = get_bench_server(create_error);
+                if(0 == server){
+                    return;
+                }
+                host = "127.0.0.1";
+                port = server->get_port();
+#endif
+            }
+
+            zdb::db_pool_setting cfg;
+            cfg.m_host = host;
+            cfg.m_port = port;
+            cfg.m_user = get_env("ZDB_BENCH_USER", "root");
+            cfg.m_pwd = get_env("ZDB_BENCH_PWD", "");
+            cfg.m_dbname = get_env("ZDB_BENCH_DB", "test");
+            cfg.m_charset = "utf8mb4";
+            cfg.m_size = BENCH_POOL_SIZE;
+
+            pool.reset(new zdb::db_pool());
+            if(!pool->create(cfg, true, create_error)){
+                pool.reset();
+            }
+        });
+
+        error = create_error;
+
+        return pool.get();
+    }
+
+    /*
+	* @brief	构建解码用例的结果副本函数。
+	* @param 	无\n
+	* @return 	返回BENCH_ROWS行的结果副本, 列为id bigint, price double, name varchar, created datetime
+	* @note
+	* @warning
+	* @bug
+	*/
+    zdb::ptr_cached_result make_bench_result()
+    {
+        static const char* names[] = {"id", "price", "name", "created"};
+        static const enum_field_types types[] = {MYSQL_TYPE_LONGLONG, MYSQL_TYPE_DOUBLE, MYSQL_TYPE_VAR_STRING, MYSQL_TYPE_DATETIME};
+
+        MYSQL_FIELD fields[4];
+        memset(fields, 0, sizeof(fields));
+        for(int i = 0; i < 4; ++i){
+            fields[i].name = const_cast<char*>(names[i]);
+            fields[i].name_length = (unsigned int)strlen(names[i]);
+            fields[i].type = types[i];
+        }
+
+        std::shared_ptr<zdb::cached_result> result = std::make_shared<zdb::cached_result>();
+        result->begin(fields, 4, zdb::ptr_result_budget());
+
+        char id[32], price[32], name[64], created[32];
+        for(int i = 0; i < BENCH_ROWS; ++i){
+            snprintf(id, sizeof(id), "%d", 1000000 + i * 37);
+            snprintf(price, sizeof(price), "%d.%02d", i * 13 % 10000, i % 100);
+            snprintf(name, sizeof(name), "product-name-%06d", i);
+            snprintf(created, sizeof(created), "2021-%02d-%02d %02d:%02d:%02d", i % 12 + 1, i % 28 + 1, i % 24, i % 60, (i * 7) % 60);
+
+            char* row[4] = {id, price, name, created};
+            unsigned long lengths[4] = {(unsigned long)strlen(id), (unsigned long)strlen(price), (unsigned long)strlen(name), (unsigned long)strlen(created)};
+            result->append(row, lengths);
+        }
+        result->finish();
+
+        return result;
+    }
+
+    template<typename T>
+    void bench_get_field(benchmark::State& state, int idx)
+    {
+        zdb::ptr_cached_result cached = make_bench_result();
+        zdb::result_set res;
+        std::string error = "";
+        res.bind_cached(cached, error);
+
+        T val;
+        for(auto _ : state){
+            res.seek(0, error);
+            while(res.get_next_record(error)){
+                res.get_field(idx, val, error);
+                benchmark::DoNotOptimize(val);
+            }
+        }
+
+        state.SetItemsProcessed(state.iterations() * BENCH_ROWS);
+    }
+}
+
+// ---------------------------------------------------------------- 结果集解码
+static void BM_get_field_int64(benchmark::State& state)
+{
+    bench_get_field<long long>(state, 0);
+}
+BENCHMARK(BM_get_field_int64);
+
+static void BM_get_field_double(benchmark::State& state)
+{
+    bench_get_field<double>(state, 1);
+}
+BENCHMARK(BM_get_field_double);
+
+static void BM_get_field_string(benchmark::State& state)
+{
+    bench_get_field<std::string>(state, 2);
+}
+BENCHMARK(BM_get_field_string);
+
+static void BM_get_field_string_view(benchmark::State& state)
+{
+    bench_get_field<std::string_view>(state, 2);
+}
+BENCHMARK(BM_get_field_string_view);
+
+static void BM_get_field_datetime(benchmark::State& state)
+{
+    bench_get_field<MYSQL_TIME>(state, 3);
+}
+BENCHMARK(BM_get_field_datetime);
+
+static void BM_get_field_by_name(benchmark::State& state)
+{
+    zdb::ptr_cached_result cached = make_bench_result();
+    zdb::result_set res;
+    std::string error = "";
+    res.bind_cached(cached, error);
+
+    long long val = 0;
+    for(auto _ : state){
+        res.seek(0, error);
+        while(res.get_next_record(error)){
+            res.get_field("id", val, error);
+            benchmark::DoNotOptimize(val);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * BENCH_ROWS);
+}
+BENCHMARK(BM_get_field_by_name);
+
+// 整列批量解码与逐行atoll的对比
+static void BM_decode_int64_batch(benchmark::State& state)
+{
+    zdb::ptr_cached_result cached = make_bench_result();
+    std::vector<const char*> vals(BENCH_ROWS);
+    std::vector<unsigned long> lens(BENCH_ROWS);
+    for(int i = 0; i < BENCH_ROWS; ++i){
+        vals[i] = cached->get_row(i)[0];
+        lens[i] = cached->get_lengths(i)[0];
+    }
+
+    std::vector<int64_t> out(BENCH_ROWS);
+    std::vector<uint8_t> status(BENCH_ROWS);
+    for(auto _ : state){
+        zdb::decode_int64(vals.data(), lens.data(), BENCH_ROWS, out.data(), status.data());
+        benchmark::DoNotOptimize(out.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * BENCH_ROWS);
+}
+BENCHMARK(BM_decode_int64_batch);
+
+static void BM_decode_int64_atoll(benchmark::State& state)
+{
+    zdb::ptr_cached_result cached = make_bench_result();
+    std::vector<int64_t> out(BENCH_ROWS);
+    for(auto _ : state){
+        for(int i = 0; i < BENCH_ROWS; ++i){
+            out[i] = atoll(cached->get_row(i)[0]);
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * BENCH_ROWS);
+}
+BENCHMARK(BM_decode_int64_atoll);
+
+// 二进制协议下整数以本机格式到达, 读取只需复制
+static void BM_decode_int64_binary(benchmark::State& state)
+{
+    std::vector<int64_t> wire(BENCH_ROWS);
+    for(int i = 0; i < BENCH_ROWS; ++i){
+        wire[i] = 1000000 + i * 37;
+    }
+
+    std::vector<int64_t> out(BENCH_ROWS);
+    for(auto _ : state){
+        for(int i = 0; i < BENCH_ROWS; ++i){
+            memcpy(&out[i], &wire[i], sizeof(int64_t));
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * BENCH_ROWS);
+}
+BENCHMARK(BM_decode_int64_binary);
+
+static void BM_decode_double_batch(benchmark::State& state)
+{
+    zdb::ptr_cached_result cached = make_bench_result();
+    std::vector<const char*> vals(BENCH_ROWS);
+    std::vector<unsigned long> lens(BENCH_ROWS);
+    for(int i = 0; i < BENCH_ROWS; ++i){
+        vals[i] = cached->get_row(i)[1];
+        lens[i] = cached->get_lengths(i)[1];
+    }
+
+    std::vector<double> out(BENCH_ROWS);
+    std::vector<uint8_t> status(BENCH_ROWS);
+    for(auto _ : state){
+        zdb::decode_double(vals.data(), lens.data(), BENCH_ROWS, out.data(), status.data());
+        benchmark::DoNotOptimize(out.data());
+    }
+
+    state.SetItemsProcessed(state.iterations() * BENCH_ROWS);
+}
+BENCHMARK(BM_decode_double_batch);
+
+// ---------------------------------------------------------------- 日期时间转换
+static void BM_to_datetime(benchmark::State& state)
+{
+    const char* str = "2021-03-31 12:34:56.789012";
+    size_t len = strlen(str);
+    MYSQL_TIME val;
+    for(auto _ : state){
+        zdb::db_helper::instance().to_datetime(str, len, val);
+        benchmark::DoNotOptimize(val);
+    }
+}
+BENCHMARK(BM_to_datetime);
+
+// 原sscanf实现, 作为对比
+static void BM_to_datetime_sscanf(benchmark::State& state)
+{
+    const char* str = "2021-03-31 12:34:56";
+    MYSQL_TIME val;
+    memset(&val, 0, sizeof(val));
+    for(auto _ : state){
+        sscanf(str, "%4u-%2u-%2u %2u:%2u:%2u", &val.year, &val.month, &val.day, &val.hour, &val.minute, &val.second);
+        benchmark::DoNotOptimize(val);
+    }
+}
+BENCHMARK(BM_to_datetime_sscanf);
+
+static void BM_datetime_to_string(benchmark::State& state)
+{
+    MYSQL_TIME val;
+    zdb::db_helper::instance().to_datetime("2021-03-31 12:34:56.789012", val);
+    char buf[32];
+    for(auto _ : state){
+        int len = zdb::db_helper::instance().to_string(val, buf, sizeof(buf));
+        benchmark::DoNotOptimize(len);
+        benchmark::DoNotOptimize(buf);
+    }
+}
+BENCHMARK(BM_datetime_to_string);
+
+static void BM_datetime_time_point(benchmark::State& state)
+{
+    MYSQL_TIME val;
+    zdb::db_helper::instance().to_datetime("2021-03-31 12:34:56", val);
+    std::chrono::system_clock::time_point tp;
+    for(auto _ : state){
+        zdb::db_helper::instance().to_time_point(val, tp);
+        zdb::db_helper::instance().from_time_point(tp, val);
+        benchmark::DoNotOptimize(val);
+    }
+}
+BENCHMARK(BM_datetime_time_point);
+
+// ---------------------------------------------------------------- 语句统计
+namespace{
+    const char* BENCH_STATS_SQL = "SELECT id,price,name FROM zdb_bench WHERE id IN (1,2,3) AND name='bulk-row' LIMIT 10";
+}
+
+static void BM_fingerprint_sql(benchmark::State& state)
+{
+    std::string out = "";
+    for(auto _ : state){
+        benchmark::DoNotOptimize(zdb::db_helper::instance().fingerprint_sql(BENCH_STATS_SQL, out));
+    }
+}
+BENCHMARK(BM_fingerprint_sql);
+
+// 每条语句的统计开销: 计时、指纹和分片聚合, 多线程时体现分片锁的竞争
+static void BM_query_stats_record(benchmark::State& state)
+{
+    static zdb::query_stats stats;
+    static zdb::workload_capture capture;
+    stats.configure(true, 0, zdb::DEFAULT_SLOW_LOG_SIZE);
+
+    for(auto _ : state){
+        zdb::query_timer timer(stats, capture, BENCH_STATS_SQL);
+        timer.leased();
+        timer.set_ok(true);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_query_stats_record)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_query_stats_disabled(benchmark::State& state)
+{
+    zdb::query_stats stats;
+    zdb::workload_capture capture;
+    for(auto _ : state){
+        zdb::query_timer timer(stats, capture, BENCH_STATS_SQL);
+        timer.leased();
+        timer.set_ok(true);
+    }
+}
+BENCHMARK(BM_query_stats_disabled);
+
+// 每条语句的录制开销: 计时、编码和写缓冲, 重复的SQL只写编号
+static void BM_workload_capture_record(benchmark::State& state)
+{
+    std::string error = "";
+    zdb::query_stats stats;
+    zdb::workload_capture capture;
+    if(!capture.start("zdb_benchmark.trace", 0, error)){
+        state.SkipWithError(error.c_str());
+        return;
+    }
+
+    for(auto _ : state){
+        zdb::query_timer timer(stats, capture, BENCH_STATS_SQL);
+        timer.leased();
+        timer.set_ok(true);
+    }
+
+    capture.stop();
+    remove("zdb_benchmark.trace");
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_workload_capture_record);
+
+// ---------------------------------------------------------------- 拦截器
+// 未注册拦截器时操作前的判断, 与有一个空拦截器时一次操作的额外开销
+static void BM_interceptor_inactive(benchmark::State& state)
+{
+    zdb::db_interceptors::clear();
+    for(auto _ : state){
+        bool active = zdb::db_interceptors::active();
+        benchmark::DoNotOptimize(active);
+    }
+}
+BENCHMARK(BM_interceptor_inactive);
+
+static void BM_interceptor_noop(benchmark::State& state)
+{
+    zdb::ptr_db_interceptor noop = std::make_shared<zdb::db_interceptor>();
+    zdb::db_interceptors::add(noop);
+
+    for(auto _ : state){
+        zdb::db_interceptors::scope s(zdb::db_op_query, 0, BENCH_STATS_SQL);
+        s.finish(true, 1, 0);
+    }
+
+    zdb::db_interceptors::remove(noop);
+}
+BENCHMARK(BM_interceptor_noop);
+
+// ---------------------------------------------------------------- 连接池
+static void BM_pool_get_back(benchmark::State& state)
+{
+    std::string error = "";
+    zdb::db_pool* pool = get_bench_pool(error);
+    if(0 == pool){
+        state.SkipWithError(error.c_str());
+        return;
+    }
+
+    for(auto _ : state){
+        zdb::ptr_connection conn = pool->get_connect(error);
+        if(0 == conn){
+            state.SkipWithError(error.c_str());
+            break;
+        }
+        pool->back(conn);
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_pool_get_back)->ThreadRange(1, BENCH_POOL_SIZE)->UseRealTime();
+
+static void BM_push_async(benchmark::State& state)
+{
+    std::string error = "";
+    zdb::db_pool* pool = get_bench_pool(error);
+    if(0 == pool){
+        state.SkipWithError(error.c_str());
+        return;
+    }
+
+    const std::string sql = "DO 0";
+    size_t rejected = 0;
+    for(auto _ : state){
+        if(!pool->push_async(sql)){
+            ++rejected;
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["rejected"] = (double)rejected;
+}
+BENCHMARK(BM_push_async)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_query_ping(benchmark::State& state)
+{
+    std::string error = "";
+    zdb::db_pool* pool = get_bench_pool(error);
+    if(0 == pool){
+        state.SkipWithError(error.c_str());
+        return;
+    }
+
+    zdb::result_set res;
+    for(auto _ : state){
+        if(!pool->query("SELECT 1", res, error)){
+            state.SkipWithError(error.c_str());
+            break;
+        }
+    }
+}
+BENCHMARK(BM_query_ping)->UseRealTime();
+
+// ---------------------------------------------------------------- 预处理语句
+namespace{
+    bool prepare_bench_table(zdb::db_pool* pool, std::string& error)
+    {
+        pool->execute_real_affect_rows("CREATE TABLE IF NOT EXISTS zdb_bench(id BIGINT NOT NULL, price DOUBLE, name VARCHAR(64), created DATETIME)", error);
+        if(!error.empty()){
+            return false;
+        }
+
+        pool->execute_real_affect_rows("TRUNCATE TABLE zdb_bench", error);
+
+        return error.empty();
+    }
+}
+
+// 一次数组绑定执行与逐行执行的对比
+static void BM_execute_bulk(benchmark::State& state)
+{
+    std::string error = "";
+    zdb::db_pool* pool = get_bench_pool(error);
+    if(0 == pool || !prepare_bench_table(pool, error)){
+        state.SkipWithError(error.c_str());
+        return;
+    }
+
+    std::vector<std::tuple<int64_t, double, std::string>> rows;
+    for(int64_t i = 0; i < state.range(0); ++i){
+        rows.emplace_back(i, i * 0.5, "bulk-row");
+    }
+
+    my_ulonglong affect_rows = 0;
+    for(auto _ : state){
+        if(!pool->execute_bulk("INSERT INTO zdb_bench(id,price,name) VALUES(?,?,?)", rows, &affect_rows, error)){
+            state.SkipWithError(error.c_str());
+            break;
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_execute_bulk)->Arg(16)->Arg(256)->UseRealTime();
+
+// 可为NULL的字符串列, 隔行为NULL
+static void BM_execute_bulk_optional(benchmark::State& state)
+{
+    std::string error = "";
+    zdb::db_pool* pool = get_bench_pool(error);
+    if(0 == pool || !prepare_bench_table(pool, error)){
+        state.SkipWithError(error.c_str());
+        return;
+    }
+
+    std::vector<std::tuple<int64_t, double, std::optional<std::string>>> rows;
+    for(int64_t i = 0; i < state.range(0); ++i){
+        rows.emplace_back(i, i * 0.5, (i % 2)?std::optional<std::string>():std::optional<std::string>("bulk-row-" + std::to_string(i)));
+    }
+
+    my_ulonglong affect_rows = 0;
+    for(auto _ : state){
+        if(!pool->execute_bulk("INSERT INTO zdb_bench(id,price,name) VALUES(?,?,?)", rows, &affect_rows, error)){
+            state.SkipWithError(error.c_str());
+            break;
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_execute_bulk_optional)->Arg(16)->Arg(256)->UseRealTime();
+
+static void BM_execute_prepared_rows(benchmark::State& state)
+{
+    std::string error = "";
+    zdb::db_pool* pool = get_bench_pool(error);
+    if(0 == pool || !prepare_bench_table(pool, error)){
+        state.SkipWithError(error.c_str());
+        return;
+    }
+
+    for(auto _ : state){
+        for(int64_t i = 0; i < state.range(0); ++i){
+            if(!pool->execute_prepared("INSERT INTO zdb_bench(id,price,name) VALUES(?,?,?)", error, i, i * 0.5, std::string("bulk-row"))){
+                state.SkipWithError(error.c_str());
+                return;
+            }
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_execute_prepared_rows)->Arg(16)->Arg(256)->UseRealTime();
+
+// 二进制协议的预处理查询与文本协议查询的对比
+static void BM_query_binary(benchmark::State& state)
+{
+    std::string error = "";
+    zdb::db_pool* pool = get_bench_pool(error);
+    if(0 == pool){
+        state.SkipWithError(error.c_str());
+        return;
+    }
+
+    std::vector<std::tuple<int64_t, double, std::string>> rows;
+    for(auto _ : state){
+        rows.clear();
+        if(!pool->query_prepared("SELECT id,price,name FROM zdb_bench LIMIT ?", rows, error, (int64_t)BENCH_ROWS)){
+            state.SkipWithError(error.c_str());
+            break;
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * BENCH_ROWS);
+}
+BENCHMARK(BM_query_binary)->UseRealTime();
+
+static void BM_query_text(benchmark::State& state)
+{
+    std::string error = "";
+    zdb::db_pool* pool = get_bench_pool(error);
+    if(0 == pool){
+        state.SkipWithError(error.c_str());
+        return;
+    }
+
+    std::string sql = "SELECT id,price,name FROM zdb_bench LIMIT " + std::to_string(BENCH_ROWS);
+    zdb::result_set res;
+    long long id = 0;
+    double price = 0;
+    std::string name = "";
+    for(auto _ : state){
+        if(!pool->query(sql.c_str(), res, error)){
+            state.SkipWithError(error.c_str());
+            break;
+        }
+
+        while(res.get_next_record(error)){
+            res.get_field(0, id, error);
+            res.get_field(1, price, error);
+            res.get_field(2, name, error);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * BENCH_ROWS);
+}
+BENCHMARK(BM_query_text)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,501 @@
+/*
+* @file
+    zdb_loadgen.cpp
+
+* @brief
+    基于db_pool的压测工具, 用于确定连接池大小和异步执行能力
+
+* @version
+    V1.0
+
+* @author
+    agent
+
+* @date
+    2026/10/19
+
+* @note
+    zdb_loadgen --host 127.0.0.1 --port 3306 --user root --password 123 --db test \
+        --threads 32 --qps 20000 --duration 60 --mix 80:15:5 --pool-size 16
+    zdb_loadgen --mock --threads 8 --qps 5000 --duration 10
+
+    每个线程按--mix的比例随机执行读(--read-sql)、写(--write-sql)和异步写(--async-sql, push_async)。
+    指定--qps时为开环压测: 每个线程按固定间隔计划每次操作的发出时刻, 落后时不等待直接发出,
+    耗时从计划时刻算起, 服务端变慢时排队的时间也计入, 避免协调遗漏(coordinated omission)低估尾延迟;
+    不指定时每个线程尽快执行。
+
+    结果按操作分别打印总耗时、租用连接(get_connect)时间和执行时间的百分位, 直方图精度约1%;
+    异步写另外打印语句统计中的排队时间和执行时间。租用连接时间高说明连接池偏小,
+    异步排队时间持续增长说明异步线程跟不上写入。
+* @warning
+* @bug
+* @copyright
+*/
+#include "pool.h"
+#include "helper.h"
+#ifndef _WIN32
+#include "mock_server.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock load_clock;
+
+enum load_op{
+    load_op_read  = 0,
+    load_op_write = 1,
+    load_op_async = 2,
+    load_op_count = 3,
+};
+
+static const char* LOAD_OP_NAMES[load_op_count] = {"read", "write", "async"};
+
+/*
+* @brief
+    对数线性直方图(HDR风格)。小于128微秒时每微秒一桶, 之后每个2的幂区间分64桶, 相对误差不超过1/64。
+*/
+class latency_histogram{
+    private:
+    static const int SUB_BUCKETS = 64;
+    static const int LINEAR_LIMIT = SUB_BUCKETS * 2;
+    static const int BUCKET_COUNT = LINEAR_LIMIT + 57 * SUB_BUCKETS;
+
+    uint64_t m_counts[BUCKET_COUNT];
+    uint64_t m_total;
+    uint64_t m_max;
+
+    static int get_index(uint64_t us)
+    {
+        if(us < (uint64_t)LINEAR_LIMIT){
+            return (int)us;
+        }
+
+        int shift = 0;
+        while((us >> shift) >= (uint64_t)LINEAR_LIMIT){
+            ++shift;
+        }
+
+        return LINEAR_LIMIT + (shift - 1) * SUB_BUCKETS + (int)((us >> shift) - SUB_BUCKETS);
+    }
+
+    // 返回桶内的最大值
+    static uint64_t get_upper(int index)
+    {
+        if(index < LINEAR_LIMIT){
+            return (uint64_t)index;
+        }
+
+        int shift = (index - LINEAR_LIMIT) / SUB_BUCKETS + 1;
+        uint64_t sub = (uint64_t)((index - LINEAR_LIMIT) % SUB_BUCKETS + SUB_BUCKETS);
+
+        return ((sub + 1) << shift) - 1;
+    }
+
+    public:
+    latency_histogram()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        memset(m_counts, 0, sizeof(m_counts));
+        m_total = 0;
+        m_max = 0;
+    }
+
+    void record(uint64_t us)
+    {
+        ++m_counts[get_index(us)];
+        ++m_total;
+        m_max = std::max(m_max, us);
+    }
+
+    void merge(const latency_histogram& other)
+    {
+        for(int i = 0; i < BUCKET_COUNT; ++i){
+            m_counts[i] += other.m_counts[i];
+        }
+        m_total += other.m_total;
+        m_max = std::max(m_max, other.m_max);
+    }
+
+    uint64_t get_total() const
+    {
+        return m_total;
+    }
+
+    uint64_t get_percentile(double p) const
+    {
+        if(0 == m_total){
+            return 0;
+        }
+
+        uint64_t rank = (uint64_t)(p * m_total + 0.999999);
+        if(rank < 1){
+            rank = 1;
+        }
+
+        uint64_t seen = 0;
+        for(int i = 0; i < BUCKET_COUNT; ++i){
+            seen += m_counts[i];
+            if(seen >= rank){
+                return std::min(get_upper(i), m_max);
+            }
+        }
+
+        return m_max;
+    }
+
+    uint64_t get_max() const
+    {
+        return m_max;
+    }
+};
+
+// 一个线程一种操作的结果
+struct load_result{
+    latency_histogram m_latency;    // 从计划发出时刻到完成
+    latency_histogram m_lease;      // 租用连接
+    latency_histogram m_exec;       // 执行
+    uint64_t m_errors;
+    std::string m_first_error;
+
+    load_result(): m_errors(0) {}
+};
+
+struct load_config{
+    std::string m_sqls[load_op_count];
+    unsigned int m_weights[load_op_count];
+    double m_qps;                   // 总目标QPS, 0为尽快执行
+    int m_threads;
+    double m_duration;              // 秒
+    uint64_t m_seed;
+};
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --host <addr>             server address, default 127.0.0.1\n"
+        "  --port <port>             server port, default 3306\n"
+        "  --user <user>             default root\n"
+        "  --password <pwd>          default empty\n"
+        "  --db <name>               default test\n"
+#ifndef _WIN32
+        "  --mock                    run against an in-process mock server\n"
+        "  --mock-latency-us <us>    mock server latency per response\n"
+#endif
+        "  --threads <n>             client threads, default 8\n"
+        "  --qps <n>                 total target rate, open loop; 0 runs closed loop as fast as possible, default 0\n"
+        "  --duration <s>            default 10\n"
+        "  --mix <r:w:a>             read:write:async weights, default 90:10:0\n"
+        "  --read-sql <sql>          default \"select 1\"\n"
+        "  --write-sql <sql>         default \"update zdb_loadgen set v=v+1 where id=1\"\n"
+        "  --async-sql <sql>         default \"update zdb_loadgen set v=v+1 where id=2\"\n"
+        "  --pool-size <n>           pool size, default 10\n"
+        "  --seed <n>                random seed for the mix\n", name);
+}
+
+static bool parse_mix(const char* val, unsigned int* weights)
+{
+    unsigned int r = 0, w = 0, a = 0;
+    if(sscanf(val, "%u:%u:%u", &r, &w, &a) != 3 || 0 == r + w + a){
+        return false;
+    }
+
+    weights[load_op_read] = r;
+    weights[load_op_write] = w;
+    weights[load_op_async] = a;
+
+    return true;
+}
+
+static uint64_t elapsed_us(load_clock::time_point begin, load_clock::time_point end)
+{
+    return end > begin?std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count():0;
+}
+
+static void load_worker(zdb::db_pool* pool, const load_config* cfg, int index, load_result* results)
+{
+    std::mt19937_64 rng(cfg->m_seed + index);
+    unsigned int total_weight = cfg->m_weights[0] + cfg->m_weights[1] + cfg->m_weights[2];
+    std::uniform_int_distribution<unsigned int> pick(0, total_weight - 1);
+
+    // 各线程的计划时刻错开, 合起来是均匀的总速率
+    double interval_us = (cfg->m_qps > 0)?cfg->m_threads * 1e6 / cfg->m_qps:0;
+    load_clock::time_point begin = load_clock::now();
+    load_clock::time_point end = begin + std::chrono::microseconds((int64_t)(cfg->m_duration * 1e6));
+    std::string error = "";
+
+    for(uint64_t n = 0; ; ++n){
+        load_clock::time_point due = load_clock::now();
+        if(interval_us > 0){
+            due = begin + std::chrono::microseconds((int64_t)((n + (double)index / cfg->m_threads) * interval_us));
+            if(due >= end){
+                break;
+            }
+            std::this_thread::sleep_until(due);
+        }else if(due >= end){
+            break;
+        }
+
+        unsigned int roll = pick(rng);
+        int op = load_op_read;
+        while(roll >= cfg->m_weights[op]){
+            roll -= cfg->m_weights[op];
+            ++op;
+        }
+
+        load_result& result = results[op];
+        const char* sql = cfg->m_sqls[op].c_str();
+        load_clock::time_point start = load_clock::now();
+        load_clock::time_point leased = start;
+        bool ok = true;
+        error.clear();
+
+        if(load_op_async == op){
+            ok = pool->push_async(cfg->m_sqls[op]);
+        }else{
+            zdb::ptr_connection conn = pool->get_connect(error);
+            leased = load_clock::now();
+            if(0 == conn){
+                ok = false;
+            }else{
+                MYSQL_RES* res = conn->query(sql, error);
+                if(res){
+                    mysql_free_result(res);
+                }else{
+                    ok = error.empty();
+                }
+                pool->back(conn);
+            }
+        }
+
+        load_clock::time_point done = load_clock::now();
+        result.m_latency.record(elapsed_us(due, done));
+        result.m_lease.record(elapsed_us(start, leased));
+        result.m_exec.record(elapsed_us(leased, done));
+        if(!ok){
+            if(0 == result.m_errors){
+                result.m_first_error = error.empty()?"failed to push async sql":error;
+            }
+            ++result.m_errors;
+        }
+    }
+}
+
+static void print_histogram(const char* name, const latency_histogram& h)
+{
+    printf("  %-8s p50=%llu p90=%llu p99=%llu p99.9=%llu p99.99=%llu max=%llu (us)\n", name,
+        (unsigned long long)h.get_percentile(0.50), (unsigned long long)h.get_percentile(0.90),
+        (unsigned long long)h.get_percentile(0.99), (unsigned long long)h.get_percentile(0.999),
+        (unsigned long long)h.get_percentile(0.9999), (unsigned long long)h.get_max());
+}
+
+int main(int argc, char* argv[])
+{
+    zdb::db_pool_setting setting;
+    setting.m_host = "127.0.0.1";
+    setting.m_port = 3306;
+    setting.m_user = "root";
+    setting.m_pwd = "";
+    setting.m_dbname = "test";
+    setting.m_charset = "utf8mb4";
+    bool mock = false;
+    unsigned int mock_latency_us = 0;
+
+    load_config cfg;
+    cfg.m_sqls[load_op_read] = "select 1";
+    cfg.m_sqls[load_op_write] = "update zdb_loadgen set v=v+1 where id=1";
+    cfg.m_sqls[load_op_async] = "update zdb_loadgen set v=v+1 where id=2";
+    cfg.m_weights[load_op_read] = 90;
+    cfg.m_weights[load_op_write] = 10;
+    cfg.m_weights[load_op_async] = 0;
+    cfg.m_qps = 0;
+    cfg.m_threads = 8;
+    cfg.m_duration = 10;
+    cfg.m_seed = 1;
+
+    for(int i = 1; i < argc; ++i){
+        const char* opt = argv[i];
+        if(0 == strcmp(opt, "--help") || 0 == strcmp(opt, "-h")){
+            usage(argv[0]);
+            return 0;
+        }
+
+        if(0 == strcmp(opt, "--mock")){
+            mock = true;
+            continue;
+        }
+
+        if(i + 1 >= argc){
+            usage(argv[0]);
+            return 1;
+        }
+
+        const char* val = argv[++i];
+        if(0 == strcmp(opt, "--host")){
+            setting.m_host = val;
+        }else if(0 == strcmp(opt, "--port")){
+            setting.m_port = (size_t)atoi(val);
+        }else if(0 == strcmp(opt, "--user")){
+            setting.m_user = val;
+        }else if(0 == strcmp(opt, "--password")){
+            setting.m_pwd = val;
+        }else if(0 == strcmp(opt, "--db")){
+            setting.m_dbname = val;
+        }else if(0 == strcmp(opt, "--mock-latency-us")){
+            mock_latency_us = (unsigned int)strtoul(val, 0, 10);
+        }else if(0 == strcmp(opt, "--threads")){
+            cfg.m_threads = atoi(val);
+        }else if(0 == strcmp(opt, "--qps")){
+            cfg.m_qps = atof(val);
+        }else if(0 == strcmp(opt, "--duration")){
+            cfg.m_duration = atof(val);
+        }else if(0 == strcmp(opt, "--mix")){
+            if(!parse_mix(val, cfg.m_weights)){
+                usage(argv[0]);
+                return 1;
+            }
+        }else if(0 == strcmp(opt, "--read-sql")){
+            cfg.m_sqls[load_op_read] = val;
+        }else if(0 == strcmp(opt, "--write-sql")){
+            cfg.m_sqls[load_op_write] = val;
+        }else if(0 == strcmp(opt, "--async-sql")){
+            cfg.m_sqls[load_op_async] = val;
+        }else if(0 == strcmp(opt, "--pool-size")){
+            setting.m_size = atoi(val);
+        }else if(0 == strcmp(opt, "--seed")){
+            cfg.m_seed = strtoull(val, 0, 10);
+        }else{
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if(cfg.m_threads < 1 || cfg.m_qps < 0 || cfg.m_duration <= 0){
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::string error = "";
+#ifndef _WIN32
+    zdb::mock_server server;
+    if(mock){
+        zdb::mock_fault fault;
+        fault.m_latency_us = mock_latency_us;
+        server.set_fault(fault, cfg.m_seed);
+        if(!server.start("127.0.0.1", 0, error)){
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        setting.m_host = "127.0.0.1";
+        setting.m_port = server.get_port();
+    }
+#else
+    if(mock){
+        fprintf(stderr, "--mock is not supported on this platform\n");
+        return 1;
+    }
+#endif
+
+    // 异步写的排队时间和执行时间取自语句统计
+    setting.set_query_stats(true);
+    std::unique_ptr<zdb::db_pool> pool(new zdb::db_pool());
+    if(!pool->create(setting, true, error)){
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    printf("threads=%d qps=%s duration=%gs mix=%u:%u:%u pool_size=%d\n", cfg.m_threads,
+        cfg.m_qps > 0?std::to_string((long long)cfg.m_qps).c_str():"max", cfg.m_duration,
+        cfg.m_weights[0], cfg.m_weights[1], cfg.m_weights[2], setting.m_size);
+    fflush(stdout);
+
+    std::vector<std::unique_ptr<load_result[]>> results;
+    std::vector<std::thread> workers;
+    load_clock::time_point begin = load_clock::now();
+    for(int i = 0; i < cfg.m_threads; ++i){
+        results.emplace_back(new load_result[load_op_count]);
+        workers.emplace_back(load_worker, pool.get(), &cfg, i, results.back().get());
+    }
+
+    for(auto& it : workers){
+        it.join();
+    }
+    double seconds = elapsed_us(begin, load_clock::now()) / 1e6;
+
+    uint64_t total = 0;
+    for(int op = 0; op < load_op_count; ++op){
+        load_result merged;
+        for(auto& it : results){
+            merged.m_latency.merge(it[op].m_latency);
+            merged.m_lease.merge(it[op].m_lease);
+            merged.m_exec.merge(it[op].m_exec);
+            if(it[op].m_errors > 0 && merged.m_first_error.empty()){
+                merged.m_first_error = it[op].m_first_error;
+            }
+            merged.m_errors += it[op].m_errors;
+        }
+
+        uint64_t count = merged.m_latency.get_total();
+        if(0 == count){
+            continue;
+        }
+        total += count;
+
+        printf("%s: count=%llu errors=%llu rate=%.1f/s\n", LOAD_OP_NAMES[op], (unsigned long long)count,
+            (unsigned long long)merged.m_errors, count / seconds);
+        print_histogram("latency", merged.m_latency);
+        if(op != load_op_async){
+            print_histogram("lease", merged.m_lease);
+        }
+        print_histogram(op != load_op_async?"exec":"push", merged.m_exec);
+        if(!merged.m_first_error.empty()){
+            printf("  first error: %s\n", merged.m_first_error.c_str());
+        }
+    }
+
+    printf("total: count=%llu rate=%.1f/s elapsed=%.3fs\n", (unsigned long long)total, total / seconds, seconds);
+
+    // 等异步队列执行完再读取统计
+    if(cfg.m_weights[load_op_async] > 0){
+        for(int i = 0; i < 1000; ++i){
+            {
+                std::lock_guard<std::mutex> lock(pool->m_async_mtx);
+                if(pool->m_async_list.empty()){
+                    break;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        // 异步线程取走队列后还在执行最后一批
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        std::string fingerprint = "";
+        uint64_t hash = zdb::db_helper::instance().fingerprint_sql(cfg.m_sqls[load_op_async].c_str(), fingerprint);
+        std::vector<zdb::query_digest> digests;
+        pool->get_query_digests(digests);
+        for(auto& it : digests){
+            if(it.m_hash == hash && it.m_count > 0){
+                printf("async executed: count=%llu errors=%llu avg_queue=%lluus avg_exec=%lluus exec_p99=%lluus\n",
+                    (unsigned long long)it.m_count, (unsigned long long)it.m_errors,
+                    (unsigned long long)(it.m_lease_us / it.m_count), (unsigned long long)(it.m_total_us / it.m_count),
+                    (unsigned long long)it.get_percentile(0.99));
+            }
+        }
+    }
+
+    pool->close();
+
+    return 0;
+}
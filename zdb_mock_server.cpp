@@ -0,0 +1,133 @@
+/*
+* @file
+    zdb_mock_server.cpp
+
+* @brief
+    独立运行的MySQL协议模拟服务端
+
+* @version
+    V1.0
+
+* @author
+    agent
+
+* @date
+    2026/10/19
+
+* @note
+    zdb_mock_server --port 3307 --script rules.txt --latency-us 200 --jitter-us 100 --drop-rate 0.001 --seed 1
+    按Ctrl+C停止并打印统计
+
+* @warning
+* @bug
+* @copyright
+*/
+#include "mock_server.h"
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void on_signal(int)
+{
+    g_stop = 1;
+}
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --host <addr>             listen address, default 127.0.0.1\n"
+        "  --port <port>             listen port, default 3307, 0 for any\n"
+        "  --script <path>           rule script\n"
+        "  --latency-us <us>         fixed latency before each response\n"
+        "  --jitter-us <us>          random extra latency\n"
+        "  --drop-rate <p>           probability of not responding\n"
+        "  --disconnect-rate <p>     probability of closing the connection\n"
+        "  --refuse-rate <p>         probability of refusing a handshake\n"
+        "  --disconnect-after <n>    close each connection after n commands\n"
+        "  --seed <n>                random seed\n", name);
+}
+
+int main(int argc, char* argv[])
+{
+    const char* host = "127.0.0.1";
+    unsigned short port = 3307;
+    const char* script = 0;
+    uint64_t seed = 0;
+    zdb::mock_fault fault;
+
+    for(int i = 1; i < argc; ++i){
+        const char* opt = argv[i];
+        if(0 == strcmp(opt, "--help") || 0 == strcmp(opt, "-h")){
+            usage(argv[0]);
+            return 0;
+        }
+
+        if(i + 1 >= argc){
+            usage(argv[0]);
+            return 1;
+        }
+
+        const char* val = argv[++i];
+        if(0 == strcmp(opt, "--host")){
+            host = val;
+        }else if(0 == strcmp(opt, "--port")){
+            port = (unsigned short)atoi(val);
+        }else if(0 == strcmp(opt, "--script")){
+            script = val;
+        }else if(0 == strcmp(opt, "--latency-us")){
+            fault.m_latency_us = (unsigned int)strtoul(val, 0, 10);
+        }else if(0 == strcmp(opt, "--jitter-us")){
+            fault.m_jitter_us = (unsigned int)strtoul(val, 0, 10);
+        }else if(0 == strcmp(opt, "--drop-rate")){
+            fault.m_drop_rate = atof(val);
+        }else if(0 == strcmp(opt, "--disconnect-rate")){
+            fault.m_disconnect_rate = atof(val);
+        }else if(0 == strcmp(opt, "--refuse-rate")){
+            fault.m_refuse_rate = atof(val);
+        }else if(0 == strcmp(opt, "--disconnect-after")){
+            fault.m_disconnect_after = (unsigned int)strtoul(val, 0, 10);
+        }else if(0 == strcmp(opt, "--seed")){
+            seed = strtoull(val, 0, 10);
+        }else{
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::string error = "";
+    zdb::mock_server server;
+    if(script && !server.load_script(script, error)){
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    server.set_fault(fault, seed);
+    if(!server.start(host, port, error)){
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    printf("listening on %s:%u\n", host, server.get_port());
+    fflush(stdout);
+
+    while(!g_stop){
+        usleep(100 * 1000);
+    }
+
+    server.stop();
+
+    zdb::mock_server_stats stats = server.get_stats();
+    printf("connections=%llu commands=%llu queries=%llu dropped=%llu disconnects=%llu refused=%llu\n",
+        (unsigned long long)stats.m_connections, (unsigned long long)stats.m_commands,
+        (unsigned long long)stats.m_queries, (unsigned long long)stats.m_dropped,
+        (unsigned long long)stats.m_disconnects, (unsigned long long)stats.m_refused);
+
+    return 0;
+}
@@ -0,0 +1,333 @@
+/*
+* @file
+    zdb_replay.cpp
+
+* @brief
+    重放db_pool::start_capture录制的语句负载
+
+* @version
+    V1.0
+
+* @author
+    agent
+
+* @date
+    2026/10/19
+
+* @note
+    zdb_replay --trace app.trace --host 127.0.0.1 --port 3306 --user root --password 123 --db test --speed 2
+    zdb_replay --trace app.trace --mock --speed 0
+
+    每个录制会话的语句由同一个工作线程按录制顺序在同一个租用的连接上执行, 会话按编号分配到--threads个工作线程,
+    事务(START TRANSACTION ... COMMIT/ROLLBACK)因此在原会话的连接上重放。
+    --speed为1时按录制的时间间隔发出, 为2时快一倍, 为0时不等待、尽快执行。
+    结束后打印吞吐量, 以及重放和录制时耗时(等待连接加执行)的百分位, 以便对比连接池或服务端的调整。
+* @warning
+    带?参数的预处理语句只录制了模板, 无法重放, 计入skipped
+* @bug
+* @copyright
+*/
+#include "pool.h"
+#include "workload_capture.h"
+#ifndef _WIN32
+#include "mock_server.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+typedef std::chrono::steady_clock replay_clock;
+
+// 一个工作线程的结果
+struct replay_result{
+    std::vector<uint32_t> m_latency_us;     // 每条语句从发出到完成的时间(微秒)
+    uint64_t m_errors;                      // 失败数
+    uint64_t m_max_lag_us;                  // 晚于计划发出时间的最大值(微秒)
+    std::string m_first_error;              // 第一个错误
+
+    replay_result(): m_errors(0), m_max_lag_us(0) {}
+};
+
+static void usage(const char* name)
+{
+    fprintf(stderr,
+        "usage: %s --trace <path> [options]\n"
+        "  --host <addr>             server address, default 127.0.0.1\n"
+        "  --port <port>             server port, default 3306\n"
+        "  --user <user>             default root\n"
+        "  --password <pwd>          default empty\n"
+        "  --db <name>               default test\n"
+#ifndef _WIN32
+        "  --mock                    replay against an in-process mock server\n"
+        "  --script <path>           rule script for the mock server\n"
+#endif
+        "  --speed <x>               1 original pace, 2 twice as fast, 0 as fast as possible, default 1\n"
+        "  --threads <n>             worker threads, sessions are spread over them, default 16\n"
+        "  --pool-size <n>           pool size, default the number of threads\n", name);
+}
+
+// 返回已排序耗时的百分位
+static uint64_t get_percentile(const std::vector<uint32_t>& sorted, double p)
+{
+    if(sorted.empty()){
+        return 0;
+    }
+
+    size_t rank = (size_t)(p * sorted.size() + 0.999999);
+    if(rank < 1){
+        rank = 1;
+    }
+
+    return sorted[std::min(rank, sorted.size()) - 1];
+}
+
+static void print_latency(const char* name, std::vector<uint32_t>& latency)
+{
+    std::sort(latency.begin(), latency.end());
+    printf("%-8s p50=%llu p90=%llu p99=%llu p99.9=%llu max=%llu (us)\n", name,
+        (unsigned long long)get_percentile(latency, 0.50), (unsigned long long)get_percentile(latency, 0.90),
+        (unsigned long long)get_percentile(latency, 0.99), (unsigned long long)get_percentile(latency, 0.999),
+        (unsigned long long)(latency.empty()?0:latency.back()));
+}
+
+// 每个录制会话固定使用一个租用的连接, 事务和会话变量留在同一连接上; 会话的最后一条执行后归还
+static void replay_worker(zdb::db_pool* pool, const std::vector<zdb::workload_event>* events, const std::vector<size_t>* order,
+    const std::vector<size_t>* last_index, double speed, replay_clock::time_point begin, replay_result* result)
+{
+    std::string error = "";
+    std::unordered_map<uint32_t, zdb::ptr_connection> conns;
+    result->m_latency_us.reserve(order->size());
+    for(size_t index : *order){
+        const zdb::workload_event& event = (*events)[index];
+        replay_clock::time_point due = begin;
+        if(speed > 0){
+            due += std::chrono::microseconds((int64_t)(event.m_offset_us / speed));
+            std::this_thread::sleep_until(due);
+        }
+
+        replay_clock::time_point start = replay_clock::now();
+        if(speed > 0 && start > due){
+            uint64_t lag = std::chrono::duration_cast<std::chrono::microseconds>(start - due).count();
+            result->m_max_lag_us = std::max(result->m_max_lag_us, lag);
+        }
+
+        error.clear();
+        zdb::ptr_connection& conn = conns[event.m_session];
+        if(!conn){
+            conn = pool->get_connect(error);
+        }
+
+        MYSQL_RES* res = conn?conn->query(event.m_sql.c_str(), error):0;
+        if(res){
+            mysql_free_result(res);
+        }else if(!error.empty()){
+            if(0 == result->m_errors){
+                result->m_first_error = error;
+            }
+            ++result->m_errors;
+        }
+
+        result->m_latency_us.push_back((uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(replay_clock::now() - start).count());
+
+        if((*last_index)[event.m_session] == index){
+            if(conn){
+                pool->back(conn);
+            }
+            conns.erase(event.m_session);
+        }
+    }
+
+    for(auto& it : conns){
+        if(it.second){
+            pool->back(it.second);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const char* trace = 0;
+    zdb::db_pool_setting cfg;
+    cfg.m_host = "127.0.0.1";
+    cfg.m_port = 3306;
+    cfg.m_user = "root";
+    cfg.m_pwd = "";
+    cfg.m_dbname = "test";
+    cfg.m_charset = "utf8mb4";
+    bool mock = false;
+    const char* script = 0;
+    double speed = 1;
+    int threads = 16;
+    int pool_size = 0;
+
+    for(int i = 1; i < argc; ++i){
+        const char* opt = argv[i];
+        if(0 == strcmp(opt, "--help") || 0 == strcmp(opt, "-h")){
+            usage(argv[0]);
+            return 0;
+        }
+
+        if(0 == strcmp(opt, "--mock")){
+            mock = true;
+            continue;
+        }
+
+        if(i + 1 >= argc){
+            usage(argv[0]);
+            return 1;
+        }
+
+        const char* val = argv[++i];
+        if(0 == strcmp(opt, "--trace")){
+            trace = val;
+        }else if(0 == strcmp(opt, "--host")){
+            cfg.m_host = val;
+        }else if(0 == strcmp(opt, "--port")){
+            cfg.m_port = (size_t)atoi(val);
+        }else if(0 == strcmp(opt, "--user")){
+            cfg.m_user = val;
+        }else if(0 == strcmp(opt, "--password")){
+            cfg.m_pwd = val;
+        }else if(0 == strcmp(opt, "--db")){
+            cfg.m_dbname = val;
+        }else if(0 == strcmp(opt, "--script")){
+            script = val;
+        }else if(0 == strcmp(opt, "--speed")){
+            speed = atof(val);
+        }else if(0 == strcmp(opt, "--threads")){
+            threads = atoi(val);
+        }else if(0 == strcmp(opt, "--pool-size")){
+            pool_size = atoi(val);
+        }else{
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if(0 == trace || threads < 1 || speed < 0){
+        usage(argv[0]);
+        return 1;
+    }
+
+    // 读入全部语句, 按会话分配到工作线程; 同一会话的开始时刻递增, 按开始时刻稳定排序不改变会话内的顺序
+    std::string error = "";
+    zdb::workload_reader reader;
+    if(!reader.open(trace, error)){
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    std::vector<zdb::workload_event> events;
+    std::vector<std::vector<size_t>> orders(threads);
+    std::vector<size_t> last_index;     // 会话-最后一条语句
+    std::vector<uint32_t> captured;
+    uint64_t skipped = 0;
+    uint32_t sessions = 0;
+    zdb::workload_event event;
+    while(reader.next(event, error)){
+        if((event.m_flags & zdb::workload_flag_prepared) && event.m_sql.find('?') != std::string::npos){
+            ++skipped;
+            continue;
+        }
+
+        sessions = std::max(sessions, event.m_session);
+        if(last_index.size() <= event.m_session){
+            last_index.resize(event.m_session + 1, 0);
+        }
+        last_index[event.m_session] = events.size();
+        captured.push_back(event.m_lease_us + event.m_exec_us);
+        orders[event.m_session % threads].push_back(events.size());
+        events.push_back(event);
+    }
+
+    if(!error.empty()){
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    for(auto& order : orders){
+        std::stable_sort(order.begin(), order.end(), [&events](size_t a, size_t b){
+            return events[a].m_offset_us < events[b].m_offset_us;
+        });
+    }
+
+#ifndef _WIN32
+    zdb::mock_server server;
+    if(mock){
+        if(script && !server.load_script(script, error)){
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+
+        if(!server.start("127.0.0.1", 0, error)){
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        cfg.m_host = "127.0.0.1";
+        cfg.m_port = server.get_port();
+    }
+#else
+    if(mock){
+        fprintf(stderr, "--mock is not supported on this platform\n");
+        return 1;
+    }
+#endif
+
+    cfg.m_size = pool_size > 0?pool_size:threads;
+    std::unique_ptr<zdb::db_pool> pool(new zdb::db_pool());
+    if(!pool->create(cfg, error)){
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    printf("replaying %zu statements from %u sessions on %d threads, speed=%g, skipped=%llu\n",
+        events.size(), sessions, threads, speed, (unsigned long long)skipped);
+    fflush(stdout);
+
+    std::vector<replay_result> results(threads);
+    std::vector<std::thread> workers;
+    replay_clock::time_point begin = replay_clock::now();
+    for(int i = 0; i < threads; ++i){
+        if(!orders[i].empty()){
+            workers.emplace_back(replay_worker, pool.get(), &events, &orders[i], &last_index, speed, begin, &results[i]);
+        }
+    }
+
+    for(auto& it : workers){
+        it.join();
+    }
+    double seconds = std::chrono::duration_cast<std::chrono::microseconds>(replay_clock::now() - begin).count() / 1e6;
+
+    std::vector<uint32_t> replayed;
+    uint64_t errors = 0;
+    uint64_t max_lag = 0;
+    std::string first_error = "";
+    for(auto& it : results){
+        replayed.insert(replayed.end(), it.m_latency_us.begin(), it.m_latency_us.end());
+        if(it.m_errors > 0 && first_error.empty()){
+            first_error = it.m_first_error;
+        }
+        errors += it.m_errors;
+        max_lag = std::max(max_lag, it.m_max_lag_us);
+    }
+
+    printf("executed=%zu errors=%llu elapsed=%.3fs throughput=%.1f/s max_lag=%lluus\n", replayed.size(),
+        (unsigned long long)errors, seconds, seconds > 0?replayed.size() / seconds:0.0, (unsigned long long)max_lag);
+    print_latency("replay", replayed);
+    print_latency("captured", captured);
+    if(!first_error.empty()){
+        printf("first error: %s\n", first_error.c_str());
+    }
+
+    pool->close();
+
+    return errors > 0?2:0;
+}